@@ -9,14 +9,44 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
+#include <bit>
 #include <cassert>
 #include <cmath>
+#include <condition_variable>
 #include <cstddef>
+#include <cstdint>
+#include <deque>
 #include <execution>
 #include <functional>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
 #include <numeric>
 #include <ranges>
+#include <span>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#if !defined(MATH_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define MATH_SIMD_SSE
+#endif
+#if defined(MATH_SIMD_SSE) && defined(__AVX2__) && defined(__FMA__)
+#define MATH_SIMD_AVX2
+#endif
+#if defined(MATH_SIMD_SSE) && defined(__F16C__)
+#define MATH_SIMD_F16C
+#endif
+#if defined(MATH_SIMD_AVX2) && (defined(__AVXVNNI__) || (defined(__AVX512VNNI__) && defined(__AVX512VL__)))
+#define MATH_SIMD_VNNI
+#endif
+
+#ifdef MATH_SIMD_SSE
+#include <immintrin.h>
+#endif
 
 // Ubiquitous operations and types
 namespace Math {
@@ -66,21 +96,266 @@ constexpr T sqrt(T x)
     }
 }
 
-template <typename T>
-constexpr T cos(T x)
-{
-    if (std::is_constant_evaluated()) {
+/*
+    Constant evaluated elementary functions. The argument is reduced to a small interval, a
+    Horner polynomial is evaluated there in double and the result is scaled back, so results
+    are within a few ULP of the standard library (float results are nearly always correctly
+    rounded). sin, cos and tan are reduced with a three part Cody-Waite pi / 2, exact for
+    |x| < 1.6e6 and 0 from 2^52.
+*/
+namespace Constexpr {
+    inline constexpr double PI = 3.14159265358979323846;
+    inline constexpr double HALF_PI = 1.57079632679489661923;
+    inline constexpr double QUARTER_PI = 0.78539816339744830962;
+    inline constexpr double INFINITY_DOUBLE = std::numeric_limits<double>::infinity();
+    inline constexpr double NAN_DOUBLE = std::numeric_limits<double>::quiet_NaN();
+
+    constexpr bool isNaN(double x)
+    {
+        return x != x;
+    }
+
+    constexpr bool isNegative(double x)
+    {
+        return (std::bit_cast<uint64_t>(x) >> 63) != 0;
+    }
+
+    constexpr double abs(double x)
+    {
+        return isNegative(x) ? -x : x;
+    }
+
+    // Nearest integer, |x| must be below 2^62.
+    constexpr int64_t roundToInt(double x)
+    {
+        return static_cast<int64_t>(x < 0 ? x - 0.5 : x + 0.5);
+    }
+
+    // x * 2^n
+    constexpr double scaleByPow2(double x, int64_t n)
+    {
+        for (; n > 1023; n -= 1023) {
+            x *= 0x1p1023;
+        }
+        for (; n < -1022; n += 1022) {
+            x *= 0x1p-1022;
+        }
+        return x * std::bit_cast<double>(static_cast<uint64_t>(n + 1023) << 52);
+    }
+
+    // sin(r) and cos(r) for |r| <= pi / 4 (fdlibm kernel polynomials).
+    constexpr double sinKernel(double r)
+    {
+        const double z = r * r;
+        const double p = 2.75573137070700676789e-06 + z * (-2.50507602534068634195e-08 + z * 1.58969099521155010221e-10);
+        return r + r * z * (-1.66666666666666324348e-01 + z * (8.33333333332248946124e-03 + z * (-1.98412698298579493134e-04 + z * p)));
+    }
+
+    constexpr double cosKernel(double r)
+    {
+        const double z = r * r;
+        const double p = -2.75573143513906633035e-07 + z * (2.08757232129817482790e-09 + z * -1.13596475577881948265e-11);
+        const double q = z * z * (4.16666666666666019037e-02 + z * (-1.38888888888741095749e-03 + z * (2.48015872894767294178e-05 + z * p)));
+        return (1.0 - 0.5 * z) + q;
+    }
+
+    // x = r + quadrant * pi / 2 with |r| <= pi / 4 and quadrant in [0, 4).
+    struct Reduced {
+        double r;
+        int64_t quadrant;
+    };
+
+    // Past 2^52 the spacing of doubles exceeds pi / 4, the reduction keeps no bits of the angle
+    // and x * 2 / pi nears the int64_t range. As in Cephes sin, cos and tan return 0 there.
+    inline constexpr double TOTAL_LOSS = 0x1p52;
+
+    // |x| must be below TOTAL_LOSS.
+    constexpr Reduced reduceHalfPi(double x)
+    {
+        const int64_t n = roundToInt(x * 0.63661977236758134308);
+        const double nd = static_cast<double>(n);
+        const double r = ((x - nd * 1.57079632673412561417e+00) - nd * 6.07710050630396597660e-11) - nd * 2.02226624871116645580e-21;
+        return { r, ((n % 4) + 4) % 4 };
+    }
+
+    constexpr double sin(double x)
+    {
+        if (isNaN(x) || abs(x) == INFINITY_DOUBLE) {
+            return NAN_DOUBLE;
+        }
+        if (abs(x) >= TOTAL_LOSS) {
+            return 0.0;
+        }
+        const auto [r, quadrant] = reduceHalfPi(x);
+        switch (quadrant) {
+        case 0:
+            return sinKernel(r);
+        case 1:
+            return cosKernel(r);
+        case 2:
+            return -sinKernel(r);
+        default:
+            return -cosKernel(r);
+        }
+    }
+
+    constexpr double cos(double x)
+    {
+        if (isNaN(x) || abs(x) == INFINITY_DOUBLE) {
+            return NAN_DOUBLE;
+        }
+        if (abs(x) >= TOTAL_LOSS) {
+            return 0.0;
+        }
+        const auto [r, quadrant] = reduceHalfPi(x);
+        switch (quadrant) {
+        case 0:
+            return cosKernel(r);
+        case 1:
+            return -sinKernel(r);
+        case 2:
+            return -cosKernel(r);
+        default:
+            return sinKernel(r);
+        }
+    }
+
+    constexpr double tan(double x)
+    {
+        if (isNaN(x) || abs(x) == INFINITY_DOUBLE) {
+            return NAN_DOUBLE;
+        }
+        if (abs(x) >= TOTAL_LOSS) {
+            return 0.0;
+        }
+        const auto [r, quadrant] = reduceHalfPi(x);
+        const double s = sinKernel(r);
+        const double c = cosKernel(r);
+        return (quadrant % 2 == 0) ? s / c : -c / s;
+    }
+
+    // e^x = 2^n * e^r with |r| <= ln(2) / 2, e^r as a nested degree 13 Taylor series.
+    constexpr double exp(double x)
+    {
+        if (isNaN(x)) {
+            return x;
+        }
+        if (x > 709.782712893383973096) {
+            return INFINITY_DOUBLE;
+        }
+        if (x < -745.133219101941108420) {
+            return 0.0;
+        }
+        const int64_t n = roundToInt(x * 1.44269504088896338700);
+        const double nd = static_cast<double>(n);
+        const double r = (x - nd * 6.93147180369123816490e-01) - nd * 1.90821492927058770002e-10;
+        double y = 1.0;
+        for (int k = 13; k > 0; --k) {
+            y = 1.0 + y * r / k;
+        }
+        return scaleByPow2(y, n);
+    }
+
+    /*
+        log(x) = e * ln(2) + log(m) with m in [sqrt(0.5), sqrt(2)). log(1 + f) is evaluated as
+        f - f^2 / 2 + s * (f^2 / 2 + R(s^2)), s = f / (2 + f), as in fdlibm.
+    */
+    constexpr double log(double x)
+    {
+        if (isNaN(x) || x < 0) {
+            return NAN_DOUBLE;
+        }
         if (x == 0) {
-            return 1;
+            return -INFINITY_DOUBLE;
         }
-        T result = 0.0;
-        for (T i = 0; i < 20; ++i) {
-            result += Math::pow(static_cast<T>(-1.0), static_cast<T>(i))
-                * Math::pow(x, static_cast<T>(2 * i))
-                / Math::factorial(static_cast<T>(2 * i));
+        if (x == INFINITY_DOUBLE) {
+            return x;
         }
-        return result;
+        int64_t e = 0;
+        if (x < std::numeric_limits<double>::min()) {
+            x *= 0x1p54;
+            e -= 54;
+        }
+        const uint64_t bits = std::bit_cast<uint64_t>(x);
+        e += static_cast<int64_t>((bits >> 52) & 0x7ff) - 1023;
+        double m = std::bit_cast<double>((bits & 0x000fffffffffffffull) | 0x3ff0000000000000ull);
+        if (m > 1.41421356237309504880) {
+            m *= 0.5;
+            e += 1;
+        }
+        const double f = m - 1.0;
+        const double s = f / (2.0 + f);
+        const double z = s * s;
+        double poly = 0.0;
+        for (int k = 12; k > 0; --k) {
+            poly = z * (2.0 / (2 * k + 1) + poly);
+        }
+        const double half_f_squared = 0.5 * f * f;
+        const double ed = static_cast<double>(e);
+        return ed * 6.93147180369123816490e-01 - ((half_f_squared - (s * (half_f_squared + poly) + ed * 1.90821492927058770002e-10)) - f);
+    }
+
+    /*
+        atan(x) with |x| folded into [0, 1] by atan(x) = pi / 2 - atan(1 / x) and then into
+        [0, 2 - sqrt(3)] by atan(x) = pi / 6 + atan((sqrt(3) x - 1) / (sqrt(3) + x)).
+    */
+    constexpr double atan(double x)
+    {
+        if (isNaN(x)) {
+            return x;
+        }
+        double a = abs(x);
+        const bool inverted = a > 1.0;
+        if (inverted) {
+            a = 1.0 / a;
+        }
+        constexpr double SQRT_3 = 1.73205080756887729353;
+        const bool shifted = a > 0.26794919243112270647;
+        if (shifted) {
+            a = (SQRT_3 * a - 1.0) / (SQRT_3 + a);
+        }
+        const double z = a * a;
+        double poly = 0.0;
+        for (int k = 15; k >= 0; --k) {
+            poly = (k % 2 == 0 ? 1.0 : -1.0) / (2 * k + 1) + z * poly;
+        }
+        double result = a * poly;
+        if (shifted) {
+            result += PI / 6;
+        }
+        if (inverted) {
+            result = HALF_PI - result;
+        }
+        return isNegative(x) ? -result : result;
+    }
 
+    constexpr double atan2(double y, double x)
+    {
+        if (isNaN(x) || isNaN(y)) {
+            return NAN_DOUBLE;
+        }
+        const double abs_y = abs(y);
+        const double abs_x = abs(x);
+        double angle;
+        if (abs_x == INFINITY_DOUBLE && abs_y == INFINITY_DOUBLE) {
+            angle = QUARTER_PI;
+        } else if (abs_y <= abs_x) {
+            angle = (abs_y == 0) ? 0.0 : atan(abs_y / abs_x);
+        } else {
+            angle = HALF_PI - atan(abs_x / abs_y);
+        }
+        if (isNegative(x)) {
+            angle = PI - angle;
+        }
+        return isNegative(y) ? -angle : angle;
+    }
+}
+
+template <typename T>
+constexpr T cos(T x)
+{
+    if consteval {
+        return static_cast<T>(Constexpr::cos(static_cast<double>(x)));
     } else {
         return static_cast<T>(std::cos(x));
     }
@@ -89,17 +364,8 @@ constexpr T cos(T x)
 template <typename T>
 constexpr T sin(T x)
 {
-    if (std::is_constant_evaluated()) {
-        if (x == 0) {
-            return 0;
-        }
-        T result = 0.0;
-        for (T i = 0; i < 20; ++i) {
-            result += Math::pow(static_cast<T>(-1.0), static_cast<T>(i))
-                * Math::pow(x, static_cast<T>(2 * i + 1))
-                / Math::factorial(static_cast<T>(2 * i + 1));
-        }
-        return result;
+    if consteval {
+        return static_cast<T>(Constexpr::sin(static_cast<double>(x)));
     } else {
         return static_cast<T>(std::sin(x));
     }
@@ -108,13 +374,63 @@ constexpr T sin(T x)
 template <typename T>
 constexpr T tan(T x)
 {
-    if (std::is_constant_evaluated()) {
-        return Math::sin<T>(x) / Math::cos<T>(x);
+    if consteval {
+        return static_cast<T>(Constexpr::tan(static_cast<double>(x)));
     } else {
         return static_cast<T>(std::tan(x));
     }
 }
 
+template <typename T>
+constexpr T exp(T x)
+{
+    if consteval {
+        return static_cast<T>(Constexpr::exp(static_cast<double>(x)));
+    } else {
+        return static_cast<T>(std::exp(x));
+    }
+}
+
+template <typename T>
+constexpr T log(T x)
+{
+    if consteval {
+        return static_cast<T>(Constexpr::log(static_cast<double>(x)));
+    } else {
+        return static_cast<T>(std::log(x));
+    }
+}
+
+template <typename T>
+constexpr T atan(T x)
+{
+    if consteval {
+        return static_cast<T>(Constexpr::atan(static_cast<double>(x)));
+    } else {
+        return static_cast<T>(std::atan(x));
+    }
+}
+
+template <typename T>
+constexpr T atan2(T y, T x)
+{
+    if consteval {
+        return static_cast<T>(Constexpr::atan2(static_cast<double>(y), static_cast<double>(x)));
+    } else {
+        return static_cast<T>(std::atan2(y, x));
+    }
+}
+
+/*
+    Accuracy tiers of the runtime approximations. Fast is about 1e-4, Medium about 1e-7
+    (float rounding), Exact defers to the standard library.
+*/
+enum class Precision {
+    Fast,
+    Medium,
+    Exact
+};
+
 struct Radians;
 struct Degrees {
     double angle;
@@ -137,828 +453,7125 @@ struct Radians {
     }
 };
 
-}
-
-// Activation functions (Machine learning)
-namespace Math::Activation {
-
-template <typename T>
-constexpr T linear(T x)
-{
-    return x;
-}
-
-template <typename T>
-constexpr T reLU(T x)
-{
-    return std::max(static_cast<T>(0), x);
-}
-
-template <typename T>
-constexpr T heaviside(T x)
-{
-    return static_cast<T>(x > 0);
-}
+namespace Float16 {
+    // IEEE binary16 bits of value, rounded to nearest even. Overflow becomes infinity.
+    constexpr uint16_t fromFloat(float value)
+    {
+        const uint32_t bits = std::bit_cast<uint32_t>(value);
+        const uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+        const uint32_t magnitude = bits & 0x7fffffff;
+        if (magnitude > 0x7f800000) {
+            return sign | 0x7e00 | static_cast<uint16_t>((magnitude >> 13) & 0x3ff);
+        }
+        if (magnitude >= 0x477ff000) {
+            return sign | 0x7c00;
+        }
+        if (magnitude < 0x38800000) {
+            // Subnormal half, value * 2^24 rounded to an integer.
+            if (magnitude < 0x33000000) {
+                return sign;
+            }
+            const uint32_t shift = 126 - (magnitude >> 23);
+            const uint32_t mantissa = (magnitude & 0x7fffff) | 0x800000;
+            const uint32_t remainder = mantissa & ((1u << shift) - 1);
+            const uint32_t halfway = 1u << (shift - 1);
+            uint32_t result = mantissa >> shift;
+            if (remainder > halfway || (remainder == halfway && (result & 1))) {
+                ++result;
+            }
+            return sign | static_cast<uint16_t>(result);
+        }
+        const uint32_t rebased = magnitude - (112u << 23);
+        return sign | static_cast<uint16_t>((rebased + 0xfff + ((rebased >> 13) & 1)) >> 13);
+    }
 
-template <std::floating_point T>
-constexpr T sigmoid(T x)
-{
-    return 1 / (1 + std::exp(-x));
-}
+    constexpr float toFloat(uint16_t half)
+    {
+        const uint32_t sign = static_cast<uint32_t>(half & 0x8000) << 16;
+        const uint32_t exponent = (half >> 10) & 0x1f;
+        const uint32_t mantissa = half & 0x3ff;
+        if (exponent == 0x1f) {
+            return std::bit_cast<float>(sign | 0x7f800000 | (mantissa << 13));
+        }
+        if (exponent == 0) {
+            const float value = static_cast<float>(mantissa) * 0x1p-24f;
+            return sign ? -value : value;
+        }
+        return std::bit_cast<float>(sign | ((exponent + 112) << 23) | (mantissa << 13));
+    }
 
-template <std::floating_point T>
-constexpr T gELU(T x)
-{
-    return (x / 2) * (1 + x / Math::sqrt<T>(2));
-}
+    // bfloat16 bits of value, the upper half of the float rounded to nearest even.
+    constexpr uint16_t fromFloatTruncated(float value)
+    {
+        const uint32_t bits = std::bit_cast<uint32_t>(value);
+        if ((bits & 0x7fffffff) > 0x7f800000) {
+            return static_cast<uint16_t>((bits >> 16) | 0x40);
+        }
+        return static_cast<uint16_t>((bits + 0x7fff + ((bits >> 16) & 1)) >> 16);
+    }
 
-template <std::floating_point T>
-constexpr T siLU(T x)
-{
-    return x / (1 + std::exp(-x));
+    constexpr float toFloatTruncated(uint16_t bfloat)
+    {
+        return std::bit_cast<float>(static_cast<uint32_t>(bfloat) << 16);
+    }
 }
 
-template <std::floating_point T>
-constexpr T gaussian(T x)
-{
-    return std::exp(-(x * x));
-}
+/*
+    16 bit floating point storage types for Vec / Mat elements. Values convert implicitly to
+    float, so arithmetic happens in float and is rounded once when stored back.
+    half is IEEE binary16 (11 bit significand, max 65504), bfloat16 keeps the float exponent
+    range with an 8 bit significand.
+*/
+struct half {
+    uint16_t bits = 0;
 
-template <std::floating_point T>
-constexpr T tanh(T x)
-{
-    return std::tanh(x);
-}
+    constexpr half() = default;
+    template <typename U>
+        requires std::is_arithmetic_v<U>
+    constexpr half(U value)
+    {
+        if consteval {
+            bits = Float16::fromFloat(static_cast<float>(value));
+        } else {
+#ifdef MATH_SIMD_F16C
+            bits = static_cast<uint16_t>(_cvtss_sh(static_cast<float>(value), _MM_FROUND_TO_NEAREST_INT));
+#else
+            bits = Float16::fromFloat(static_cast<float>(value));
+#endif
+        }
+    }
 
-template <std::floating_point T>
-constexpr T softplus(T x)
-{
-    return std::log(1 + std::exp(x));
-}
+    static constexpr half fromBits(uint16_t bits)
+    {
+        half result;
+        result.bits = bits;
+        return result;
+    }
 
-template <std::floating_point T>
-constexpr T leakyReLU(T x)
-{
-    return (x > 0) ? x : static_cast<T>(0.01) * x;
-}
+    constexpr operator float() const
+    {
+        if consteval {
+            return Float16::toFloat(bits);
+        } else {
+#ifdef MATH_SIMD_F16C
+            return _cvtsh_ss(bits);
+#else
+            return Float16::toFloat(bits);
+#endif
+        }
+    }
 
-struct Linear {
-    constexpr auto operator()(const auto& x) const
+    constexpr half& operator+=(float value)
     {
-        return Math::Activation::linear(x);
+        return *this = *this + value;
     }
-    friend std::ostream& operator<<(std::ostream& os, const Linear& activation [[maybe_unused]])
+    constexpr half& operator-=(float value)
     {
-        os << "Math::Activation::Linear";
-        return os;
+        return *this = *this - value;
     }
-};
-struct ReLU {
-    constexpr auto operator()(const auto& x) const
+    constexpr half& operator*=(float value)
     {
-        return Math::Activation::reLU(x);
+        return *this = *this * value;
     }
-    friend std::ostream& operator<<(std::ostream& os, const ReLU& activation [[maybe_unused]])
+    constexpr half& operator/=(float value)
     {
-        os << "Math::Activation::ReLU";
-        return os;
+        return *this = *this / value;
     }
 };
-struct Heaviside {
-    constexpr auto operator()(const auto& x) const
+
+struct bfloat16 {
+    uint16_t bits = 0;
+
+    constexpr bfloat16() = default;
+    template <typename U>
+        requires std::is_arithmetic_v<U>
+    constexpr bfloat16(U value)
+        : bits(Float16::fromFloatTruncated(static_cast<float>(value)))
     {
-        return Math::Activation::heaviside(x);
     }
-    friend std::ostream& operator<<(std::ostream& os, const Heaviside& activation [[maybe_unused]])
+
+    static constexpr bfloat16 fromBits(uint16_t bits)
     {
-        os << "Math::Activation::Heaviside";
-        return os;
+        bfloat16 result;
+        result.bits = bits;
+        return result;
     }
-};
-struct Sigmoid {
-    constexpr auto operator()(const auto& x) const
+
+    constexpr operator float() const
     {
-        return Math::Activation::sigmoid(x);
+        return Float16::toFloatTruncated(bits);
     }
-    friend std::ostream& operator<<(std::ostream& os, const Sigmoid& activation [[maybe_unused]])
+
+    constexpr bfloat16& operator+=(float value)
     {
-        os << "Math::Activation::Sigmoid";
-        return os;
+        return *this = *this + value;
     }
-};
-struct GELU {
-    constexpr auto operator()(const auto& x) const
+    constexpr bfloat16& operator-=(float value)
     {
-        return Math::Activation::gELU(x);
+        return *this = *this - value;
     }
-    friend std::ostream& operator<<(std::ostream& os, const GELU& activation [[maybe_unused]])
+    constexpr bfloat16& operator*=(float value)
     {
-        os << "Math::Activation::GELU";
-        return os;
+        return *this = *this * value;
     }
-};
-struct SiLU {
-    constexpr auto operator()(const auto& x) const
+    constexpr bfloat16& operator/=(float value)
     {
-        return Math::Activation::siLU(x);
+        return *this = *this / value;
     }
-    friend std::ostream& operator<<(std::ostream& os, const SiLU& activation [[maybe_unused]])
+};
+
+template <typename T>
+concept HalfPrecision = std::same_as<T, half> || std::same_as<T, bfloat16>;
+
+// Type sums and products of T are accumulated in, float for the 16 bit storage types.
+template <typename T>
+using Accumulator = std::conditional_t<HalfPrecision<T>, float, T>;
+
+/*
+    Bulk conversion between float and the 16 bit types. half uses F16C 8 lanes at a time
+    when the target has it, bfloat16 is a shift (and a rounding add on the way down).
+    to must hold at least from.size() elements.
+*/
+inline void convert(std::span<const half> from, std::span<float> to)
+{
+    assert(to.size() >= from.size());
+    size_t i = 0;
+#ifdef MATH_SIMD_F16C
+    for (; i + 8 <= from.size(); i += 8) {
+        const __m128i bits = _mm_loadu_si128(reinterpret_cast<const __m128i*>(from.data() + i));
+        _mm256_storeu_ps(to.data() + i, _mm256_cvtph_ps(bits));
+    }
+#endif
+    for (; i < from.size(); ++i) {
+        to[i] = from[i];
+    }
+}
+
+inline void convert(std::span<const float> from, std::span<half> to)
+{
+    assert(to.size() >= from.size());
+    size_t i = 0;
+#ifdef MATH_SIMD_F16C
+    for (; i + 8 <= from.size(); i += 8) {
+        const __m128i bits = _mm256_cvtps_ph(_mm256_loadu_ps(from.data() + i), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(to.data() + i), bits);
+    }
+#endif
+    for (; i < from.size(); ++i) {
+        to[i] = from[i];
+    }
+}
+
+inline void convert(std::span<const bfloat16> from, std::span<float> to)
+{
+    assert(to.size() >= from.size());
+    size_t i = 0;
+#ifdef MATH_SIMD_SSE
+    for (; i + 8 <= from.size(); i += 8) {
+        const __m128i bits = _mm_loadu_si128(reinterpret_cast<const __m128i*>(from.data() + i));
+        _mm_storeu_ps(to.data() + i, _mm_castsi128_ps(_mm_unpacklo_epi16(_mm_setzero_si128(), bits)));
+        _mm_storeu_ps(to.data() + i + 4, _mm_castsi128_ps(_mm_unpackhi_epi16(_mm_setzero_si128(), bits)));
+    }
+#endif
+    for (; i < from.size(); ++i) {
+        to[i] = from[i];
+    }
+}
+
+inline void convert(std::span<const float> from, std::span<bfloat16> to)
+{
+    assert(to.size() >= from.size());
+    size_t i = 0;
+#ifdef MATH_SIMD_SSE
+    // Rounds like Float16::fromFloatTruncated(), the arithmetic shift keeps the 16 bit
+    // results in range for the signed saturating pack.
+    auto round = [](__m128 value) {
+        const __m128i bits = _mm_castps_si128(value);
+        const __m128i lsb = _mm_and_si128(_mm_srli_epi32(bits, 16), _mm_set1_epi32(1));
+        const __m128i rounded = _mm_add_epi32(bits, _mm_add_epi32(lsb, _mm_set1_epi32(0x7fff)));
+        const __m128i quiet = _mm_or_si128(bits, _mm_set1_epi32(0x400000));
+        const __m128i nan = _mm_castps_si128(_mm_cmpunord_ps(value, value));
+        return _mm_srai_epi32(_mm_or_si128(_mm_and_si128(nan, quiet), _mm_andnot_si128(nan, rounded)), 16);
+    };
+    for (; i + 8 <= from.size(); i += 8) {
+        const __m128i low = round(_mm_loadu_ps(from.data() + i));
+        const __m128i high = round(_mm_loadu_ps(from.data() + i + 4));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(to.data() + i), _mm_packs_epi32(low, high));
+    }
+#endif
+    for (; i < from.size(); ++i) {
+        to[i] = from[i];
+    }
+}
+
+}
+
+// numeric_limits for the 16 bit storage types, as for float.
+template <>
+class std::numeric_limits<Math::half> {
+public:
+    static constexpr bool is_specialized = true;
+    static constexpr bool is_signed = true;
+    static constexpr bool is_integer = false;
+    static constexpr bool is_exact = false;
+    static constexpr bool has_infinity = true;
+    static constexpr bool has_quiet_NaN = true;
+    static constexpr bool is_iec559 = true;
+    static constexpr int digits = 11;
+    static constexpr int min_exponent = -13;
+    static constexpr int max_exponent = 16;
+    static constexpr Math::half min() noexcept
     {
-        os << "Math::Activation::SiLU";
-        return os;
+        return Math::half::fromBits(0x0400);
     }
-};
-struct Gaussian {
-    constexpr auto operator()(const auto& x) const
+    static constexpr Math::half max() noexcept
     {
-        return Math::Activation::gaussian(x);
+        return Math::half::fromBits(0x7bff);
     }
-    friend std::ostream& operator<<(std::ostream& os, const Gaussian& activation [[maybe_unused]])
+    static constexpr Math::half lowest() noexcept
     {
-        os << "Math::Activation::Gaussian";
-        return os;
+        return Math::half::fromBits(0xfbff);
     }
-};
-struct Tanh {
-    constexpr auto operator()(const auto& x) const
+    static constexpr Math::half epsilon() noexcept
     {
-        return Math::Activation::tanh(x);
+        return Math::half::fromBits(0x1400);
     }
-    friend std::ostream& operator<<(std::ostream& os, const Tanh& activation [[maybe_unused]])
+    static constexpr Math::half infinity() noexcept
     {
-        os << "Math::Activation::Tanh";
-        return os;
+        return Math::half::fromBits(0x7c00);
+    }
+    static constexpr Math::half quiet_NaN() noexcept
+    {
+        return Math::half::fromBits(0x7e00);
     }
 };
-struct Softplus {
-    constexpr auto operator()(const auto& x) const
+
+template <>
+class std::numeric_limits<Math::bfloat16> {
+public:
+    static constexpr bool is_specialized = true;
+    static constexpr bool is_signed = true;
+    static constexpr bool is_integer = false;
+    static constexpr bool is_exact = false;
+    static constexpr bool has_infinity = true;
+    static constexpr bool has_quiet_NaN = true;
+    static constexpr bool is_iec559 = false;
+    static constexpr int digits = 8;
+    static constexpr int min_exponent = -125;
+    static constexpr int max_exponent = 128;
+    static constexpr Math::bfloat16 min() noexcept
     {
-        return Math::Activation::softplus(x);
+        return Math::bfloat16::fromBits(0x0080);
     }
-    friend std::ostream& operator<<(std::ostream& os, const Softplus& activation [[maybe_unused]])
+    static constexpr Math::bfloat16 max() noexcept
     {
-        os << "Math::Activation::Softplus";
-        return os;
+        return Math::bfloat16::fromBits(0x7f7f);
     }
-};
-struct LeakyReLU {
-    constexpr auto operator()(const auto& x) const
+    static constexpr Math::bfloat16 lowest() noexcept
     {
-        return Math::Activation::leakyReLU(x);
+        return Math::bfloat16::fromBits(0xff7f);
     }
-    friend std::ostream& operator<<(std::ostream& os, const LeakyReLU& activation [[maybe_unused]])
+    static constexpr Math::bfloat16 epsilon() noexcept
     {
-        os << "Math::Activation::LeakyReLU";
-        return os;
+        return Math::bfloat16::fromBits(0x3c00);
+    }
+    static constexpr Math::bfloat16 infinity() noexcept
+    {
+        return Math::bfloat16::fromBits(0x7f80);
+    }
+    static constexpr Math::bfloat16 quiet_NaN() noexcept
+    {
+        return Math::bfloat16::fromBits(0x7fc0);
     }
 };
 
-}
 
-// Linear Algebra (Graphics and 3D)
-namespace Math::LinearAlgebra {
-// Type declarations
-template <size_t N, typename T = float>
-class Pos;
-template <size_t N, typename T = float>
-class Vec;
-template <size_t N, typename T = float>
-class Ray;
-template <size_t R, size_t C, typename T = float>
-class Mat;
+// SIMD primitives (runtime only, instruction set is chosen at compile time)
+namespace Math::Simd {
 
-template <size_t N, typename T>
-class Vec {
-public:
-    T data[N];
+/*
+    W lanes of T. The primary template is the portable scalar fallback,
+    the specialisations below map onto SSE/AVX2 registers when available.
+*/
+template <typename T, size_t W>
+struct Pack {
+    static constexpr size_t width = W;
+    T v[W] {};
 
-    constexpr Vec()
-        : data()
+    static Pack zero()
     {
+        return broadcast(T {});
     }
-
-    template <typename... Args>
-    constexpr Vec(Args... args)
-        : data { static_cast<T>(args)... }
+    static Pack broadcast(T x)
     {
-        static_assert(sizeof...(args) == N);
+        Pack p;
+        std::fill(p.v, p.v + W, x);
+        return p;
     }
-
-    constexpr explicit Vec(const Pos<N, T>& pos);
-    constexpr explicit operator Pos<N, T>() const;
-
-    constexpr auto begin() -> T*
+    static Pack load(const T* ptr)
     {
-        return data;
+        Pack p;
+        std::copy(ptr, ptr + W, p.v);
+        return p;
     }
-    constexpr auto begin() const -> const T*
+    // Loads the first n lanes, the remaining lanes are zero.
+    static Pack loadPartial(const T* ptr, size_t n)
     {
-        return data;
+        Pack p = zero();
+        std::copy(ptr, ptr + n, p.v);
+        return p;
     }
-    constexpr auto cbegin() const -> const T*
+    void store(T* ptr) const
     {
-        return data;
+        std::copy(v, v + W, ptr);
     }
-    constexpr auto end() -> T*
+    void storePartial(T* ptr, size_t n) const
     {
-        return data + N;
+        std::copy(v, v + n, ptr);
     }
-    constexpr auto end() const -> const T*
+
+    friend Pack operator+(const Pack& a, const Pack& b)
     {
-        return data + N;
+        Pack p;
+        std::ranges::transform(a.v, b.v, p.v, std::plus {});
+        return p;
     }
-    constexpr auto cend() const -> const T*
+    friend Pack operator-(const Pack& a, const Pack& b)
     {
-        return data + N;
+        Pack p;
+        std::ranges::transform(a.v, b.v, p.v, std::minus {});
+        return p;
     }
-
-    template <size_t S>
-    constexpr bool operator==(const Vec<S, T>& other) const
+    friend Pack operator*(const Pack& a, const Pack& b)
     {
-        constexpr float TOLERANCE = static_cast<float>(1e-6);
-        auto abs = [](auto x) { return (x < 0) ? -x : x; };
-
-        if constexpr (S != N) {
-            return false;
-        } else {
-            return std::ranges::equal(*this, other, [&](const T& lhs, const T& rhs) { return abs(lhs - rhs) < TOLERANCE; });
-        }
+        Pack p;
+        std::ranges::transform(a.v, b.v, p.v, std::multiplies {});
+        return p;
     }
-
-    template <size_t S>
-    constexpr bool operator!=(const Vec<S, T>& other) const
+    friend Pack operator/(const Pack& a, const Pack& b)
     {
-        return !(*this == other);
+        Pack p;
+        std::ranges::transform(a.v, b.v, p.v, std::divides {});
+        return p;
     }
-
-    constexpr Vec<N, T> operator+(const Vec<N, T>& other) const
+    // a * b + c
+    friend Pack mulAdd(const Pack& a, const Pack& b, const Pack& c)
     {
-        Vec<N, T> result = *this;
-        std::ranges::transform(*this, other, result.begin(), std::plus {});
-        return result;
+        Pack p;
+        for (size_t i = 0; i < W; ++i) {
+            p.v[i] = a.v[i] * b.v[i] + c.v[i];
+        }
+        return p;
     }
-    constexpr Vec<N, T> operator-(const Vec<N, T>& other) const
+    friend Pack min(const Pack& a, const Pack& b)
     {
-        Vec<N, T> result = *this;
-        std::ranges::transform(*this, other, result.begin(), std::minus {});
-        return result;
+        Pack p;
+        std::ranges::transform(a.v, b.v, p.v, [](T x, T y) { return std::min(x, y); });
+        return p;
     }
-    constexpr Vec<N, T> operator/(const Vec<N, T>& other) const
+    friend Pack max(const Pack& a, const Pack& b)
     {
-        Vec<N, T> result = *this;
-        std::ranges::transform(*this, other, result.begin(), std::divides {});
-        return result;
+        Pack p;
+        std::ranges::transform(a.v, b.v, p.v, [](T x, T y) { return std::max(x, y); });
+        return p;
     }
-    constexpr Vec<N, T> operator*(const Vec<N, T>& other) const
+    friend Pack sqrt(const Pack& a)
     {
-        Vec<N, T> result = *this;
-        std::ranges::transform(*this, other, result.begin(), std::multiplies {});
-        return result;
+        Pack p;
+        std::ranges::transform(a.v, p.v, [](T x) { return static_cast<T>(std::sqrt(x)); });
+        return p;
     }
-
-    constexpr Vec<N, T> operator/(T scalar) const
+    // Approximate 1 / sqrt(a), exact here.
+    friend Pack rsqrtEstimate(const Pack& a)
     {
-        Vec<N, T> result = *this;
-        std::ranges::transform(*this, result.begin(), [&](auto& e) { return e / scalar; });
-        return result;
+        Pack p;
+        std::ranges::transform(a.v, p.v, [](T x) { return static_cast<T>(1 / std::sqrt(x)); });
+        return p;
     }
-    constexpr Vec<N, T> operator*(T scalar) const
+    friend T reduceAdd(const Pack& a)
     {
-        Vec<N, T> result = *this;
-        for (auto& e : result) {
-            e *= scalar;
-        }
-        return result;
+        return std::accumulate(a.v, a.v + W, T {});
     }
 
-    friend constexpr Vec<N, T> operator*(T scalar, const Vec<N, T>& vector)
+    // Per lane comparison result, consumed by select() and bitmask().
+    struct Mask {
+        bool v[W] {};
+    };
+    friend Mask operator<(const Pack& a, const Pack& b)
     {
-        return vector * scalar;
+        Mask m;
+        std::ranges::transform(a.v, b.v, m.v, std::less {});
+        return m;
     }
-    friend constexpr Vec<N, T> operator/(T scalar, const Vec<N, T>& vector)
+    friend Mask operator>(const Pack& a, const Pack& b)
     {
-        return vector / scalar;
+        return b < a;
     }
-
-    constexpr Vec<N, T> operator-() const
+    friend Mask operator<=(const Pack& a, const Pack& b)
     {
-        return -1 * (*this);
+        Mask m;
+        std::ranges::transform(a.v, b.v, m.v, std::less_equal {});
+        return m;
     }
-
-    constexpr T& operator[](size_t index)
+    friend Mask operator>=(const Pack& a, const Pack& b)
     {
-        assert(index < N);
-        return data[index];
+        return b <= a;
     }
-    constexpr const T& operator[](size_t index) const
+    friend Mask operator&(const Mask& a, const Mask& b)
     {
-        assert(index < N);
-        return data[index];
+        Mask m;
+        std::ranges::transform(a.v, b.v, m.v, std::logical_and {});
+        return m;
     }
-
-    constexpr T getLengthSquared() const
+    // Lane wise mask ? a : b
+    friend Pack select(const Mask& mask, const Pack& a, const Pack& b)
     {
-        return std::transform_reduce(
-            cbegin(), cend(),
-            cbegin(),
-            T {},
-            std::plus {},
-            std::multiplies {});
+        Pack p;
+        for (size_t i = 0; i < W; ++i) {
+            p.v[i] = mask.v[i] ? a.v[i] : b.v[i];
+        }
+        return p;
     }
-    constexpr T getLength() const
+    // Bit i is set when lane i of the mask is set.
+    friend unsigned bitmask(const Mask& mask)
     {
-        return Math::sqrt(getLengthSquared());
+        unsigned bits = 0;
+        for (size_t i = 0; i < W; ++i) {
+            bits |= static_cast<unsigned>(mask.v[i]) << i;
+        }
+        return bits;
     }
 
-    constexpr Vec<N, T> getNormalised() const
+    // Lanes rounded to the nearest integer.
+    friend Pack roundToInt(const Pack& a)
     {
-        return (*this) / getLength();
+        Pack p;
+        std::ranges::transform(a.v, p.v, [](T x) { return static_cast<T>(std::nearbyint(x)); });
+        return p;
     }
-
-    constexpr size_t size() const
+    // 2^n for integer valued lanes n.
+    friend Pack exp2i(const Pack& n)
     {
-        return N;
+        Pack p;
+        std::ranges::transform(n.v, p.v, [](T x) { return static_cast<T>(std::ldexp(T { 1 }, static_cast<int>(x))); });
+        return p;
     }
-
-    friend std::ostream& operator<<(std::ostream& os, const Vec<N, T>& vec)
+    // Splits positive lanes into a mantissa in [0.5, 1) (returned) and a power of two exponent.
+    friend Pack frexp(const Pack& a, Pack& exponent)
     {
-        os << "{ ";
-        for (const auto& e : vec) {
-            os << e << " ";
+        Pack p;
+        for (size_t i = 0; i < W; ++i) {
+            int e = 0;
+            p.v[i] = static_cast<T>(std::frexp(a.v[i], &e));
+            exponent.v[i] = static_cast<T>(e);
         }
-        os << '}';
-        return os;
+        return p;
+    }
+    // table[index] for integer valued, non negative lanes.
+    friend Pack gather(const T* table, const Pack& index)
+    {
+        Pack p;
+        std::ranges::transform(index.v, p.v, [table](T i) { return table[static_cast<size_t>(i)]; });
+        return p;
+    }
+    // table[index] and table[index + 1] (neighbours) for integer valued, non negative lanes.
+    friend Pack gatherPair(const T* table, const Pack& index, Pack& neighbours)
+    {
+        neighbours = gather(table + 1, index);
+        return gather(table, index);
     }
 };
 
-template <size_t N, typename T>
-class Pos {
-public:
-    T data[N];
+#ifdef MATH_SIMD_SSE
+template <>
+struct Pack<float, 4> {
+    static constexpr size_t width = 4;
+    __m128 v;
 
-    constexpr auto begin() -> T*
+    static Pack zero()
     {
-        return data;
+        return { _mm_setzero_ps() };
     }
-    constexpr auto begin() const -> const T*
+    static Pack broadcast(float x)
     {
-        return data;
+        return { _mm_set1_ps(x) };
     }
-    constexpr auto cbegin() const -> const T*
+    static Pack load(const float* ptr)
     {
-        return data;
+        return { _mm_loadu_ps(ptr) };
     }
-    constexpr auto end() -> T*
+    static Pack loadPartial(const float* ptr, size_t n)
     {
-        return data + N;
+        switch (n) {
+        case 0:
+            return zero();
+        case 1:
+            return { _mm_load_ss(ptr) };
+        case 2:
+            return { _mm_setr_ps(ptr[0], ptr[1], 0.0f, 0.0f) };
+        case 3:
+            return { _mm_setr_ps(ptr[0], ptr[1], ptr[2], 0.0f) };
+        default:
+            return load(ptr);
+        }
     }
-    constexpr auto end() const -> const T*
+    void store(float* ptr) const
     {
-        return data + N;
+        _mm_storeu_ps(ptr, v);
     }
-    constexpr auto cend() const -> const T*
+    void storePartial(float* ptr, size_t n) const
     {
-        return data + N;
+        alignas(16) float lanes[4];
+        _mm_store_ps(lanes, v);
+        std::copy(lanes, lanes + std::min<size_t>(n, 4), ptr);
     }
 
-    constexpr explicit operator Vec<N, T>() const;
-    constexpr bool operator==(const Pos<N, T>& other) const
+    friend Pack operator+(const Pack& a, const Pack& b)
     {
-        constexpr float TOLERANCE = static_cast<float>(1e-6);
-        auto abs = [](auto x) { return (x < 0) ? -x : x; };
-        return std::ranges::equal(*this, other, [&](const T& lhs, const T& rhs) { return abs(lhs - rhs) < TOLERANCE; });
+        return { _mm_add_ps(a.v, b.v) };
     }
-    constexpr T& operator[](size_t index)
+    friend Pack operator-(const Pack& a, const Pack& b)
     {
-        return data[index];
+        return { _mm_sub_ps(a.v, b.v) };
     }
-    constexpr const T& operator[](size_t index) const
+    friend Pack operator*(const Pack& a, const Pack& b)
     {
-        return data[index];
+        return { _mm_mul_ps(a.v, b.v) };
     }
-};
-
-template <size_t N, typename T>
-constexpr Pos<N, T>::operator Vec<N, T>() const
-{
-    Vec<N, T> vec;
-    std::ranges::copy(this->data, this->data + N, vec.begin());
-    return vec;
-}
-template <size_t N, typename T>
-constexpr Vec<N, T>::operator Pos<N, T>() const
-{
-    Pos<N, T> pos;
-    std::ranges::copy(this->cbegin(), this->cend(), pos.data);
-    return pos;
-}
-template <size_t N, typename T>
-constexpr Vec<N, T>::Vec(const Pos<N, T>& pos)
-{
-    std::ranges::copy(pos.data, pos.data + N, this->begin());
-}
-
-template <size_t N, typename T>
-class Ray {
-private:
-    Pos<N, T> m_origin;
-    Vec<N, T> m_direction;
-
-public:
-    constexpr Ray()
-        : m_origin()
-        , m_direction()
+    friend Pack operator/(const Pack& a, const Pack& b)
     {
+        return { _mm_div_ps(a.v, b.v) };
     }
-    constexpr Ray(const Pos<N, T>& origin, const Vec<N, T>& direction)
-        : m_origin(origin)
-        , m_direction(direction.getNormalised())
+    friend Pack mulAdd(const Pack& a, const Pack& b, const Pack& c)
     {
+#ifdef MATH_SIMD_AVX2
+        return { _mm_fmadd_ps(a.v, b.v, c.v) };
+#else
+        return { _mm_add_ps(_mm_mul_ps(a.v, b.v), c.v) };
+#endif
     }
-    constexpr Ray& operator=(const Ray<N, T>& other)
+    friend Pack min(const Pack& a, const Pack& b)
     {
-        m_origin = other.m_origin;
-        m_direction = other.m_direction;
-        return *this;
+        return { _mm_min_ps(a.v, b.v) };
     }
-    constexpr auto getOrigin() const -> const Pos<N, T>&
+    friend Pack max(const Pack& a, const Pack& b)
     {
-        return m_origin;
+        return { _mm_max_ps(a.v, b.v) };
     }
-    constexpr auto getDirection() const -> const Vec<N, T>&
+    friend Pack sqrt(const Pack& a)
     {
-        return m_direction;
+        return { _mm_sqrt_ps(a.v) };
     }
-    constexpr void setOrigin(const Pos<N, T>& origin)
+    // Approximate 1 / sqrt(a), relative error below 1.5 * 2^-12.
+    friend Pack rsqrtEstimate(const Pack& a)
     {
-        m_origin = origin;
+        return { _mm_rsqrt_ps(a.v) };
     }
-    constexpr void setDirection(const Vec<N, T>& direction)
+    friend float reduceAdd(const Pack& a)
     {
-        m_direction = direction.getNormalised();
+        __m128 shuffled = _mm_shuffle_ps(a.v, a.v, _MM_SHUFFLE(2, 3, 0, 1));
+        __m128 sums = _mm_add_ps(a.v, shuffled);
+        shuffled = _mm_movehl_ps(shuffled, sums);
+        sums = _mm_add_ss(sums, shuffled);
+        return _mm_cvtss_f32(sums);
     }
-    constexpr LinearAlgebra::Pos<N, T> getPointAlongRay(T t) const
+
+    struct Mask {
+        __m128 v;
+    };
+    friend Mask operator<(const Pack& a, const Pack& b)
     {
-        Pos<N, T> point;
-        for (size_t i = 0; i < N; i++) {
-            point[i] = m_origin[i] + (m_direction[i] * t);
-        }
-        return point;
+        return { _mm_cmplt_ps(a.v, b.v) };
     }
-
-    friend std::ostream& operator<<(std::ostream& os, const Ray<N, T>& ray)
+    friend Mask operator>(const Pack& a, const Pack& b)
     {
-        os << "origin: " << static_cast<LinearAlgebra::Vec<N, T>>(ray.getOrigin()) << ", direction: " << ray.getDirection();
-        return os;
+        return { _mm_cmpgt_ps(a.v, b.v) };
     }
-};
-
-template <size_t R, size_t C, typename T>
-class Mat {
-public:
-    static constexpr size_t N = R * C;
-    T data[N];
-    constexpr Mat()
-        : data()
+    friend Mask operator<=(const Pack& a, const Pack& b)
     {
+        return { _mm_cmple_ps(a.v, b.v) };
     }
-    constexpr Mat(T fill_value)
+    friend Mask operator>=(const Pack& a, const Pack& b)
     {
-        std::fill(data, data + N, fill_value);
+        return { _mm_cmpge_ps(a.v, b.v) };
+    }
+    friend Mask operator&(const Mask& a, const Mask& b)
+    {
+        return { _mm_and_ps(a.v, b.v) };
+    }
+    friend Pack select(const Mask& mask, const Pack& a, const Pack& b)
+    {
+        return { _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v)) };
+    }
+    friend unsigned bitmask(const Mask& mask)
+    {
+        return static_cast<unsigned>(_mm_movemask_ps(mask.v));
     }
 
-    constexpr Mat(const std::initializer_list<std::initializer_list<T>>& elements)
+    // Floats from 2^23 up are integers already and may not fit an int32, those lanes (and NaN) pass through.
+    friend Pack roundToInt(const Pack& a)
     {
-        // C++23
-        // auto flattened = std::views::join(elements);
-        // std::ranges::copy(flattened, data);
+        const __m128 integral = _mm_cmpnlt_ps(_mm_andnot_ps(_mm_set1_ps(-0.0f), a.v), _mm_set1_ps(8388608.0f));
+        const __m128 rounded = _mm_cvtepi32_ps(_mm_cvtps_epi32(a.v));
+        return { _mm_or_ps(_mm_and_ps(integral, a.v), _mm_andnot_ps(integral, rounded)) };
+    }
+    friend Pack exp2i(const Pack& n)
+    {
+        return { _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(_mm_cvtps_epi32(n.v), _mm_set1_epi32(127)), 23)) };
+    }
+    friend Pack frexp(const Pack& a, Pack& exponent)
+    {
+        const __m128i bits = _mm_castps_si128(a.v);
+        exponent.v = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(126)));
+        const __m128 mantissa_bits = _mm_castsi128_ps(_mm_set1_epi32(static_cast<int>(0x807FFFFFu)));
+        return { _mm_or_ps(_mm_and_ps(a.v, mantissa_bits), _mm_set1_ps(0.5f)) };
+    }
+    friend Pack gather(const float* table, const Pack& index)
+    {
+#ifdef MATH_SIMD_AVX2
+        return { _mm_i32gather_ps(table, _mm_cvtps_epi32(index.v), 4) };
+#else
+        alignas(16) int32_t i[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(i), _mm_cvtps_epi32(index.v));
+        return { _mm_setr_ps(table[i[0]], table[i[1]], table[i[2]], table[i[3]]) };
+#endif
+    }
+    friend Pack gatherPair(const float* table, const Pack& index, Pack& neighbours)
+    {
+        neighbours = gather(table + 1, index);
+        return gather(table, index);
+    }
+};
 
-        // lowkey hate this.
-        size_t i = 0;
-        for (const auto& column : elements) {
-            for (const auto& element : column) {
-                data[i] = element;
-                i++;
-            }
+#ifdef MATH_SIMD_AVX2
+template <>
+struct Pack<float, 8> {
+    static constexpr size_t width = 8;
+    __m256 v;
+
+    static Pack zero()
+    {
+        return { _mm256_setzero_ps() };
+    }
+    static Pack broadcast(float x)
+    {
+        return { _mm256_set1_ps(x) };
+    }
+    static Pack load(const float* ptr)
+    {
+        return { _mm256_loadu_ps(ptr) };
+    }
+    static Pack loadPartial(const float* ptr, size_t n)
+    {
+        if (n >= 8) {
+            return load(ptr);
         }
+        alignas(32) float lanes[8] = {};
+        std::copy(ptr, ptr + n, lanes);
+        return { _mm256_load_ps(lanes) };
+    }
+    void store(float* ptr) const
+    {
+        _mm256_storeu_ps(ptr, v);
+    }
+    void storePartial(float* ptr, size_t n) const
+    {
+        alignas(32) float lanes[8];
+        _mm256_store_ps(lanes, v);
+        std::copy(lanes, lanes + std::min<size_t>(n, 8), ptr);
     }
 
-    constexpr auto begin() -> T*
+    friend Pack operator+(const Pack& a, const Pack& b)
     {
-        return data;
+        return { _mm256_add_ps(a.v, b.v) };
     }
-    constexpr auto begin() const -> const T*
+    friend Pack operator-(const Pack& a, const Pack& b)
     {
-        return data;
+        return { _mm256_sub_ps(a.v, b.v) };
     }
-    constexpr auto cbegin() const -> const T*
+    friend Pack operator*(const Pack& a, const Pack& b)
     {
-        return data;
+        return { _mm256_mul_ps(a.v, b.v) };
     }
-    constexpr auto end() -> T*
+    friend Pack operator/(const Pack& a, const Pack& b)
     {
-        return data + N;
+        return { _mm256_div_ps(a.v, b.v) };
     }
-    constexpr auto end() const -> const T*
+    friend Pack mulAdd(const Pack& a, const Pack& b, const Pack& c)
     {
-        return data + N;
+        return { _mm256_fmadd_ps(a.v, b.v, c.v) };
     }
-    constexpr auto cend() const -> const T*
+    friend Pack min(const Pack& a, const Pack& b)
     {
-        return data + N;
+        return { _mm256_min_ps(a.v, b.v) };
     }
-    constexpr T* operator[](size_t row)
+    friend Pack max(const Pack& a, const Pack& b)
     {
-        assert(row < R);
-        return data + (row * C);
+        return { _mm256_max_ps(a.v, b.v) };
     }
-    constexpr const T* operator[](size_t row) const
+    friend Pack sqrt(const Pack& a)
     {
-        assert(row < R);
-        return data + (row * C);
+        return { _mm256_sqrt_ps(a.v) };
     }
-
-    template <size_t R2, size_t C2>
-    constexpr bool operator==(const Mat<R2, C2, T>& other) const
+    // Approximate 1 / sqrt(a), relative error below 1.5 * 2^-12.
+    friend Pack rsqrtEstimate(const Pack& a)
     {
-        constexpr float TOLERANCE = static_cast<float>(1e-4);
-        auto abs = [](auto x) { return (x < 0) ? -x : x; };
+        return { _mm256_rsqrt_ps(a.v) };
+    }
+    friend float reduceAdd(const Pack& a)
+    {
+        return reduceAdd(Pack<float, 4> { _mm_add_ps(_mm256_castps256_ps128(a.v), _mm256_extractf128_ps(a.v, 1)) });
+    }
 
-        if constexpr (R != R2 || C != C2) {
-            return false;
-        } else {
-            return std::ranges::equal(*this, other, [&](const T& lhs, const T& rhs) { return abs(lhs - rhs) < TOLERANCE; });
-        }
+    struct Mask {
+        __m256 v;
+    };
+    friend Mask operator<(const Pack& a, const Pack& b)
+    {
+        return { _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ) };
     }
-    template <size_t R2, size_t C2>
-    constexpr bool operator!=(const Mat<R2, C2, T>& other) const
+    friend Mask operator>(const Pack& a, const Pack& b)
     {
-        return !(*this == other);
+        return { _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ) };
+    }
+    friend Mask operator<=(const Pack& a, const Pack& b)
+    {
+        return { _mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ) };
+    }
+    friend Mask operator>=(const Pack& a, const Pack& b)
+    {
+        return { _mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ) };
+    }
+    friend Mask operator&(const Mask& a, const Mask& b)
+    {
+        return { _mm256_and_ps(a.v, b.v) };
+    }
+    friend Pack select(const Mask& mask, const Pack& a, const Pack& b)
+    {
+        return { _mm256_blendv_ps(b.v, a.v, mask.v) };
+    }
+    friend unsigned bitmask(const Mask& mask)
+    {
+        return static_cast<unsigned>(_mm256_movemask_ps(mask.v));
     }
 
-    constexpr Mat<R, C, T> operator*(T scalar)
+    // Floats from 2^23 up are integers already and may not fit an int32, those lanes (and NaN) pass through.
+    friend Pack roundToInt(const Pack& a)
     {
-        Mat<R, C, T> out;
-        std::ranges::transform(*this, out.begin(), [&](const T& e) { return e * scalar; });
-        return out;
+        const __m256 integral = _mm256_cmp_ps(_mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v), _mm256_set1_ps(8388608.0f), _CMP_NLT_UQ);
+        return { _mm256_blendv_ps(_mm256_cvtepi32_ps(_mm256_cvtps_epi32(a.v)), a.v, integral) };
+    }
+    friend Pack exp2i(const Pack& n)
+    {
+        return { _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(n.v), _mm256_set1_epi32(127)), 23)) };
+    }
+    friend Pack frexp(const Pack& a, Pack& exponent)
+    {
+        const __m256i bits = _mm256_castps_si256(a.v);
+        exponent.v = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(126)));
+        const __m256 mantissa_bits = _mm256_castsi256_ps(_mm256_set1_epi32(static_cast<int>(0x807FFFFFu)));
+        return { _mm256_or_ps(_mm256_and_ps(a.v, mantissa_bits), _mm256_set1_ps(0.5f)) };
     }
+    friend Pack gather(const float* table, const Pack& index)
+    {
+        return { _mm256_i32gather_ps(table, _mm256_cvtps_epi32(index.v), 4) };
+    }
+    // Each adjacent pair is one 64 bit gather lane, half the gathered elements of two gather() calls.
+    friend Pack gatherPair(const float* table, const Pack& index, Pack& neighbours)
+    {
+        const __m256i i = _mm256_cvtps_epi32(index.v);
+        const __m256 lo = _mm256_castsi256_ps(_mm256_i32gather_epi64(reinterpret_cast<const long long*>(table), _mm256_castsi256_si128(i), 4));
+        const __m256 hi = _mm256_castsi256_ps(_mm256_i32gather_epi64(reinterpret_cast<const long long*>(table), _mm256_extracti128_si256(i, 1), 4));
+        // lo = a0 b0 a1 b1 | a2 b2 a3 b3, hi = a4 b4 a5 b5 | a6 b6 a7 b7
+        const __m256 a = _mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0));
+        const __m256 b = _mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1));
+        // a0 a1 a4 a5 a2 a3 a6 a7 -> a0 .. a7
+        neighbours.v = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(b), _MM_SHUFFLE(3, 1, 2, 0)));
+        return { _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(a), _MM_SHUFFLE(3, 1, 2, 0))) };
+    }
+};
+#else
+// Without AVX2 an 8 lane pack is a pair of SSE registers.
+template <>
+struct Pack<float, 8> {
+    using Half = Pack<float, 4>;
+    static constexpr size_t width = 8;
+    Half lo;
+    Half hi;
 
-    template <size_t R2, size_t C2>
-    constexpr Mat<R, C2> operator*(const Mat<R2, C2, T>& b) const
+    static Pack zero()
     {
-        const auto& a = *this;
-        Mat<R, C2, T> c {};
-        for (size_t row = 0; row < R; ++row) {
-            for (size_t col = 0; col < C2; ++col) {
-                T value = {};
-                for (size_t i = 0; i < C; ++i) {
-                    value += a[row][i] * b[i][col];
-                }
-                c[row][col] = value;
-            }
+        return { Half::zero(), Half::zero() };
+    }
+    static Pack broadcast(float x)
+    {
+        return { Half::broadcast(x), Half::broadcast(x) };
+    }
+    static Pack load(const float* ptr)
+    {
+        return { Half::load(ptr), Half::load(ptr + 4) };
+    }
+    static Pack loadPartial(const float* ptr, size_t n)
+    {
+        if (n <= 4) {
+            return { Half::loadPartial(ptr, n), Half::zero() };
         }
-        return c;
+        return { Half::load(ptr), Half::loadPartial(ptr + 4, n - 4) };
     }
-
-    friend std::ostream& operator<<(std::ostream& os, const Mat<R, C, T>& mat)
+    void store(float* ptr) const
     {
-        os << '[';
-        for (size_t i = 0; i < R; ++i) {
-            os << "{ ";
-            for (size_t j = 0; j < C; ++j) {
-                os << mat[i][j] << ' ';
-            }
-            os << '}';
+        lo.store(ptr);
+        hi.store(ptr + 4);
+    }
+    void storePartial(float* ptr, size_t n) const
+    {
+        if (n <= 4) {
+            lo.storePartial(ptr, n);
+        } else {
+            lo.store(ptr);
+            hi.storePartial(ptr + 4, n - 4);
         }
-        os << ']';
-        return os;
     }
-};
-struct Radian;
-
-template <typename T = float>
-class Quat {
-private:
-    static constexpr size_t W = 0;
-    static constexpr size_t X = 1;
-    static constexpr size_t Y = 2;
-    static constexpr size_t Z = 3;
 
-public:
-    Vec<4, T> data;
-    constexpr Quat(Radians x_rotation, Radians y_rotation, Radians z_rotation)
+    friend Pack operator+(const Pack& a, const Pack& b)
     {
-        // T cr = Math::cos<T>(static_cast<T>(x_rotation.angle / 2)); // roll
-        // T cp = Math::cos<T>(static_cast<T>(y_rotation.angle / 2)); // pitch
-        // T cy = Math::cos<T>(static_cast<T>(z_rotation.angle / 2)); // yaw
-
-        // T sr = Math::sin<T>(static_cast<T>(x_rotation.angle / 2)); // roll
-        // T sp = Math::sin<T>(static_cast<T>(y_rotation.angle / 2)); // pitch
-        // T sy = Math::sin<T>(static_cast<T>(z_rotation.angle / 2)); // yaw
-
-        // data[W] = cr * cp * cy + sr * sp * sy;
-        // data[X] = sr * cp * cy - cr * sp * sy;
-        // data[Y] = cr * sp * cy + sr * cp * sy;
-        // data[Z] = cr * cp * sy - sr * sp * cy;
-        Quat<T> z { Math::cos(static_cast<T>(z_rotation.angle / 2)), 0, 0, Math::sin(static_cast<T>(y_rotation.angle / 2)) };
-        Quat<T> y { Math::cos(static_cast<T>(y_rotation.angle / 2)), 0, Math::sin(static_cast<T>(y_rotation.angle / 2)), 0 };
-        Quat<T> x { Math::cos(static_cast<T>(x_rotation.angle / 2)), Math::sin(static_cast<T>(x_rotation.angle / 2)), 0, 0 };
-        *this = z * y * x;
+        return { a.lo + b.lo, a.hi + b.hi };
     }
-
-    constexpr Quat()
+    friend Pack operator-(const Pack& a, const Pack& b)
     {
-        data[W] = 1;
+        return { a.lo - b.lo, a.hi - b.hi };
     }
-    constexpr Quat(T w, T x, T y, T z)
+    friend Pack operator*(const Pack& a, const Pack& b)
     {
-        data[W] = w;
-        data[X] = x;
-        data[Y] = y;
-        data[Z] = z;
+        return { a.lo * b.lo, a.hi * b.hi };
     }
-
-    constexpr Quat(T w, Vec<3, float> vec)
+    friend Pack operator/(const Pack& a, const Pack& b)
     {
-        data[W] = w;
-        data[X] = vec[0];
-        data[Y] = vec[1];
-        data[Z] = vec[2];
+        return { a.lo / b.lo, a.hi / b.hi };
     }
-
-    constexpr Quat<T> operator*(const Quat<T>& other) const
+    friend Pack mulAdd(const Pack& a, const Pack& b, const Pack& c)
     {
-        const auto& w1 = this->data[W];
-        const auto& x1 = this->data[X];
-        const auto& y1 = this->data[Y];
-        const auto& z1 = this->data[Z];
-        const auto& w2 = other.data[W];
-        const auto& x2 = other.data[X];
-        const auto& y2 = other.data[Y];
-        const auto& z2 = other.data[Z];
+        return { mulAdd(a.lo, b.lo, c.lo), mulAdd(a.hi, b.hi, c.hi) };
+    }
+    friend Pack min(const Pack& a, const Pack& b)
+    {
+        return { min(a.lo, b.lo), min(a.hi, b.hi) };
+    }
+    friend Pack max(const Pack& a, const Pack& b)
+    {
+        return { max(a.lo, b.lo), max(a.hi, b.hi) };
+    }
+    friend Pack sqrt(const Pack& a)
+    {
+        return { sqrt(a.lo), sqrt(a.hi) };
+    }
+    friend Pack rsqrtEstimate(const Pack& a)
+    {
+        return { rsqrtEstimate(a.lo), rsqrtEstimate(a.hi) };
+    }
+    friend float reduceAdd(const Pack& a)
+    {
+        return reduceAdd(a.lo + a.hi);
+    }
 
-        return Quat<T> {
-            w1 * w2 - x1 * x2 - y1 * y2 - z1 * z2,
-            w1 * x2 + x1 * w2 + y1 * z2 - z1 * y2,
-            w1 * y2 - x1 * z2 + y1 * w2 + z1 * x2,
-            w1 * z2 + x1 * y2 - y1 * x2 + z1 * w2
-        };
+    struct Mask {
+        Half::Mask lo;
+        Half::Mask hi;
+    };
+    friend Mask operator<(const Pack& a, const Pack& b)
+    {
+        return { a.lo < b.lo, a.hi < b.hi };
     }
-    constexpr Vec<3, T> getVec() const
+    friend Mask operator>(const Pack& a, const Pack& b)
     {
-        return Vec<3, T> {
-            data[X] / data[W],
-            data[Y] / data[W],
-            data[Z] / data[W],
-        };
+        return { a.lo > b.lo, a.hi > b.hi };
     }
-    constexpr bool operator==(const Quat<T>& other) const
+    friend Mask operator<=(const Pack& a, const Pack& b)
+    {
+        return { a.lo <= b.lo, a.hi <= b.hi };
+    }
+    friend Mask operator>=(const Pack& a, const Pack& b)
+    {
+        return { a.lo >= b.lo, a.hi >= b.hi };
+    }
+    friend Mask operator&(const Mask& a, const Mask& b)
+    {
+        return { a.lo & b.lo, a.hi & b.hi };
+    }
+    friend Pack select(const Mask& mask, const Pack& a, const Pack& b)
+    {
+        return { select(mask.lo, a.lo, b.lo), select(mask.hi, a.hi, b.hi) };
+    }
+    friend unsigned bitmask(const Mask& mask)
     {
-        return std::ranges::equal(this->data, other.data);
+        return bitmask(mask.lo) | (bitmask(mask.hi) << 4);
     }
 
-    friend std::ostream& operator<<(std::ostream& os, const Quat<T>& quat)
+    friend Pack roundToInt(const Pack& a)
     {
-        std::cout << quat.data;
-        return os;
+        return { roundToInt(a.lo), roundToInt(a.hi) };
+    }
+    friend Pack exp2i(const Pack& n)
+    {
+        return { exp2i(n.lo), exp2i(n.hi) };
+    }
+    friend Pack frexp(const Pack& a, Pack& exponent)
+    {
+        return { frexp(a.lo, exponent.lo), frexp(a.hi, exponent.hi) };
+    }
+    friend Pack gather(const float* table, const Pack& index)
+    {
+        return { gather(table, index.lo), gather(table, index.hi) };
+    }
+    friend Pack gatherPair(const float* table, const Pack& index, Pack& neighbours)
+    {
+        return { gatherPair(table, index.lo, neighbours.lo), gatherPair(table, index.hi, neighbours.hi) };
     }
 };
+#endif
+#endif
 
-template <size_t R, size_t C, size_t N, typename T>
-constexpr Vec<N, T> dotProduct(const Mat<R, C, T>& mat, const Vec<N, T>& vec)
-{
-    static_assert(N == C, "Incompatible operation");
-    Vec<R, T> output;
+// Widest float pack the target supports natively.
+#ifdef MATH_SIMD_AVX2
+inline constexpr size_t NATIVE_FLOAT_WIDTH = 8;
+#else
+inline constexpr size_t NATIVE_FLOAT_WIDTH = 4;
+#endif
 
-    for (size_t row = 0; row < R; ++row) {
-        T value = {};
-        for (size_t col = 0; col < C; ++col) {
-            value += mat[row][col] * vec[col];
-        }
-        output[row] = value;
-    }
-    return output;
-}
+// Lane count used by the batch kernels for element type T.
+template <typename T>
+inline constexpr size_t NATIVE_WIDTH = std::is_same_v<T, float> ? NATIVE_FLOAT_WIDTH : 4;
 
-template <size_t R, size_t C, size_t N, typename T>
-constexpr Vec<N, T> dotProduct(const Vec<N, T>& vec, const Mat<R, C, T>& mat)
+// Applies a scalar function to every lane, the fallback for non float packs.
+template <typename T, size_t W, typename F>
+Pack<T, W> lanewise(const Pack<T, W>& a, F&& func)
 {
-    static_assert(N == C, "Incompatible operation");
-    Vec<R, T> output;
-
-    for (size_t col = 0; col < C; ++col) {
-        T value = {};
-        for (size_t row = 0; row < R; ++row) {
-            value += mat[row][col] * vec[row];
-        }
-        output[col] = value;
+    alignas(32) T lanes[W];
+    a.store(lanes);
+    for (auto& lane : lanes) {
+        lane = static_cast<T>(func(lane));
     }
-    return output;
-}
-
-template <size_t N, typename T>
-constexpr T dotProduct(const Vec<N, T>& vec1, const Vec<N, T>& vec2)
-{
-    return std::transform_reduce(
-        vec1.cbegin(), vec1.cend(),
-        vec2.cbegin(),
-        T {},
-        std::plus {},
-        std::multiplies {});
+    return Pack<T, W>::load(lanes);
 }
 
-template <size_t R, size_t C, typename T>
-constexpr Mat<C, R, T> transpose(const Mat<R, C, T>& mat)
+// W floats widened from W consecutive 16 bit values, in register for 8 lanes on AVX2.
+template <size_t W, HalfPrecision T>
+Pack<float, W> loadWidened(const T* ptr)
 {
-    Mat<C, R, T> transposed;
-    for (size_t row = 0; row < R; row++) {
-        for (size_t col = 0; col < C; col++) {
-            transposed[col][row] = mat[row][col];
+#ifdef MATH_SIMD_AVX2
+    if constexpr (W == 8) {
+        const __m128i bits = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr));
+        if constexpr (std::is_same_v<T, bfloat16>) {
+            return { _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_cvtepu16_epi32(bits), 16)) };
+        }
+#ifdef MATH_SIMD_F16C
+        if constexpr (std::is_same_v<T, half>) {
+            return { _mm256_cvtph_ps(bits) };
         }
+#endif
     }
-    return transposed;
+#endif
+    alignas(32) float lanes[W];
+    convert(std::span(ptr, W), std::span(lanes, W));
+    return Pack<float, W>::load(lanes);
 }
 
 /*
-Determinant of a Matrix (only capable of 2x2 and 3x3).
+    y * 2^n for integer valued lanes n in [-126, 128]. The scale is applied in two halves, as
+    2^128 itself has no float encoding but y * 2^128 does for y < 1 (e^x close to FLT_MAX).
 */
-template <size_t N, typename T>
-constexpr T determinant(const Mat<N, N, T>& mat [[maybe_unused]])
+template <typename T, size_t W>
+Pack<T, W> scaleByPow2(const Pack<T, W>& y, const Pack<T, W>& n)
 {
-    assert(false);
-    return 0.0f;
+    const Pack<T, W> half = roundToInt(n * Pack<T, W>::broadcast(0.5f));
+    return y * exp2i(half) * exp2i(n - half);
 }
 
 /*
-Determinant of a Matrix (only capable of 2x2 and 3x3).
+    e^x (Cephes style range reduction plus a degree 6 polynomial, degree 4 for Precision::Fast).
+    Max relative error 2e-7 over [-87.3, 88.7] (5e-5 Fast), inputs outside are clamped.
 */
-template <typename T>
-constexpr T determinant(const Mat<2, 2, T>& mat)
+template <Precision PRECISION = Precision::Medium, typename T, size_t W>
+Pack<T, W> exp(const Pack<T, W>& x)
 {
-    return (mat[0][0] * mat[1][1]) - (mat[0][1] * mat[1][0]);
+    using P = Pack<T, W>;
+    if constexpr (!std::is_same_v<T, float> || PRECISION == Precision::Exact) {
+        return lanewise(x, [](T lane) { return std::exp(lane); });
+    } else if constexpr (PRECISION == Precision::Fast) {
+        const P clamped = min(max(x, P::broadcast(-87.33654f)), P::broadcast(88.72283f));
+        const P n = roundToInt(clamped * P::broadcast(1.44269504088896341f));
+        const P r = clamped - n * P::broadcast(0.693147180559945f);
+        P y = P::broadcast(1.0f / 24.0f);
+        y = mulAdd(y, r, P::broadcast(1.0f / 6.0f));
+        y = mulAdd(y, r, P::broadcast(0.5f));
+        y = mulAdd(y, r * r, r + P::broadcast(1.0f));
+        return scaleByPow2(y, n);
+    } else {
+        const P clamped = min(max(x, P::broadcast(-87.33654f)), P::broadcast(88.72283f));
+        const P n = roundToInt(clamped * P::broadcast(1.44269504088896341f));
+        P r = clamped - n * P::broadcast(0.693359375f);
+        r = r - n * P::broadcast(-2.12194440e-4f);
+
+        P y = P::broadcast(1.9875691500e-4f);
+        y = mulAdd(y, r, P::broadcast(1.3981999507e-3f));
+        y = mulAdd(y, r, P::broadcast(8.3334519073e-3f));
+        y = mulAdd(y, r, P::broadcast(4.1665795894e-2f));
+        y = mulAdd(y, r, P::broadcast(1.6666665459e-1f));
+        y = mulAdd(y, r, P::broadcast(5.0000001201e-1f));
+        y = mulAdd(y, r * r, r + P::broadcast(1.0f));
+        return scaleByPow2(y, n);
+    }
 }
 
 /*
-Determinant of a Matrix (only capable of 2x2 and 3x3).
+    Natural log for positive lanes (Cephes style, degree 8 polynomial).
+    Max relative error 2e-7 over normal floats.
 */
-template <typename T>
-constexpr T determinant(const Mat<3, 3, T>& mat)
+template <typename T, size_t W>
+Pack<T, W> log(const Pack<T, W>& x)
 {
-    Mat<2, 2> a({ { mat[1][1], mat[1][2] }, { mat[2][1], mat[2][2] } });
-    Mat<2, 2> b({ { mat[1][0], mat[1][2] }, { mat[2][0], mat[2][2] } });
-    Mat<2, 2> c({ { mat[1][0], mat[1][1] }, { mat[2][0], mat[2][1] } });
-    return (mat[0][0] * determinant(a)) - (mat[0][1] * determinant(b)) + (mat[0][2] * determinant(c));
+    using P = Pack<T, W>;
+    if constexpr (!std::is_same_v<T, float>) {
+        return lanewise(x, [](T lane) { return std::log(lane); });
+    } else {
+        P e;
+        P m = frexp(x, e);
+        // Shift the mantissa into [sqrt(0.5), sqrt(2)) - 1.
+        const auto small = m < P::broadcast(0.707106781186547524f);
+        e = select(small, e - P::broadcast(1.0f), e);
+        m = select(small, m + m, m) - P::broadcast(1.0f);
+
+        const P z = m * m;
+        P y = P::broadcast(7.0376836292e-2f);
+        y = mulAdd(y, m, P::broadcast(-1.1514610310e-1f));
+        y = mulAdd(y, m, P::broadcast(1.1676998740e-1f));
+        y = mulAdd(y, m, P::broadcast(-1.2420140846e-1f));
+        y = mulAdd(y, m, P::broadcast(1.4249322787e-1f));
+        y = mulAdd(y, m, P::broadcast(-1.6668057665e-1f));
+        y = mulAdd(y, m, P::broadcast(2.0000714765e-1f));
+        y = mulAdd(y, m, P::broadcast(-2.4999993993e-1f));
+        y = mulAdd(y, m, P::broadcast(3.3333331174e-1f));
+        y = y * m * z;
+        y = mulAdd(e, P::broadcast(-2.12194440e-4f), y);
+        y = mulAdd(z, P::broadcast(-0.5f), y);
+        return mulAdd(e, P::broadcast(0.693359375f), m + y);
+    }
 }
 
 /*
-Distance between two vectors (as if they were points).
+    Hyperbolic tangent, an odd polynomial below |x| = 0.625 and 1 - 2 / (e^2x + 1) above.
+    Max relative error 3e-7.
 */
-template <size_t N, typename T>
-constexpr T distance(const Pos<N, T>& pos1, const Pos<N, T>& pos2)
+template <typename T, size_t W>
+Pack<T, W> tanh(const Pack<T, W>& x)
 {
-    const Vec<N, T> vec1 { pos1 };
-    const Vec<N, T> vec2 { pos2 };
+    using P = Pack<T, W>;
+    if constexpr (!std::is_same_v<T, float>) {
+        return lanewise(x, [](T lane) { return std::tanh(lane); });
+    } else {
+        const P one = P::broadcast(1.0f);
+        const P abs_x = max(x, P::zero() - x);
 
-    auto squaredDifference = [](const auto& lhs, const auto& rhs) { return (lhs - rhs) * (lhs - rhs); };
+        const P z = x * x;
+        P small = P::broadcast(-5.70498872745e-3f);
+        small = mulAdd(small, z, P::broadcast(2.06390887954e-2f));
+        small = mulAdd(small, z, P::broadcast(-5.37397155531e-2f));
+        small = mulAdd(small, z, P::broadcast(1.33314422036e-1f));
+        small = mulAdd(small, z, P::broadcast(-3.33332819422e-1f));
+        small = mulAdd(small * z, x, x);
 
-    return Math::sqrt(
-        std::transform_reduce(
-            vec1.begin(), vec1.end(),
-            vec2.begin(),
-            0.0f,
-            std::plus {},
-            squaredDifference));
+        P large = one - P::broadcast(2.0f) / (exp(abs_x + abs_x) + one);
+        large = select(x < P::zero(), P::zero() - large, large);
+        return select(abs_x < P::broadcast(0.625f), small, large);
+    }
+}
+
+/*
+    sin and cos of every lane in one pass. x is reduced to r in [-pi/4, pi/4] around the nearest
+    multiple n of pi/2 (three part Cody-Waite), both polynomials are evaluated on r and the
+    quadrant n mod 4 picks and signs them. Medium uses the Cephes sinf/cosf polynomials, max
+    absolute error 1e-7 for |x| < 8192, Fast drops a term from each, max absolute error 4e-5.
+    Finite lanes with |x| >= 2^24 are 0.
+*/
+template <Precision PRECISION = Precision::Medium, typename T, size_t W>
+void sincos(const Pack<T, W>& x, Pack<T, W>& sin, Pack<T, W>& cos)
+{
+    using P = Pack<T, W>;
+    if constexpr (PRECISION == Precision::Exact) {
+        sin = lanewise(x, [](T lane) { return std::sin(lane); });
+        cos = lanewise(x, [](T lane) { return std::cos(lane); });
+    } else {
+        const P n = roundToInt(x * P::broadcast(static_cast<T>(0.636619772367581343)));
+        P r = x - n * P::broadcast(static_cast<T>(1.5703125));
+        r = r - n * P::broadcast(static_cast<T>(4.837512969970703125e-4));
+        r = r - n * P::broadcast(static_cast<T>(7.54978995489188216e-8));
+        const P z = r * r;
+
+        P s;
+        P c;
+        if constexpr (PRECISION == Precision::Fast) {
+            s = mulAdd(P::broadcast(static_cast<T>(8.33333333e-3)), z, P::broadcast(static_cast<T>(-1.66666667e-1)));
+            c = mulAdd(P::broadcast(static_cast<T>(-1.38888889e-3)), z, P::broadcast(static_cast<T>(4.16666667e-2)));
+        } else {
+            s = mulAdd(P::broadcast(static_cast<T>(-1.9515295891e-4)), z, P::broadcast(static_cast<T>(8.3321608736e-3)));
+            s = mulAdd(s, z, P::broadcast(static_cast<T>(-1.6666654611e-1)));
+            c = mulAdd(P::broadcast(static_cast<T>(2.443315711809948e-5)), z, P::broadcast(static_cast<T>(-1.388731625493765e-3)));
+            c = mulAdd(c, z, P::broadcast(static_cast<T>(4.166664568298827e-2)));
+        }
+        s = mulAdd(s * z, r, r);
+        c = mulAdd(c * z, z, P::broadcast(1) - P::broadcast(static_cast<T>(0.5)) * z);
+
+        // Quadrant q = n mod 4 using floor(k / 2) = round((k - 0.5) / 2) for integer k.
+        // q: 0 -> (s, c), 1 -> (c, -s), 2 -> (-s, -c), 3 -> (-c, s)
+        const P half = P::broadcast(static_cast<T>(0.5));
+        const P q = n - P::broadcast(4) * roundToInt((n - P::broadcast(static_cast<T>(1.5))) * P::broadcast(static_cast<T>(0.25)));
+        const P odd = q - P::broadcast(2) * roundToInt((q - half) * half);
+        const P one = P::broadcast(1);
+        const P minus_one = P::zero() - one;
+        sin = select(odd > half, c, s) * select(q > P::broadcast(static_cast<T>(1.5)), minus_one, one);
+        cos = select(odd > half, s, c) * select((q > half) & (q < P::broadcast(static_cast<T>(2.5))), minus_one, one);
+
+        // From 2^24 n is no longer exact and r keeps no bits of the angle, return 0 as Cephes does.
+        // Infinite lanes reduce to NaN.
+        const P magnitude = max(x, P::zero() - x);
+        const auto lost = (magnitude >= P::broadcast(static_cast<T>(16777216))) & (magnitude < P::broadcast(std::numeric_limits<T>::infinity()));
+        sin = select(lost, P::zero(), sin);
+        cos = select(lost, P::zero(), cos);
+    }
+}
+
+template <Precision PRECISION = Precision::Medium, typename T, size_t W>
+Pack<T, W> sin(const Pack<T, W>& x)
+{
+    Pack<T, W> s;
+    Pack<T, W> c;
+    sincos<PRECISION>(x, s, c);
+    return s;
+}
+
+template <Precision PRECISION = Precision::Medium, typename T, size_t W>
+Pack<T, W> cos(const Pack<T, W>& x)
+{
+    Pack<T, W> s;
+    Pack<T, W> c;
+    sincos<PRECISION>(x, s, c);
+    return c;
+}
+
+/*
+    1 / sqrt(x) for positive lanes. Fast is the hardware estimate (relative error 4e-4),
+    Medium adds one Newton-Raphson step (relative error 3e-7).
+*/
+template <Precision PRECISION = Precision::Medium, typename T, size_t W>
+Pack<T, W> rsqrt(const Pack<T, W>& x)
+{
+    using P = Pack<T, W>;
+    if constexpr (PRECISION == Precision::Exact || !std::is_same_v<T, float>) {
+        return P::broadcast(1) / sqrt(x);
+    } else if constexpr (PRECISION == Precision::Fast) {
+        return rsqrtEstimate(x);
+    } else {
+        const P y = rsqrtEstimate(x);
+        return y * mulAdd(P::broadcast(-0.5f) * x * y, y, P::broadcast(1.5f));
+    }
+}
+
+/*
+    Lane count used for the runtime path of Vec<N, T>, 0 means no SIMD kernel.
+*/
+template <size_t N, typename T>
+inline constexpr size_t VEC_PACK_WIDTH = 0;
+#ifdef MATH_SIMD_SSE
+template <>
+inline constexpr size_t VEC_PACK_WIDTH<3, float> = 4;
+template <>
+inline constexpr size_t VEC_PACK_WIDTH<4, float> = 4;
+template <>
+inline constexpr size_t VEC_PACK_WIDTH<8, float> = 8;
+#endif
+
+/*
+    Packed implementations of the Vec<N, T> operators over raw element storage.
+    Sizes narrower than the pack (Vec<3>) are zero padded on load.
+*/
+template <size_t N, typename T>
+struct VecKernel {
+    static constexpr size_t W = VEC_PACK_WIDTH<N, T>;
+    static constexpr bool enabled = W != 0;
+    using P = Pack<T, W>;
+
+    static P load(const T* ptr)
+    {
+        if constexpr (N == W) {
+            return P::load(ptr);
+        } else {
+            return P::loadPartial(ptr, N);
+        }
+    }
+    static void store(const P& p, T* ptr)
+    {
+        if constexpr (N == W) {
+            p.store(ptr);
+        } else {
+            p.storePartial(ptr, N);
+        }
+    }
+
+    static T dot(const T* a, const T* b)
+    {
+        return reduceAdd(load(a) * load(b));
+    }
+    static void normalise(const T* a, T* out)
+    {
+        const P p = load(a);
+        store(p / sqrt(P::broadcast(reduceAdd(p * p))), out);
+    }
+};
+
+}
+
+namespace Math {
+
+template <typename T>
+struct SinCos {
+    T sin;
+    T cos;
+};
+
+/*
+    sin(x) and cos(x) from one range reduction. Precision::Exact is std::sin and std::cos at
+    runtime (both Math::sin and Math::cos when constant evaluated), the other tiers use
+    Simd::sincos().
+*/
+template <Precision PRECISION = Precision::Exact, typename T>
+constexpr SinCos<T> sincos(T x)
+{
+    if consteval {
+        return { Math::sin(x), Math::cos(x) };
+    } else {
+        if constexpr (PRECISION == Precision::Exact) {
+            return { static_cast<T>(std::sin(x)), static_cast<T>(std::cos(x)) };
+        } else {
+            using P = Simd::Pack<T, 4>;
+            P s;
+            P c;
+            Simd::sincos<PRECISION>(P::broadcast(x), s, c);
+            alignas(32) T lanes[2][4];
+            s.store(lanes[0]);
+            c.store(lanes[1]);
+            return { lanes[0][0], lanes[1][0] };
+        }
+    }
+}
+
+/*
+    sin[i], cos[i] = sincos(x[i]) with native width packs.
+*/
+template <Precision PRECISION = Precision::Medium, typename T>
+void sincos(std::span<const T> x, std::span<T> sin, std::span<T> cos)
+{
+    using P = Simd::Pack<T, Simd::NATIVE_WIDTH<T>>;
+    constexpr size_t W = P::width;
+    assert(sin.size() >= x.size() && cos.size() >= x.size());
+    for (size_t i = 0; i < x.size(); i += W) {
+        const size_t n = std::min(W, x.size() - i);
+        P s;
+        P c;
+        Simd::sincos<PRECISION>(n == W ? P::load(x.data() + i) : P::loadPartial(x.data() + i, n), s, c);
+        if (n == W) {
+            s.store(sin.data() + i);
+            c.store(cos.data() + i);
+        } else {
+            s.storePartial(sin.data() + i, n);
+            c.storePartial(cos.data() + i, n);
+        }
+    }
+}
+
+}
+
+// Activation functions (Machine learning)
+namespace Math::Activation {
+
+template <typename T>
+constexpr T linear(T x)
+{
+    return x;
+}
+
+template <typename T>
+constexpr T reLU(T x)
+{
+    return std::max(static_cast<T>(0), x);
+}
+
+template <typename T>
+constexpr T heaviside(T x)
+{
+    return static_cast<T>(x > 0);
+}
+
+template <std::floating_point T>
+constexpr T sigmoid(T x)
+{
+    return 1 / (1 + Math::exp(-x));
+}
+
+template <std::floating_point T>
+constexpr T gELU(T x)
+{
+    return (x / 2) * (1 + x / Math::sqrt<T>(2));
+}
+
+template <std::floating_point T>
+constexpr T siLU(T x)
+{
+    return x / (1 + Math::exp(-x));
+}
+
+template <std::floating_point T>
+constexpr T gaussian(T x)
+{
+    return Math::exp(-(x * x));
+}
+
+template <std::floating_point T>
+constexpr T tanh(T x)
+{
+    if consteval {
+        // (1 - e^-2|x|) / (1 + e^-2|x|) with the sign of x, cannot overflow.
+        const double e = Math::exp(-2 * Constexpr::abs(static_cast<double>(x)));
+        const double magnitude = (1 - e) / (1 + e);
+        return static_cast<T>(x < 0 ? -magnitude : magnitude);
+    } else {
+        return std::tanh(x);
+    }
+}
+
+template <std::floating_point T>
+constexpr T softplus(T x)
+{
+    return Math::log(1 + Math::exp(x));
+}
+
+template <std::floating_point T>
+constexpr T leakyReLU(T x)
+{
+    return (x > 0) ? x : static_cast<T>(0.01) * x;
+}
+
+/*
+    Pack overloads, evaluate W lanes at once with the Simd approximations
+    (see Simd::exp, Simd::log and Simd::tanh for their error bounds).
+*/
+template <typename T, size_t W>
+Simd::Pack<T, W> reLU(const Simd::Pack<T, W>& x)
+{
+    return max(x, Simd::Pack<T, W>::zero());
+}
+
+template <typename T, size_t W>
+Simd::Pack<T, W> heaviside(const Simd::Pack<T, W>& x)
+{
+    using P = Simd::Pack<T, W>;
+    return select(x > P::zero(), P::broadcast(1), P::zero());
+}
+
+template <typename T, size_t W>
+Simd::Pack<T, W> sigmoid(const Simd::Pack<T, W>& x)
+{
+    using P = Simd::Pack<T, W>;
+    return P::broadcast(1) / (P::broadcast(1) + Simd::exp(P::zero() - x));
+}
+
+template <typename T, size_t W>
+Simd::Pack<T, W> gELU(const Simd::Pack<T, W>& x)
+{
+    using P = Simd::Pack<T, W>;
+    return (x * P::broadcast(static_cast<T>(0.5))) * (P::broadcast(1) + x / P::broadcast(std::sqrt(T { 2 })));
+}
+
+template <typename T, size_t W>
+Simd::Pack<T, W> siLU(const Simd::Pack<T, W>& x)
+{
+    using P = Simd::Pack<T, W>;
+    return x / (P::broadcast(1) + Simd::exp(P::zero() - x));
+}
+
+template <typename T, size_t W>
+Simd::Pack<T, W> gaussian(const Simd::Pack<T, W>& x)
+{
+    using P = Simd::Pack<T, W>;
+    return Simd::exp(P::zero() - x * x);
+}
+
+template <typename T, size_t W>
+Simd::Pack<T, W> tanh(const Simd::Pack<T, W>& x)
+{
+    return Simd::tanh(x);
+}
+
+// Evaluated as max(x, 0) + log(1 + e^-|x|) so large inputs do not overflow.
+template <typename T, size_t W>
+Simd::Pack<T, W> softplus(const Simd::Pack<T, W>& x)
+{
+    using P = Simd::Pack<T, W>;
+    const P one = P::broadcast(1);
+    const P e = Simd::exp(P::zero() - max(x, P::zero() - x));
+    // log(1 + e) ~= e - e^2 / 2 once 1 + e rounds to 1.
+    const P log1p = select(e < P::broadcast(static_cast<T>(1e-4)), e * (one - e * P::broadcast(static_cast<T>(0.5))), Simd::log(one + e));
+    return max(x, P::zero()) + log1p;
+}
+
+template <typename T, size_t W>
+Simd::Pack<T, W> leakyReLU(const Simd::Pack<T, W>& x)
+{
+    using P = Simd::Pack<T, W>;
+    return select(x > P::zero(), x, x * P::broadcast(static_cast<T>(0.01)));
+}
+
+struct Linear {
+    constexpr auto operator()(const auto& x) const
+    {
+        return Math::Activation::linear(x);
+    }
+    friend std::ostream& operator<<(std::ostream& os, const Linear& activation [[maybe_unused]])
+    {
+        os << "Math::Activation::Linear";
+        return os;
+    }
+};
+struct ReLU {
+    constexpr auto operator()(const auto& x) const
+    {
+        return Math::Activation::reLU(x);
+    }
+    friend std::ostream& operator<<(std::ostream& os, const ReLU& activation [[maybe_unused]])
+    {
+        os << "Math::Activation::ReLU";
+        return os;
+    }
+};
+struct Heaviside {
+    constexpr auto operator()(const auto& x) const
+    {
+        return Math::Activation::heaviside(x);
+    }
+    friend std::ostream& operator<<(std::ostream& os, const Heaviside& activation [[maybe_unused]])
+    {
+        os << "Math::Activation::Heaviside";
+        return os;
+    }
+};
+struct Sigmoid {
+    constexpr auto operator()(const auto& x) const
+    {
+        return Math::Activation::sigmoid(x);
+    }
+    friend std::ostream& operator<<(std::ostream& os, const Sigmoid& activation [[maybe_unused]])
+    {
+        os << "Math::Activation::Sigmoid";
+        return os;
+    }
+};
+struct GELU {
+    constexpr auto operator()(const auto& x) const
+    {
+        return Math::Activation::gELU(x);
+    }
+    friend std::ostream& operator<<(std::ostream& os, const GELU& activation [[maybe_unused]])
+    {
+        os << "Math::Activation::GELU";
+        return os;
+    }
+};
+struct SiLU {
+    constexpr auto operator()(const auto& x) const
+    {
+        return Math::Activation::siLU(x);
+    }
+    friend std::ostream& operator<<(std::ostream& os, const SiLU& activation [[maybe_unused]])
+    {
+        os << "Math::Activation::SiLU";
+        return os;
+    }
+};
+struct Gaussian {
+    constexpr auto operator()(const auto& x) const
+    {
+        return Math::Activation::gaussian(x);
+    }
+    friend std::ostream& operator<<(std::ostream& os, const Gaussian& activation [[maybe_unused]])
+    {
+        os << "Math::Activation::Gaussian";
+        return os;
+    }
+};
+struct Tanh {
+    constexpr auto operator()(const auto& x) const
+    {
+        return Math::Activation::tanh(x);
+    }
+    friend std::ostream& operator<<(std::ostream& os, const Tanh& activation [[maybe_unused]])
+    {
+        os << "Math::Activation::Tanh";
+        return os;
+    }
+};
+struct Softplus {
+    constexpr auto operator()(const auto& x) const
+    {
+        return Math::Activation::softplus(x);
+    }
+    friend std::ostream& operator<<(std::ostream& os, const Softplus& activation [[maybe_unused]])
+    {
+        os << "Math::Activation::Softplus";
+        return os;
+    }
+};
+struct LeakyReLU {
+    constexpr auto operator()(const auto& x) const
+    {
+        return Math::Activation::leakyReLU(x);
+    }
+    friend std::ostream& operator<<(std::ostream& os, const LeakyReLU& activation [[maybe_unused]])
+    {
+        os << "Math::Activation::LeakyReLU";
+        return os;
+    }
+};
+
+/*
+    Applies an activation to every element of input and writes it to output,
+    NATIVE_WIDTH elements at a time using the Pack overloads above.
+*/
+template <typename F, typename T>
+void apply(const F& activation, std::span<const T> input, std::span<T> output)
+{
+    using P = Simd::Pack<T, Simd::NATIVE_WIDTH<T>>;
+    constexpr size_t W = P::width;
+    assert(output.size() >= input.size());
+
+    const size_t n = input.size();
+    size_t i = 0;
+    for (; i + W <= n; i += W) {
+        activation(P::load(input.data() + i)).store(output.data() + i);
+    }
+    if (i < n) {
+        activation(P::loadPartial(input.data() + i, n - i)).storePartial(output.data() + i, n - i);
+    }
+}
+
+// In place apply().
+template <typename F, typename T>
+void apply(const F& activation, std::span<T> values)
+{
+    apply(activation, std::span<const T>(values), values);
+}
+
+/*
+    Returns a copy of a contiguous container (Vec, Mat, DynVec, ...) with the activation applied.
+*/
+template <typename F, std::ranges::contiguous_range C>
+    requires(!std::ranges::view<C>)
+C apply(const F& activation, C values)
+{
+    apply(activation, std::span(std::ranges::data(values), std::ranges::size(values)));
+    return values;
+}
+
+/*
+    An activation sampled at SIZE evenly spaced inputs over [lower, upper], computed at compile
+    time when the table is constexpr. Calls interpolate linearly between the two nearest samples
+    and clamp inputs to [lower, upper]; NaN is returned as is. It is an activation itself, so
+    apply(table, span) looks up a batch with two gathers per pack and no exp or log.
+*/
+template <typename F, size_t SIZE, typename T = float>
+struct LookupTable {
+    static_assert(SIZE >= 2, "A lookup table needs at least two samples");
+
+    std::array<T, SIZE> samples {};
+    T lower;
+    T upper;
+    T scale; // samples per unit of input
+
+    constexpr LookupTable(T lower_input, T upper_input, const F& activation = {})
+        : lower(lower_input)
+        , upper(upper_input)
+        , scale(static_cast<T>(SIZE - 1) / (upper_input - lower_input))
+    {
+        assert(lower < upper);
+        for (size_t i = 0; i < SIZE; ++i) {
+            samples[i] = static_cast<T>(activation(lower + (upper - lower) * static_cast<T>(i) / static_cast<T>(SIZE - 1)));
+        }
+    }
+
+    constexpr T operator()(T x) const
+    {
+        if (x != x) { // NaN has no sample, and would convert to size_t below
+            return x;
+        }
+        const T position = (std::clamp(x, lower, upper) - lower) * scale;
+        const size_t i = std::min(static_cast<size_t>(position), SIZE - 2);
+        const T t = position - static_cast<T>(i);
+        return samples[i] + t * (samples[i + 1] - samples[i]);
+    }
+
+    template <size_t W>
+    Simd::Pack<T, W> operator()(const Simd::Pack<T, W>& x) const
+    {
+        using P = Simd::Pack<T, W>;
+        // False only for NaN lanes, they look up sample 0 so no NaN index reaches the gather and return NaN.
+        const auto number = x >= P::broadcast(-std::numeric_limits<T>::infinity());
+        const P position = select(number, (min(max(x, P::broadcast(lower)), P::broadcast(upper)) - P::broadcast(lower)) * P::broadcast(scale), P::zero());
+        // floor(position) for non negative lanes, the last segment also covers position == SIZE - 1.
+        const P index = min(max(roundToInt(position - P::broadcast(static_cast<T>(0.5))), P::zero()), P::broadcast(static_cast<T>(SIZE - 2)));
+        P b;
+        const P a = gatherPair(samples.data(), index, b);
+        return select(number, mulAdd(position - index, b - a, a), x);
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const LookupTable& table)
+    {
+        os << "Math::Activation::LookupTable<" << F {} << ", " << SIZE << "> [" << table.lower << ", " << table.upper << ']';
+        return os;
+    }
+};
+
+}
+
+// Thread pool used by the parallel (std::execution::par) overloads
+namespace Math::Parallel {
+
+/*
+    Persistent work stealing thread pool.
+    Every worker owns a deque, it pops its own work from the back and steals from
+    the front of the other workers' deques when it runs dry. Threads that wait on
+    parallelFor() execute queued tasks instead of blocking, so nested use is safe.
+    Tasks must not throw.
+*/
+class ThreadPool {
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    std::vector<std::thread> m_threads;
+    std::mutex m_wake_mutex;
+    std::condition_variable m_wake;
+    std::atomic<size_t> m_pending = 0;
+    std::atomic<size_t> m_next_queue = 0;
+    bool m_stopping = false;
+
+    static auto currentWorker() -> std::pair<const ThreadPool*, size_t>&
+    {
+        thread_local std::pair<const ThreadPool*, size_t> worker { nullptr, 0 };
+        return worker;
+    }
+
+    bool tryPop(size_t queue_index, std::function<void()>& task)
+    {
+        Queue& queue = *m_queues[queue_index];
+        std::lock_guard lock(queue.mutex);
+        if (queue.tasks.empty()) {
+            return false;
+        }
+        task = std::move(queue.tasks.back());
+        queue.tasks.pop_back();
+        --m_pending;
+        return true;
+    }
+
+    bool trySteal(size_t thief_index, std::function<void()>& task)
+    {
+        for (size_t i = 1; i <= m_queues.size(); ++i) {
+            Queue& queue = *m_queues[(thief_index + i) % m_queues.size()];
+            std::lock_guard lock(queue.mutex);
+            if (!queue.tasks.empty()) {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+                --m_pending;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Runs one queued task if there is one, preferring the caller's own queue.
+    bool runPendingTask()
+    {
+        const auto [pool, index] = currentWorker();
+        const size_t home = (pool == this) ? index : m_next_queue.load() % m_queues.size();
+        std::function<void()> task;
+        if ((pool == this && tryPop(home, task)) || trySteal(home, task)) {
+            task();
+            return true;
+        }
+        return false;
+    }
+
+    void workerLoop(size_t index)
+    {
+        currentWorker() = { this, index };
+        while (true) {
+            if (runPendingTask()) {
+                continue;
+            }
+            std::unique_lock lock(m_wake_mutex);
+            m_wake.wait(lock, [&] { return m_stopping || m_pending > 0; });
+            if (m_stopping && m_pending == 0) {
+                return;
+            }
+        }
+    }
+
+public:
+    explicit ThreadPool(size_t thread_count = std::max(1u, std::thread::hardware_concurrency()))
+    {
+        thread_count = std::max<size_t>(thread_count, 1);
+        for (size_t i = 0; i < thread_count; ++i) {
+            m_queues.push_back(std::make_unique<Queue>());
+        }
+        for (size_t i = 0; i < thread_count; ++i) {
+            m_threads.emplace_back([this, i] { workerLoop(i); });
+        }
+    }
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard lock(m_wake_mutex);
+            m_stopping = true;
+        }
+        m_wake.notify_all();
+        for (auto& thread : m_threads) {
+            thread.join();
+        }
+    }
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Library wide pool, created on first use.
+    static ThreadPool& instance()
+    {
+        static ThreadPool pool;
+        return pool;
+    }
+
+    size_t size() const
+    {
+        return m_threads.size();
+    }
+
+    // Queues a task, onto the calling worker's own deque when called from inside the pool.
+    void submit(std::function<void()> task)
+    {
+        const auto [pool, index] = currentWorker();
+        const size_t queue_index = (pool == this) ? index : m_next_queue++ % m_queues.size();
+        {
+            std::lock_guard lock(m_wake_mutex);
+            ++m_pending;
+        }
+        {
+            Queue& queue = *m_queues[queue_index];
+            std::lock_guard lock(queue.mutex);
+            queue.tasks.push_back(std::move(task));
+        }
+        m_wake.notify_one();
+    }
+
+    /*
+        Calls func(i) for every i in [0, count) across the pool and returns once all
+        calls have finished. The calling thread helps by running queued tasks.
+    */
+    template <typename F>
+    void parallelFor(size_t count, F&& func)
+    {
+        if (count == 0) {
+            return;
+        }
+        if (count == 1) {
+            func(size_t { 0 });
+            return;
+        }
+        std::atomic<size_t> remaining = count;
+        for (size_t i = 1; i < count; ++i) {
+            submit([&func, &remaining, i] {
+                func(i);
+                remaining.fetch_sub(1, std::memory_order_release);
+            });
+        }
+        func(size_t { 0 });
+        remaining.fetch_sub(1, std::memory_order_release);
+
+        while (remaining.load(std::memory_order_acquire) != 0) {
+            if (!runPendingTask()) {
+                std::this_thread::yield();
+            }
+        }
+    }
+};
+
+template <typename Policy>
+inline constexpr bool IS_PARALLEL_POLICY
+    = std::is_execution_policy_v<std::remove_cvref_t<Policy>>
+    && !std::is_same_v<std::remove_cvref_t<Policy>, std::execution::sequenced_policy>;
+
+}
+
+namespace Math::LinearAlgebra {
+
+/*
+    Summation used by the execution policy reductions. Both sum fixed size blocks and then
+    combine the block sums in a fixed order, so results do not depend on the policy or on the
+    number of threads. Pairwise is O(log n) error at the speed of a plain sum, Kahan
+    compensates every addition for an error independent of n at about twice the cost.
+*/
+enum class Summation {
+    Pairwise,
+    Kahan
+};
+
+/*
+    Absolute tolerance of the approximate == operators, widened to a few units in the last
+    place at 1 for element types coarser than it (half, bfloat16).
+*/
+template <typename T>
+constexpr float equalityTolerance(float tolerance)
+{
+    if constexpr (std::numeric_limits<T>::is_specialized && !std::numeric_limits<T>::is_integer) {
+        return std::max(tolerance, 4 * static_cast<float>(std::numeric_limits<T>::epsilon()));
+    } else {
+        return tolerance;
+    }
+}
+
+}
+
+// Blocked runtime kernels shared by the Linear Algebra types
+namespace Math::LinearAlgebra::Kernel {
+
+/*
+    Non-owning pointer to a 2D block, element (row, col) lives at
+    ptr[row * row_stride + col * col_stride].
+*/
+template <typename T>
+struct Strided {
+    T* ptr;
+    size_t row_stride;
+    size_t col_stride;
+
+    constexpr T& at(size_t row, size_t col) const
+    {
+        return ptr[row * row_stride + col * col_stride];
+    }
+    constexpr Strided<T> offset(size_t row, size_t col) const
+    {
+        return { ptr + row * row_stride + col * col_stride, row_stride, col_stride };
+    }
+    constexpr operator Strided<const T>() const
+    {
+        return { ptr, row_stride, col_stride };
+    }
+};
+
+/*
+    Register and cache blocking parameters for gemm().
+    The micro-kernel computes an MR x NR tile of C from packed panels of A and B,
+    KC x NR panels of B stay in L1 and MC x KC blocks of A stay in L2.
+*/
+template <typename T>
+struct GemmBlocking {
+    static constexpr size_t W = Simd::NATIVE_WIDTH<T>;
+#ifdef MATH_SIMD_AVX2
+    static constexpr size_t MR = std::is_same_v<T, float> ? 6 : 4;
+#else
+    static constexpr size_t MR = 4;
+#endif
+    static constexpr size_t NR = 2 * W;
+    static constexpr size_t KC = 256;
+    static constexpr size_t MC = MR * 16;
+    static constexpr size_t NC = NR * 64;
+};
+
+// Products with fewer multiply-adds than this stay on the simple loop.
+inline constexpr size_t GEMM_THRESHOLD = 32 * 32 * 32;
+inline constexpr size_t GEMV_THRESHOLD = 32 * 32;
+
+// Copies an mc x kc block of A into MR row panels, zero padding the last panel.
+// 16 bit elements are widened to float here, so the micro-kernel only sees float.
+// NEGATE packs -A, for C -= A * B.
+template <bool NEGATE, typename T>
+void packA(Strided<const T> a, size_t mc, size_t kc, Accumulator<T>* out)
+{
+    constexpr size_t MR = GemmBlocking<Accumulator<T>>::MR;
+    for (size_t i = 0; i < mc; i += MR) {
+        const size_t rows = std::min(MR, mc - i);
+        for (size_t k = 0; k < kc; ++k) {
+            for (size_t r = 0; r < rows; ++r) {
+                if constexpr (NEGATE) {
+                    out[r] = -a.at(i + r, k);
+                } else {
+                    out[r] = a.at(i + r, k);
+                }
+            }
+            std::fill(out + rows, out + MR, Accumulator<T> {});
+            out += MR;
+        }
+    }
+}
+
+// Copies a kc x nc block of B into NR column panels, zero padding the last panel.
+template <typename T>
+void packB(Strided<const T> b, size_t kc, size_t nc, Accumulator<T>* out)
+{
+    constexpr size_t NR = GemmBlocking<Accumulator<T>>::NR;
+    for (size_t j = 0; j < nc; j += NR) {
+        const size_t cols = std::min(NR, nc - j);
+        for (size_t k = 0; k < kc; ++k) {
+            if (b.col_stride == 1) {
+                const T* row = &b.at(k, j);
+                std::copy(row, row + cols, out);
+            } else {
+                for (size_t c = 0; c < cols; ++c) {
+                    out[c] = b.at(k, j + c);
+                }
+            }
+            std::fill(out + cols, out + NR, Accumulator<T> {});
+            out += NR;
+        }
+    }
+}
+
+// Identity epilogue for gemm().
+struct NoEpilogue {
+    template <typename P>
+    P operator()(const P& value, size_t col [[maybe_unused]], size_t lanes [[maybe_unused]]) const
+    {
+        return value;
+    }
+};
+
+/*
+    gemm() epilogue for a dense layer, activation(value + bias[col]).
+*/
+template <typename T, typename F>
+struct DenseEpilogue {
+    const T* bias;
+    F activation;
+
+    template <typename P>
+    P operator()(const P& value, size_t col, size_t lanes) const
+    {
+        return activation(value + P::loadPartial(bias + col, lanes));
+    }
+};
+
+/*
+    C[0:rows, 0:cols] += packed A panel * packed B panel.
+    Accumulates the whole MR x NR tile in registers across kc. When epilogue is set it is
+    applied to the finished tile before it is stored, col is the tile's first column for it.
+    C may be stored narrower than T (half for float panels), it is then always read and
+    written through the tile.
+*/
+template <typename T, typename Storage, typename Epilogue>
+void gemmMicroKernel(size_t kc, const T* a, const T* b, Strided<Storage> c, size_t rows, size_t cols, const Epilogue* epilogue, size_t col)
+{
+    using Blocking = GemmBlocking<T>;
+    constexpr size_t MR = Blocking::MR;
+    constexpr size_t NR = Blocking::NR;
+    constexpr size_t W = Blocking::W;
+    using P = Simd::Pack<T, W>;
+
+    P acc[MR][2];
+    for (size_t r = 0; r < MR; ++r) {
+        acc[r][0] = P::zero();
+        acc[r][1] = P::zero();
+    }
+    for (size_t k = 0; k < kc; ++k) {
+        const P b0 = P::load(b);
+        const P b1 = P::load(b + W);
+        for (size_t r = 0; r < MR; ++r) {
+            const P a_r = P::broadcast(a[r]);
+            acc[r][0] = mulAdd(a_r, b0, acc[r][0]);
+            acc[r][1] = mulAdd(a_r, b1, acc[r][1]);
+        }
+        a += MR;
+        b += NR;
+    }
+
+    if constexpr (std::is_same_v<Storage, T>) {
+        if (rows == MR && cols == NR && c.col_stride == 1) {
+            for (size_t r = 0; r < MR; ++r) {
+                T* row = &c.at(r, 0);
+                P left = P::load(row) + acc[r][0];
+                P right = P::load(row + W) + acc[r][1];
+                if (epilogue) {
+                    left = (*epilogue)(left, col, W);
+                    right = (*epilogue)(right, col + W, W);
+                }
+                left.store(row);
+                right.store(row + W);
+            }
+            return;
+        }
+    }
+    T tile[MR][NR];
+    for (size_t r = 0; r < MR; ++r) {
+        acc[r][0].store(tile[r]);
+        acc[r][1].store(tile[r] + W);
+    }
+    for (size_t r = 0; r < rows; ++r) {
+        for (size_t j = 0; j < cols; ++j) {
+            tile[r][j] += c.at(r, j);
+        }
+        if (epilogue) {
+            for (size_t j = 0; j < cols; j += W) {
+                const size_t lanes = std::min(W, cols - j);
+                (*epilogue)(P::load(tile[r] + j), col + j, lanes).store(tile[r] + j);
+            }
+        }
+        for (size_t j = 0; j < cols; ++j) {
+            c.at(r, j) = tile[r][j];
+        }
+    }
+}
+
+/*
+    General matrix multiply, C (m x n) += A (m x k) * B (k x n), or -= when SUBTRACT.
+    Blocks for cache, packs A and B into contiguous panels and runs a register
+    blocked micro-kernel over each MR x NR tile of C.
+    A non-identity epilogue is applied to every element of C once its sum is complete,
+    so C = epilogue(C + A * B) in a single pass over C.
+    16 bit elements are multiplied and summed in float, C is rounded back once per KC
+    slice of k.
+*/
+template <bool SUBTRACT, typename T, typename Epilogue>
+void gemmBlocked(size_t m, size_t n, size_t k, Strided<const T> a, Strided<const T> b, Strided<T> c, const Epilogue& epilogue)
+{
+    using Blocking = GemmBlocking<Accumulator<T>>;
+    constexpr size_t MR = Blocking::MR;
+    constexpr size_t NR = Blocking::NR;
+    constexpr bool HAS_EPILOGUE = !std::is_same_v<Epilogue, NoEpilogue>;
+
+    thread_local std::vector<Accumulator<T>> packed_a;
+    thread_local std::vector<Accumulator<T>> packed_b;
+    packed_a.resize(Blocking::MC * Blocking::KC);
+    packed_b.resize(Blocking::KC * Blocking::NC);
+
+    for (size_t jc = 0; jc < n; jc += Blocking::NC) {
+        const size_t nc = std::min(Blocking::NC, n - jc);
+        for (size_t pc = 0; pc < k; pc += Blocking::KC) {
+            const size_t kc = std::min(Blocking::KC, k - pc);
+            const Epilogue* finish = (HAS_EPILOGUE && pc + kc == k) ? &epilogue : nullptr;
+            packB(b.offset(pc, jc), kc, nc, packed_b.data());
+
+            for (size_t ic = 0; ic < m; ic += Blocking::MC) {
+                const size_t mc = std::min(Blocking::MC, m - ic);
+                packA<SUBTRACT>(a.offset(ic, pc), mc, kc, packed_a.data());
+
+                for (size_t jr = 0; jr < nc; jr += NR) {
+                    for (size_t ir = 0; ir < mc; ir += MR) {
+                        gemmMicroKernel(
+                            kc,
+                            packed_a.data() + ir * kc,
+                            packed_b.data() + jr * kc,
+                            c.offset(ic + ir, jc + jr),
+                            std::min(MR, mc - ir),
+                            std::min(NR, nc - jr),
+                            finish,
+                            jc + jr);
+                    }
+                }
+            }
+        }
+    }
+}
+
+// C (m x n) += A (m x k) * B (k x n), see gemmBlocked().
+template <typename T, typename Epilogue = NoEpilogue>
+void gemm(size_t m, size_t n, size_t k, Strided<const T> a, Strided<const T> b, Strided<T> c, const Epilogue& epilogue = {})
+{
+    gemmBlocked<false>(m, n, k, a, b, c, epilogue);
+}
+
+// C (m x n) -= A (m x k) * B (k x n), A is negated while it is packed.
+template <typename T>
+void gemmSubtract(size_t m, size_t n, size_t k, Strided<const T> a, Strided<const T> b, Strided<T> c)
+{
+    gemmBlocked<true>(m, n, k, a, b, c, NoEpilogue {});
+}
+
+// Dot product of two contiguous runs of n elements. 16 bit runs are widened to float packs
+// and summed in float.
+template <typename T>
+Accumulator<T> dot(size_t n, const T* a, const T* b)
+{
+    if constexpr (HalfPrecision<T>) {
+        constexpr size_t W = GemmBlocking<float>::W;
+        using P = Simd::Pack<float, W>;
+        P acc0 = P::zero();
+        P acc1 = P::zero();
+        size_t i = 0;
+        for (; i + 2 * W <= n; i += 2 * W) {
+            acc0 = mulAdd(Simd::loadWidened<W>(a + i), Simd::loadWidened<W>(b + i), acc0);
+            acc1 = mulAdd(Simd::loadWidened<W>(a + i + W), Simd::loadWidened<W>(b + i + W), acc1);
+        }
+        float result = reduceAdd(acc0 + acc1);
+        for (; i < n; ++i) {
+            result += a[i] * b[i];
+        }
+        return result;
+    }
+    constexpr size_t W = GemmBlocking<T>::W;
+    using P = Simd::Pack<T, W>;
+
+    P acc0 = P::zero();
+    P acc1 = P::zero();
+    size_t i = 0;
+    for (; i + 2 * W <= n; i += 2 * W) {
+        acc0 = mulAdd(P::load(a + i), P::load(b + i), acc0);
+        acc1 = mulAdd(P::load(a + i + W), P::load(b + i + W), acc1);
+    }
+    for (; i + W <= n; i += W) {
+        acc0 = mulAdd(P::load(a + i), P::load(b + i), acc0);
+    }
+    T result = reduceAdd(acc0 + acc1);
+    for (; i < n; ++i) {
+        result += a[i] * b[i];
+    }
+    return result;
+}
+
+// y (n) += a * x (n)
+template <typename T>
+void axpy(size_t n, T a, const T* x, T* y)
+{
+    using P = Simd::Pack<T, GemmBlocking<T>::W>;
+    constexpr size_t W = P::width;
+    const P scale = P::broadcast(a);
+    size_t i = 0;
+    for (; i + W <= n; i += W) {
+        mulAdd(scale, P::load(x + i), P::load(y + i)).store(y + i);
+    }
+    for (; i < n; ++i) {
+        y[i] += a * x[i];
+    }
+}
+
+constexpr size_t REDUCE_BLOCK = 1 << 14;
+constexpr size_t PAIRWISE_BASE = 256;
+
+/*
+    Sum of term(a[i], b[i]) over [0, n) with packs, term maps two packs to a pack and must
+    return zero for zero lanes. Halves the range down to PAIRWISE_BASE elements, which are
+    summed with two accumulators.
+*/
+template <typename P, typename T, typename F>
+T pairwiseReduce(size_t n, const T* a, const T* b, const F& term)
+{
+    constexpr size_t W = P::width;
+    if (n > PAIRWISE_BASE) {
+        const size_t half = (n / 2 + W - 1) / W * W;
+        return pairwiseReduce<P>(half, a, b, term) + pairwiseReduce<P>(n - half, a + half, b + half, term);
+    }
+    P acc0 = P::zero();
+    P acc1 = P::zero();
+    size_t i = 0;
+    for (; i + 2 * W <= n; i += 2 * W) {
+        acc0 = acc0 + term(P::load(a + i), P::load(b + i));
+        acc1 = acc1 + term(P::load(a + i + W), P::load(b + i + W));
+    }
+    for (; i < n; i += W) {
+        const size_t lanes = std::min(W, n - i);
+        acc0 = acc0 + term(P::loadPartial(a + i, lanes), P::loadPartial(b + i, lanes));
+    }
+    return reduceAdd(acc0 + acc1);
+}
+
+// Kahan compensated sum of values[0, n).
+template <typename T>
+T kahanSum(size_t n, const T* values)
+{
+    T sum = 0;
+    T compensation = 0;
+    for (size_t i = 0; i < n; ++i) {
+        const T y = values[i] - compensation;
+        const T t = sum + y;
+        compensation = (t - sum) - y;
+        sum = t;
+    }
+    return sum;
+}
+
+// pairwiseReduce() as a Kahan sum. Every lane of the two interleaved accumulators carries its
+// own compensation, the accumulators are combined at the end.
+template <typename P, typename T, typename F>
+T kahanReduce(size_t n, const T* a, const T* b, const F& term)
+{
+    constexpr size_t W = P::width;
+    P sum[2] = { P::zero(), P::zero() };
+    P compensation[2] = { P::zero(), P::zero() };
+    auto accumulate = [&](size_t k, const P& value) {
+        const P y = value - compensation[k];
+        const P t = sum[k] + y;
+        compensation[k] = (t - sum[k]) - y;
+        sum[k] = t;
+    };
+
+    size_t i = 0;
+    for (; i + 2 * W <= n; i += 2 * W) {
+        accumulate(0, term(P::load(a + i), P::load(b + i)));
+        accumulate(1, term(P::load(a + i + W), P::load(b + i + W)));
+    }
+    for (; i < n; i += W) {
+        const size_t lanes = std::min(W, n - i);
+        accumulate(0, term(P::loadPartial(a + i, lanes), P::loadPartial(b + i, lanes)));
+    }
+    alignas(32) T lanes[2 * W];
+    (sum[0] - compensation[0]).store(lanes);
+    (sum[1] - compensation[1]).store(lanes + W);
+    return kahanSum(2 * W, lanes);
+}
+
+// Pairwise sum of values[0, n).
+template <typename T>
+T pairwiseSum(size_t n, const T* values)
+{
+    if (n <= 2) {
+        return n == 0 ? T {} : (n == 1 ? values[0] : values[0] + values[1]);
+    }
+    const size_t half = n / 2;
+    return pairwiseSum(half, values) + pairwiseSum(n - half, values + half);
+}
+
+/*
+    Sum of term(a[i], b[i]) over [0, n) in REDUCE_BLOCK sized blocks, concurrently on pool
+    when it is given. The blocks and the order their sums are combined in are fixed, so the
+    result is the same with and without a pool. 16 bit blocks are converted to float first and
+    reduced in float.
+*/
+template <typename T, typename F>
+Accumulator<T> blockedReduce(Parallel::ThreadPool* pool, size_t n, const T* a, const T* b, Summation summation, const F& term)
+{
+    using A = Accumulator<T>;
+    using P = Simd::Pack<A, Simd::NATIVE_WIDTH<A>>;
+    auto reduceBlock = [&](size_t block) {
+        const size_t begin = block * REDUCE_BLOCK;
+        const size_t count = std::min(REDUCE_BLOCK, n - begin);
+        const A* block_a;
+        const A* block_b;
+        if constexpr (HalfPrecision<T>) {
+            thread_local std::vector<A> wide;
+            wide.resize(2 * REDUCE_BLOCK);
+            convert(std::span(a + begin, count), std::span(wide.data(), count));
+            convert(std::span(b + begin, count), std::span(wide.data() + REDUCE_BLOCK, count));
+            block_a = wide.data();
+            block_b = wide.data() + REDUCE_BLOCK;
+        } else {
+            block_a = a + begin;
+            block_b = b + begin;
+        }
+        return summation == Summation::Kahan
+            ? kahanReduce<P>(count, block_a, block_b, term)
+            : pairwiseReduce<P>(count, block_a, block_b, term);
+    };
+
+    const size_t blocks = (n + REDUCE_BLOCK - 1) / REDUCE_BLOCK;
+    if (blocks <= 1) {
+        return blocks == 0 ? A {} : reduceBlock(0);
+    }
+    std::vector<A> sums(blocks);
+    if (pool) {
+        pool->parallelFor(blocks, [&](size_t block) { sums[block] = reduceBlock(block); });
+    } else {
+        for (size_t block = 0; block < blocks; ++block) {
+            sums[block] = reduceBlock(block);
+        }
+    }
+    return summation == Summation::Kahan ? kahanSum(blocks, sums.data()) : pairwiseSum(blocks, sums.data());
+}
+
+/*
+    out[i] = op(a[i], b[i]) over [0, n) in REDUCE_BLOCK sized blocks, concurrently on pool
+    when it is given. op maps two packs to a pack.
+*/
+template <typename T, typename F>
+void blockedTransform(Parallel::ThreadPool* pool, size_t n, const T* a, const T* b, T* out, const F& op)
+{
+    using P = Simd::Pack<T, Simd::NATIVE_WIDTH<T>>;
+    constexpr size_t W = P::width;
+    auto transformBlock = [&](size_t block) {
+        const size_t begin = block * REDUCE_BLOCK;
+        const size_t end = std::min(n, begin + REDUCE_BLOCK);
+        size_t i = begin;
+        for (; i + W <= end; i += W) {
+            op(P::load(a + i), P::load(b + i)).store(out + i);
+        }
+        if (i < end) {
+            op(P::loadPartial(a + i, end - i), P::loadPartial(b + i, end - i)).storePartial(out + i, end - i);
+        }
+    };
+
+    const size_t blocks = (n + REDUCE_BLOCK - 1) / REDUCE_BLOCK;
+    if (pool) {
+        pool->parallelFor(blocks, transformBlock);
+    } else {
+        for (size_t block = 0; block < blocks; ++block) {
+            transformBlock(block);
+        }
+    }
+}
+
+/*
+    Matrix vector product, y (m) += A (m x n) * x (n).
+    Rows of A are read contiguously when A is row-major, a column-major A is added to y
+    four columns at a time instead so y is loaded and stored once per four columns.
+*/
+template <typename T>
+void gemv(size_t m, size_t n, Strided<const T> a, const T* x, T* y)
+{
+    if constexpr (!HalfPrecision<T>) {
+        if (a.col_stride != 1 && a.row_stride == 1) {
+            using P = Simd::Pack<T, GemmBlocking<T>::W>;
+            constexpr size_t W = P::width;
+            size_t col = 0;
+            for (; col + 4 <= n; col += 4) {
+                const T* c0 = &a.at(0, col);
+                const T* c1 = &a.at(0, col + 1);
+                const T* c2 = &a.at(0, col + 2);
+                const T* c3 = &a.at(0, col + 3);
+                const P x0 = P::broadcast(x[col]);
+                const P x1 = P::broadcast(x[col + 1]);
+                const P x2 = P::broadcast(x[col + 2]);
+                const P x3 = P::broadcast(x[col + 3]);
+                size_t row = 0;
+                for (; row + W <= m; row += W) {
+                    P sum = mulAdd(x0, P::load(c0 + row), P::load(y + row));
+                    sum = mulAdd(x1, P::load(c1 + row), sum);
+                    sum = mulAdd(x2, P::load(c2 + row), sum);
+                    mulAdd(x3, P::load(c3 + row), sum).store(y + row);
+                }
+                for (; row < m; ++row) {
+                    y[row] += x[col] * c0[row] + x[col + 1] * c1[row] + x[col + 2] * c2[row] + x[col + 3] * c3[row];
+                }
+            }
+            for (; col < n; ++col) {
+                axpy(m, x[col], &a.at(0, col), y);
+            }
+            return;
+        }
+    }
+    for (size_t row = 0; row < m; ++row) {
+        if (a.col_stride == 1) {
+            y[row] += dot(n, &a.at(row, 0), x);
+        } else {
+            Accumulator<T> value = {};
+            for (size_t col = 0; col < n; ++col) {
+                value += a.at(row, col) * x[col];
+            }
+            y[row] += value;
+        }
+    }
+}
+
+// Tiled products need whole packs per tile row, 16 bit elements go through gemm() instead.
+template <typename T, size_t TILE>
+inline constexpr bool TILED_KERNELS = !HalfPrecision<T> && TILE % GemmBlocking<T>::W == 0;
+
+/*
+    Micro-kernel of tiledGemm() for TILES neighbouring C tiles of one tile row. ROWS rows of
+    each C tile stay in registers while the matching columns of the A tiles and rows of the
+    B tiles stream past, tiles_n is the B row length in tiles.
+*/
+template <size_t TILE, size_t TILES, typename T>
+void tiledMicroKernel(size_t tiles_k, size_t tiles_n, const T* a, const T* b, T* c)
+{
+    constexpr size_t W = GemmBlocking<T>::W;
+    constexpr size_t AREA = TILE * TILE;
+    constexpr size_t PACKS = TILES * TILE / W;
+    constexpr size_t ROWS = [] {
+        size_t rows = std::max<size_t>(1, std::min(TILE, 12 / PACKS));
+        while (TILE % rows != 0) {
+            --rows;
+        }
+        return rows;
+    }();
+    using P = Simd::Pack<T, W>;
+    // Offset of pack p of a tile row, packs of the next tile follow the last pack of a row.
+    auto packOffset = [](size_t p) { return (p * W / TILE) * AREA + (p * W) % TILE; };
+
+    for (size_t r0 = 0; r0 < TILE; r0 += ROWS) {
+        P acc[ROWS][PACKS];
+        for (size_t r = 0; r < ROWS; ++r) {
+            for (size_t p = 0; p < PACKS; ++p) {
+                acc[r][p] = P::load(c + (r0 + r) * TILE + packOffset(p));
+            }
+        }
+        for (size_t t = 0; t < tiles_k; ++t) {
+            const T* a_tile = a + t * AREA + r0 * TILE;
+            const T* b_tile = b + t * tiles_n * AREA;
+            for (size_t kk = 0; kk < TILE; ++kk) {
+                P b_row[PACKS];
+                for (size_t p = 0; p < PACKS; ++p) {
+                    b_row[p] = P::load(b_tile + kk * TILE + packOffset(p));
+                }
+                for (size_t r = 0; r < ROWS; ++r) {
+                    const P a_r = P::broadcast(a_tile[r * TILE + kk]);
+                    for (size_t p = 0; p < PACKS; ++p) {
+                        acc[r][p] = mulAdd(a_r, b_row[p], acc[r][p]);
+                    }
+                }
+            }
+        }
+        for (size_t r = 0; r < ROWS; ++r) {
+            for (size_t p = 0; p < PACKS; ++p) {
+                acc[r][p].store(c + (r0 + r) * TILE + packOffset(p));
+            }
+        }
+    }
+}
+
+/*
+    C (m x n) += A (m x k) * B (k x n) for matrices in the Tiled<TILE> layout.
+    The tiles are already contiguous panels, so unlike gemm() nothing is packed, two C tiles
+    of a tile row are produced per micro-kernel call.
+*/
+template <size_t TILE, typename T>
+    requires TILED_KERNELS<T, TILE>
+void tiledGemm(size_t m, size_t n, size_t k, const T* a, const T* b, T* c)
+{
+    constexpr size_t AREA = TILE * TILE;
+    const size_t tiles_n = n / TILE;
+    const size_t tiles_k = k / TILE;
+    for (size_t i = 0; i < m / TILE; ++i) {
+        const T* a_row = a + i * tiles_k * AREA;
+        T* c_row = c + i * tiles_n * AREA;
+        size_t j = 0;
+        for (; j + 2 <= tiles_n; j += 2) {
+            tiledMicroKernel<TILE, 2>(tiles_k, tiles_n, a_row, b + j * AREA, c_row + j * AREA);
+        }
+        for (; j < tiles_n; ++j) {
+            tiledMicroKernel<TILE, 1>(tiles_k, tiles_n, a_row, b + j * AREA, c_row + j * AREA);
+        }
+    }
+}
+
+/*
+    Matrix vector product for Tiled<TILE> matrices, y (m) += A (m x n) * x (n), or
+    y (n) += x (m) * A when TRANSPOSED. Both read every tile once and contiguously.
+*/
+template <size_t TILE, bool TRANSPOSED, typename T>
+void tiledGemv(size_t m, size_t n, const T* a, const T* x, T* y)
+{
+    constexpr size_t AREA = TILE * TILE;
+    const size_t tiles_n = n / TILE;
+    for (size_t i = 0; i < m / TILE; ++i) {
+        const T* x_tile = TRANSPOSED ? x + i * TILE : nullptr;
+        T* y_tile = TRANSPOSED ? nullptr : y + i * TILE;
+        if constexpr (!TILED_KERNELS<T, TILE> && TRANSPOSED) {
+            for (size_t t = 0; t < tiles_n; ++t) {
+                const T* tile = a + (i * tiles_n + t) * AREA;
+                for (size_t col = 0; col < TILE; ++col) {
+                    Accumulator<T> value = {};
+                    for (size_t r = 0; r < TILE; ++r) {
+                        value += x_tile[r] * tile[r * TILE + col];
+                    }
+                    y[t * TILE + col] += value;
+                }
+            }
+        } else if constexpr (!TILED_KERNELS<T, TILE>) {
+            for (size_t r = 0; r < TILE; ++r) {
+                Accumulator<T> value = {};
+                for (size_t t = 0; t < tiles_n; ++t) {
+                    const T* tile_row = a + (i * tiles_n + t) * AREA + r * TILE;
+                    for (size_t col = 0; col < TILE; ++col) {
+                        value += tile_row[col] * x[t * TILE + col];
+                    }
+                }
+                y_tile[r] += value;
+            }
+        } else if constexpr (TRANSPOSED) {
+            constexpr size_t W = GemmBlocking<T>::W;
+            using P = Simd::Pack<T, W>;
+            for (size_t t = 0; t < tiles_n; ++t) {
+                const T* tile = a + (i * tiles_n + t) * AREA;
+                for (size_t p = 0; p < TILE; p += W) {
+                    P sum = P::load(y + t * TILE + p);
+                    for (size_t r = 0; r < TILE; ++r) {
+                        sum = mulAdd(P::broadcast(x_tile[r]), P::load(tile + r * TILE + p), sum);
+                    }
+                    sum.store(y + t * TILE + p);
+                }
+            }
+        } else {
+            constexpr size_t W = GemmBlocking<T>::W;
+            using P = Simd::Pack<T, W>;
+            P acc[TILE];
+            for (size_t r = 0; r < TILE; ++r) {
+                acc[r] = P::zero();
+            }
+            for (size_t t = 0; t < tiles_n; ++t) {
+                const T* tile = a + (i * tiles_n + t) * AREA;
+                for (size_t p = 0; p < TILE; p += W) {
+                    const P x_pack = P::load(x + t * TILE + p);
+                    for (size_t r = 0; r < TILE; ++r) {
+                        acc[r] = mulAdd(P::load(tile + r * TILE + p), x_pack, acc[r]);
+                    }
+                }
+            }
+            for (size_t r = 0; r < TILE; ++r) {
+                y_tile[r] += reduceAdd(acc[r]);
+            }
+        }
+    }
+}
+
+/*
+    Fused dense layer, y (m) = activation(W (m x n) * x (n) + bias).
+    Produces W rows at a time so the bias add and activation run on packs.
+*/
+template <typename T, typename F>
+void denseGemv(size_t m, size_t n, Strided<const T> w, const T* x, const T* bias, const F& activation, T* y)
+{
+    using P = Simd::Pack<T, GemmBlocking<T>::W>;
+    constexpr size_t W = P::width;
+    for (size_t row = 0; row < m; row += W) {
+        const size_t lanes = std::min(W, m - row);
+        alignas(32) T sums[W] = {};
+        gemv<T>(lanes, n, w.offset(row, 0), x, sums);
+        activation(P::load(sums) + P::loadPartial(bias + row, lanes)).storePartial(y + row, lanes);
+    }
+}
+
+/*
+    gemm() with C split into tiles that are computed concurrently on the thread pool.
+*/
+template <typename T>
+void parallelGemm(Parallel::ThreadPool& pool, size_t m, size_t n, size_t k, Strided<const T> a, Strided<const T> b, Strided<T> c)
+{
+    constexpr size_t TILE_ROWS = GemmBlocking<Accumulator<T>>::MC;
+    constexpr size_t TILE_COLS = GemmBlocking<Accumulator<T>>::NR * 16;
+    const size_t row_tiles = (m + TILE_ROWS - 1) / TILE_ROWS;
+    const size_t col_tiles = (n + TILE_COLS - 1) / TILE_COLS;
+
+    pool.parallelFor(row_tiles * col_tiles, [&](size_t tile) {
+        const size_t row = (tile / col_tiles) * TILE_ROWS;
+        const size_t col = (tile % col_tiles) * TILE_COLS;
+        gemm<T>(
+            std::min(TILE_ROWS, m - row),
+            std::min(TILE_COLS, n - col),
+            k,
+            a.offset(row, 0),
+            b.offset(0, col),
+            c.offset(row, col));
+    });
+}
+
+/*
+    gemv() with the rows of A split into blocks that are computed concurrently.
+*/
+template <typename T>
+void parallelGemv(Parallel::ThreadPool& pool, size_t m, size_t n, Strided<const T> a, const T* x, T* y)
+{
+    constexpr size_t BLOCK_ROWS = 64;
+    const size_t blocks = (m + BLOCK_ROWS - 1) / BLOCK_ROWS;
+    pool.parallelFor(blocks, [&](size_t block) {
+        const size_t row = block * BLOCK_ROWS;
+        gemv<T>(std::min(BLOCK_ROWS, m - row), n, a.offset(row, 0), x, y + row);
+    });
+}
+
+constexpr size_t LU_BLOCK = 32;
+
+/*
+    Blocked, partially pivoted LU factorisation of the n x n matrix A in place.
+    A becomes L (unit diagonal, below) and U (on and above), rows are swapped whole and
+    recorded in permutation. Each LU_BLOCK wide panel is factored unblocked, then the
+    trailing matrix is updated with one gemm(). Returns false if a zero pivot was found.
+*/
+template <typename T>
+bool luFactor(size_t n, Strided<T> a, size_t* permutation, T& sign)
+{
+    bool regular = true;
+    sign = T { 1 };
+    std::iota(permutation, permutation + n, size_t { 0 });
+
+    for (size_t k = 0; k < n; k += LU_BLOCK) {
+        const size_t kb = std::min(LU_BLOCK, n - k);
+        const size_t panel_end = k + kb;
+
+        for (size_t j = k; j < panel_end; ++j) {
+            size_t pivot = j;
+            for (size_t i = j + 1; i < n; ++i) {
+                if (std::abs(a.at(i, j)) > std::abs(a.at(pivot, j))) {
+                    pivot = i;
+                }
+            }
+            if (pivot != j) {
+                for (size_t col = 0; col < n; ++col) {
+                    std::swap(a.at(j, col), a.at(pivot, col));
+                }
+                std::swap(permutation[j], permutation[pivot]);
+                sign = -sign;
+            }
+            const T diagonal = a.at(j, j);
+            if (diagonal == T { 0 }) {
+                regular = false;
+                continue;
+            }
+            for (size_t i = j + 1; i < n; ++i) {
+                const T l = a.at(i, j) /= diagonal;
+                for (size_t col = j + 1; col < panel_end; ++col) {
+                    a.at(i, col) -= l * a.at(j, col);
+                }
+            }
+        }
+        if (panel_end == n) {
+            break;
+        }
+
+        // U12 = L11^-1 A12
+        for (size_t i = k + 1; i < panel_end; ++i) {
+            for (size_t j = k; j < i; ++j) {
+                const T l = a.at(i, j);
+                for (size_t col = panel_end; col < n; ++col) {
+                    a.at(i, col) -= l * a.at(j, col);
+                }
+            }
+        }
+
+        // A22 -= L21 U12, both read in place
+        const size_t rest = n - panel_end;
+        gemmSubtract<T>(rest, rest, kb, a.offset(panel_end, k), a.offset(k, panel_end), a.offset(panel_end, panel_end));
+    }
+    return regular;
+}
+
+/*
+    dst[i] = M * src[i] + t over count packed xyz triples, columns holds M's three columns
+    then t, four (padded) elements each. dst may be src, otherwise the ranges must not overlap.
+    One triple per 4 lane pack: three column broadcasts and multiply-adds. The fourth lane
+    spills into the next triple and is overwritten by it, so only the last triple (or every
+    triple when working in place) needs a partial store.
+*/
+template <typename T>
+void affineTransform3(const T (&columns)[4][4], const T* src, T* dst, size_t count)
+{
+    using P = Simd::Pack<T, 4>;
+    if (count == 0) {
+        return;
+    }
+    // The padded store of triple i writes the first element of triple i + 1
+    assert(src == dst || !std::less<const T*> {}(dst, src + 3 * count) || !std::less<const T*> {}(src, dst + 3 * count));
+    const P c0 = P::load(columns[0]);
+    const P c1 = P::load(columns[1]);
+    const P c2 = P::load(columns[2]);
+    const P t = P::load(columns[3]);
+
+    auto transformOne = [&](size_t i) {
+        const T* point = src + 3 * i;
+        return mulAdd(c2, P::broadcast(point[2]), mulAdd(c1, P::broadcast(point[1]), mulAdd(c0, P::broadcast(point[0]), t)));
+    };
+
+    const size_t full = src == dst ? 0 : count - 1;
+    for (size_t i = 0; i < full; ++i) {
+        transformOne(i).store(dst + 3 * i);
+    }
+    for (size_t i = full; i < count; ++i) {
+        transformOne(i).storePartial(dst + 3 * i, 3);
+    }
+}
+
+}
+
+// Linear Algebra (Graphics and 3D)
+namespace Math::LinearAlgebra {
+/*
+    Storage orders for Mat, index<R, C>(row, col) is the offset of an element in Mat::data.
+    ColumnMajor matches column-major producers, so their buffers are copied in as they are.
+    Tiled<TILE> stores TILE x TILE row-major tiles one after another in row-major order, each
+    tile is a contiguous block for the product kernels. R and C must be multiples of TILE.
+*/
+struct RowMajor {
+    template <size_t R, size_t C>
+    static constexpr size_t index(size_t row, size_t col)
+    {
+        return row * C + col;
+    }
+};
+struct ColumnMajor {
+    template <size_t R, size_t C>
+    static constexpr size_t index(size_t row, size_t col)
+    {
+        return col * R + row;
+    }
+};
+template <size_t SIZE = 8>
+struct Tiled {
+    static constexpr size_t TILE = SIZE;
+
+    template <size_t R, size_t C>
+    static constexpr size_t index(size_t row, size_t col)
+    {
+        return ((row / TILE) * (C / TILE) + col / TILE) * (TILE * TILE) + (row % TILE) * TILE + col % TILE;
+    }
+};
+
+// Layouts with a fixed row and column stride, these can be handed to the strided kernels and views.
+template <typename L>
+concept StridedLayout = std::is_same_v<L, RowMajor> || std::is_same_v<L, ColumnMajor>;
+template <typename L>
+concept TiledLayout = requires { L::TILE; } && std::is_same_v<L, Tiled<L::TILE>>;
+
+// Type declarations
+template <size_t N, typename T = float>
+class Pos;
+template <size_t N, typename T = float>
+class Vec;
+template <size_t N, typename T = float>
+class Ray;
+template <size_t R, size_t C, typename T = float, typename Layout = RowMajor>
+class Mat;
+template <typename T = float>
+class DynVec;
+template <typename T = float>
+class DynMat;
+template <typename T>
+class VecView;
+template <typename T>
+class MatView;
+
+namespace Kernel {
+    // Kernel operand for a Mat of any layout, tiled storage is copied to row-major first.
+    template <size_t R, size_t C, typename T, typename Layout>
+    Strided<const T> stridedOperand(const Mat<R, C, T, Layout>& mat, std::unique_ptr<Mat<R, C, T>>& copy);
+}
+
+/*
+    Expression templates for element-wise Vec and Mat arithmetic.
+    The operators build an ElementExpr instead of a result, nothing is computed until the
+    expression is assigned or converted to a Vec / Mat. That evaluates the whole chain in one
+    loop, so `Vec<N> v = a + b * s - c;` makes a single pass with no intermediates.
+    Named Vec / Mat operands are held by reference, so an `auto` expression must not outlive them.
+*/
+template <typename X>
+struct ElementwiseTraits {
+    static constexpr bool enabled = false;
+    static constexpr bool is_expression = false;
+};
+template <size_t N, typename T>
+struct ElementwiseTraits<Vec<N, T>> {
+    static constexpr bool enabled = true;
+    static constexpr bool is_expression = false;
+    static constexpr bool is_vec = true;
+    using result_type = Vec<N, T>;
+    using value_type = T;
+    static constexpr size_t SIZE = N;
+};
+template <size_t R, size_t C, typename T, typename Layout>
+struct ElementwiseTraits<Mat<R, C, T, Layout>> {
+    static constexpr bool enabled = true;
+    static constexpr bool is_expression = false;
+    static constexpr bool is_vec = false;
+    using result_type = Mat<R, C, T, Layout>;
+    using value_type = T;
+    static constexpr size_t SIZE = R * C;
+};
+
+template <typename X>
+concept Elementwise = ElementwiseTraits<std::remove_cvref_t<X>>::enabled;
+
+template <typename X>
+concept ElementExpression = ElementwiseTraits<std::remove_cvref_t<X>>::is_expression;
+
+template <typename X, typename Result>
+concept ElementExpressionOf = ElementExpression<X> && std::is_same_v<typename std::remove_cvref_t<X>::result_type, Result>;
+
+template <typename A, typename B>
+concept SameShape = Elementwise<A> && Elementwise<B>
+    && std::is_same_v<typename ElementwiseTraits<std::remove_cvref_t<A>>::result_type, typename ElementwiseTraits<std::remove_cvref_t<B>>::result_type>;
+
+template <typename X>
+concept VecElementwise = Elementwise<X> && ElementwiseTraits<std::remove_cvref_t<X>>::is_vec;
+
+template <typename S, typename X>
+concept ScalarOf = !Elementwise<S> && std::is_convertible_v<S, typename ElementwiseTraits<std::remove_cvref_t<X>>::value_type>;
+
+namespace Expr {
+    // Leaf for a named Vec / Mat, reads through its data.
+    template <typename T>
+    struct Ref {
+        const T* data;
+        constexpr T at(size_t index) const
+        {
+            return data[index];
+        }
+        template <typename P>
+        P pack(size_t index) const
+        {
+            return P::load(data + index);
+        }
+        template <typename P>
+        P packPartial(size_t index, size_t count) const
+        {
+            return P::loadPartial(data + index, count);
+        }
+    };
+
+    // Leaf owning a temporary Vec / Mat.
+    template <typename X>
+    struct Owned {
+        X value;
+        constexpr auto at(size_t index) const
+        {
+            return value.data[index];
+        }
+        template <typename P>
+        P pack(size_t index) const
+        {
+            return P::load(value.data + index);
+        }
+        template <typename P>
+        P packPartial(size_t index, size_t count) const
+        {
+            return P::loadPartial(value.data + index, count);
+        }
+    };
+
+    template <typename T>
+    struct Scalar {
+        T value;
+        constexpr T at(size_t) const
+        {
+            return value;
+        }
+        template <typename P>
+        P pack(size_t) const
+        {
+            return P::broadcast(value);
+        }
+        template <typename P>
+        P packPartial(size_t, size_t) const
+        {
+            return P::broadcast(value);
+        }
+    };
+
+    struct Negate {
+        template <typename X>
+        constexpr X operator()(const X& x) const
+        {
+            if constexpr (std::is_arithmetic_v<X>) {
+                return -x;
+            } else {
+                return X::zero() - x;
+            }
+        }
+    };
+
+    template <typename X>
+    constexpr auto operand(X&& x)
+    {
+        using D = std::remove_cvref_t<X>;
+        if constexpr (ElementExpression<D>) {
+            return D(std::forward<X>(x));
+        } else if constexpr (std::is_lvalue_reference_v<X>) {
+            return Ref<typename ElementwiseTraits<D>::value_type> { x.data };
+        } else {
+            return Owned<D> { std::forward<X>(x) };
+        }
+    }
+
+    // An expression's result, or the Vec / Mat itself.
+    template <typename X>
+    constexpr decltype(auto) evaluate(const X& x)
+    {
+        if constexpr (ElementExpression<X>) {
+            return x.eval();
+        } else {
+            return (x);
+        }
+    }
+
+    template <typename X, typename S>
+    constexpr auto scalar(S value)
+    {
+        using T = typename ElementwiseTraits<std::remove_cvref_t<X>>::value_type;
+        return Scalar<T> { static_cast<T>(value) };
+    }
+}
+
+template <typename Result, typename Op, typename... Operands>
+class ElementExpr {
+public:
+    using result_type = Result;
+    using value_type = typename ElementwiseTraits<Result>::value_type;
+    static constexpr size_t SIZE = ElementwiseTraits<Result>::SIZE;
+
+    constexpr explicit ElementExpr(Op op, Operands... operands)
+        : m_op(op)
+        , m_operands(std::move(operands)...)
+    {
+    }
+
+    constexpr value_type at(size_t index) const
+    {
+        return std::apply([&](const auto&... operand) { return static_cast<value_type>(m_op(operand.at(index)...)); }, m_operands);
+    }
+    template <typename P>
+    P pack(size_t index) const
+    {
+        return std::apply([&](const auto&... operand) { return m_op(operand.template pack<P>(index)...); }, m_operands);
+    }
+    // Only the first count lanes read memory, the rest are zero or broadcast.
+    template <typename P>
+    P packPartial(size_t index, size_t count) const
+    {
+        return std::apply([&](const auto&... operand) { return m_op(operand.template packPartial<P>(index, count)...); }, m_operands);
+    }
+
+    // Evaluates every element into out, packs at a time at runtime.
+    constexpr void evaluateInto(value_type* out) const
+    {
+        size_t tail = 0;
+        if !consteval {
+            // Vec<3> / Vec<4> are narrower than an AVX register, use the Vec kernel's pack.
+            using Narrow = Simd::VecKernel<SIZE, value_type>;
+            if constexpr (Narrow::enabled && SIZE < Simd::NATIVE_WIDTH<value_type>) {
+                using P = typename Narrow::P;
+                if constexpr (SIZE == P::width) {
+                    pack<P>(0).store(out);
+                } else {
+                    packPartial<P>(0, SIZE).storePartial(out, SIZE);
+                }
+                return;
+            }
+            using P = Simd::Pack<value_type, Simd::NATIVE_WIDTH<value_type>>;
+            constexpr size_t PACKED = SIZE - SIZE % P::width;
+            for (size_t i = 0; i < PACKED; i += P::width) {
+                pack<P>(i).store(out + i);
+            }
+            tail = PACKED;
+        }
+        for (size_t i = tail; i < SIZE; ++i) {
+            out[i] = at(i);
+        }
+    }
+
+    constexpr Result eval() const
+    {
+        return Result(*this);
+    }
+    constexpr operator Result() const
+    {
+        return eval();
+    }
+
+    constexpr value_type operator[](size_t index) const
+        requires(ElementwiseTraits<Result>::is_vec)
+    {
+        assert(index < SIZE);
+        return at(index);
+    }
+    constexpr size_t size() const
+        requires(ElementwiseTraits<Result>::is_vec)
+    {
+        return SIZE;
+    }
+    constexpr value_type getLengthSquared() const
+        requires(ElementwiseTraits<Result>::is_vec)
+    {
+        return eval().getLengthSquared();
+    }
+    constexpr value_type getLength() const
+        requires(ElementwiseTraits<Result>::is_vec)
+    {
+        return eval().getLength();
+    }
+    constexpr Result getNormalised() const
+        requires(ElementwiseTraits<Result>::is_vec)
+    {
+        return eval().getNormalised();
+    }
+
+    constexpr bool operator==(const Result& other) const
+    {
+        return eval() == other;
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const ElementExpr& expr)
+    {
+        return os << expr.eval();
+    }
+
+private:
+    [[no_unique_address]] Op m_op;
+    std::tuple<Operands...> m_operands;
+};
+
+template <typename Result, typename Op, typename... Operands>
+struct ElementwiseTraits<ElementExpr<Result, Op, Operands...>> {
+    static constexpr bool enabled = true;
+    static constexpr bool is_expression = true;
+    static constexpr bool is_vec = ElementwiseTraits<Result>::is_vec;
+    using result_type = Result;
+    using value_type = typename ElementwiseTraits<Result>::value_type;
+    static constexpr size_t SIZE = ElementwiseTraits<Result>::SIZE;
+};
+
+template <typename Result, typename Op, typename... Operands>
+constexpr auto makeElementExpr(Op op, Operands... operands)
+{
+    return ElementExpr<Result, Op, Operands...>(op, std::move(operands)...);
+}
+
+template <typename A, typename B>
+    requires SameShape<A, B>
+constexpr auto operator+(A&& a, B&& b)
+{
+    using Result = typename ElementwiseTraits<std::remove_cvref_t<A>>::result_type;
+    return makeElementExpr<Result>(std::plus {}, Expr::operand(std::forward<A>(a)), Expr::operand(std::forward<B>(b)));
+}
+template <typename A, typename B>
+    requires SameShape<A, B>
+constexpr auto operator-(A&& a, B&& b)
+{
+    using Result = typename ElementwiseTraits<std::remove_cvref_t<A>>::result_type;
+    return makeElementExpr<Result>(std::minus {}, Expr::operand(std::forward<A>(a)), Expr::operand(std::forward<B>(b)));
+}
+
+// Element-wise product and quotient, Vec only as Mat * Mat is the matrix product.
+template <typename A, typename B>
+    requires SameShape<A, B> && VecElementwise<A>
+constexpr auto operator*(A&& a, B&& b)
+{
+    using Result = typename ElementwiseTraits<std::remove_cvref_t<A>>::result_type;
+    return makeElementExpr<Result>(std::multiplies {}, Expr::operand(std::forward<A>(a)), Expr::operand(std::forward<B>(b)));
+}
+template <typename A, typename B>
+    requires SameShape<A, B> && VecElementwise<A>
+constexpr auto operator/(A&& a, B&& b)
+{
+    using Result = typename ElementwiseTraits<std::remove_cvref_t<A>>::result_type;
+    return makeElementExpr<Result>(std::divides {}, Expr::operand(std::forward<A>(a)), Expr::operand(std::forward<B>(b)));
+}
+
+template <typename A, typename S>
+    requires Elementwise<A> && ScalarOf<S, A>
+constexpr auto operator*(A&& a, S scalar)
+{
+    using Result = typename ElementwiseTraits<std::remove_cvref_t<A>>::result_type;
+    return makeElementExpr<Result>(std::multiplies {}, Expr::operand(std::forward<A>(a)), Expr::scalar<A>(scalar));
+}
+template <typename S, typename A>
+    requires Elementwise<A> && ScalarOf<S, A>
+constexpr auto operator*(S scalar, A&& a)
+{
+    return std::forward<A>(a) * scalar;
+}
+template <typename A, typename S>
+    requires Elementwise<A> && ScalarOf<S, A>
+constexpr auto operator/(A&& a, S scalar)
+{
+    using Result = typename ElementwiseTraits<std::remove_cvref_t<A>>::result_type;
+    return makeElementExpr<Result>(std::divides {}, Expr::operand(std::forward<A>(a)), Expr::scalar<A>(scalar));
+}
+template <typename S, typename A>
+    requires Elementwise<A> && ScalarOf<S, A>
+constexpr auto operator/(S scalar, A&& a)
+{
+    using Result = typename ElementwiseTraits<std::remove_cvref_t<A>>::result_type;
+    return makeElementExpr<Result>(std::divides {}, Expr::scalar<A>(scalar), Expr::operand(std::forward<A>(a)));
+}
+
+template <typename A>
+    requires Elementwise<A>
+constexpr auto operator-(A&& a)
+{
+    using Result = typename ElementwiseTraits<std::remove_cvref_t<A>>::result_type;
+    return makeElementExpr<Result>(Expr::Negate {}, Expr::operand(std::forward<A>(a)));
+}
+
+template <size_t N, typename T>
+class Vec {
+public:
+    T data[N];
+
+    constexpr Vec()
+        : data()
+    {
+    }
+
+    template <typename... Args>
+        requires(sizeof...(Args) == N && (std::is_convertible_v<Args, T> && ...))
+    constexpr Vec(Args... args)
+        : data { static_cast<T>(args)... }
+    {
+    }
+
+    // Evaluates an element-wise expression in one pass.
+    template <typename E>
+        requires ElementExpressionOf<E, Vec<N, T>>
+    constexpr Vec(const E& expr)
+    {
+        expr.evaluateInto(data);
+    }
+    template <typename E>
+        requires ElementExpressionOf<E, Vec<N, T>>
+    constexpr Vec<N, T>& operator=(const E& expr)
+    {
+        expr.evaluateInto(data);
+        return *this;
+    }
+
+    constexpr explicit Vec(const Pos<N, T>& pos);
+    constexpr explicit operator Pos<N, T>() const;
+
+    constexpr auto begin() -> T*
+    {
+        return data;
+    }
+    constexpr auto begin() const -> const T*
+    {
+        return data;
+    }
+    constexpr auto cbegin() const -> const T*
+    {
+        return data;
+    }
+    constexpr auto end() -> T*
+    {
+        return data + N;
+    }
+    constexpr auto end() const -> const T*
+    {
+        return data + N;
+    }
+    constexpr auto cend() const -> const T*
+    {
+        return data + N;
+    }
+
+    template <size_t S>
+    constexpr bool operator==(const Vec<S, T>& other) const
+    {
+        constexpr float TOLERANCE = equalityTolerance<T>(1e-6f);
+        auto abs = [](auto x) { return (x < 0) ? -x : x; };
+
+        if constexpr (S != N) {
+            return false;
+        } else {
+            return std::ranges::equal(*this, other, [&](const T& lhs, const T& rhs) { return abs(lhs - rhs) < TOLERANCE; });
+        }
+    }
+
+    template <size_t S>
+    constexpr bool operator!=(const Vec<S, T>& other) const
+    {
+        return !(*this == other);
+    }
+
+    template <typename X>
+        requires SameShape<X, Vec<N, T>>
+    constexpr Vec<N, T>& operator+=(X&& other)
+    {
+        return *this = *this + std::forward<X>(other);
+    }
+    template <typename X>
+        requires SameShape<X, Vec<N, T>>
+    constexpr Vec<N, T>& operator-=(X&& other)
+    {
+        return *this = *this - std::forward<X>(other);
+    }
+    template <typename S>
+        requires ScalarOf<S, Vec<N, T>>
+    constexpr Vec<N, T>& operator*=(S scalar)
+    {
+        return *this = *this * scalar;
+    }
+    template <typename S>
+        requires ScalarOf<S, Vec<N, T>>
+    constexpr Vec<N, T>& operator/=(S scalar)
+    {
+        return *this = *this / scalar;
+    }
+
+    constexpr T& operator[](size_t index)
+    {
+        assert(index < N);
+        return data[index];
+    }
+    constexpr const T& operator[](size_t index) const
+    {
+        assert(index < N);
+        return data[index];
+    }
+
+    constexpr T getLengthSquared() const
+    {
+        if !consteval {
+            if constexpr (Simd::VecKernel<N, T>::enabled) {
+                return Simd::VecKernel<N, T>::dot(data, data);
+            } else if constexpr (HalfPrecision<T>) {
+                return Kernel::dot(N, data, data);
+            }
+        }
+        return std::transform_reduce(
+            cbegin(), cend(),
+            cbegin(),
+            Accumulator<T> {},
+            std::plus {},
+            std::multiplies {});
+    }
+    constexpr T getLength() const
+    {
+        if constexpr (HalfPrecision<T>) {
+            // The squared length overflows half beyond a length of 256, take the root of the float sum.
+            if !consteval {
+                return Math::sqrt(Kernel::dot(N, data, data));
+            }
+            return Math::sqrt(std::transform_reduce(cbegin(), cend(), cbegin(), Accumulator<T> {}, std::plus {}, std::multiplies {}));
+        } else {
+            return Math::sqrt(getLengthSquared());
+        }
+    }
+
+    constexpr Vec<N, T> getNormalised() const
+    {
+        if !consteval {
+            if constexpr (Simd::VecKernel<N, T>::enabled) {
+                Vec<N, T> result;
+                Simd::VecKernel<N, T>::normalise(data, result.data);
+                return result;
+            }
+        }
+        return (*this) / getLength();
+    }
+
+    constexpr size_t size() const
+    {
+        return N;
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const Vec<N, T>& vec)
+    {
+        os << "{ ";
+        for (const auto& e : vec) {
+            os << e << " ";
+        }
+        os << '}';
+        return os;
+    }
+};
+
+template <size_t N, typename T>
+class Pos {
+public:
+    T data[N];
+
+    constexpr auto begin() -> T*
+    {
+        return data;
+    }
+    constexpr auto begin() const -> const T*
+    {
+        return data;
+    }
+    constexpr auto cbegin() const -> const T*
+    {
+        return data;
+    }
+    constexpr auto end() -> T*
+    {
+        return data + N;
+    }
+    constexpr auto end() const -> const T*
+    {
+        return data + N;
+    }
+    constexpr auto cend() const -> const T*
+    {
+        return data + N;
+    }
+
+    constexpr explicit operator Vec<N, T>() const;
+    constexpr bool operator==(const Pos<N, T>& other) const
+    {
+        constexpr float TOLERANCE = equalityTolerance<T>(1e-6f);
+        auto abs = [](auto x) { return (x < 0) ? -x : x; };
+        return std::ranges::equal(*this, other, [&](const T& lhs, const T& rhs) { return abs(lhs - rhs) < TOLERANCE; });
+    }
+    constexpr T& operator[](size_t index)
+    {
+        return data[index];
+    }
+    constexpr const T& operator[](size_t index) const
+    {
+        return data[index];
+    }
+};
+
+template <size_t N, typename T>
+constexpr Pos<N, T>::operator Vec<N, T>() const
+{
+    Vec<N, T> vec;
+    std::ranges::copy(this->data, this->data + N, vec.begin());
+    return vec;
+}
+template <size_t N, typename T>
+constexpr Vec<N, T>::operator Pos<N, T>() const
+{
+    Pos<N, T> pos;
+    std::ranges::copy(this->cbegin(), this->cend(), pos.data);
+    return pos;
+}
+template <size_t N, typename T>
+constexpr Vec<N, T>::Vec(const Pos<N, T>& pos)
+{
+    std::ranges::copy(pos.data, pos.data + N, this->begin());
+}
+
+template <size_t N, typename T>
+class Ray {
+private:
+    Pos<N, T> m_origin;
+    Vec<N, T> m_direction;
+
+public:
+    constexpr Ray()
+        : m_origin()
+        , m_direction()
+    {
+    }
+    constexpr Ray(const Pos<N, T>& origin, const Vec<N, T>& direction)
+        : m_origin(origin)
+        , m_direction(direction.getNormalised())
+    {
+    }
+    constexpr Ray& operator=(const Ray<N, T>& other)
+    {
+        m_origin = other.m_origin;
+        m_direction = other.m_direction;
+        return *this;
+    }
+    constexpr auto getOrigin() const -> const Pos<N, T>&
+    {
+        return m_origin;
+    }
+    constexpr auto getDirection() const -> const Vec<N, T>&
+    {
+        return m_direction;
+    }
+    constexpr void setOrigin(const Pos<N, T>& origin)
+    {
+        m_origin = origin;
+    }
+    constexpr void setDirection(const Vec<N, T>& direction)
+    {
+        m_direction = direction.getNormalised();
+    }
+    constexpr LinearAlgebra::Pos<N, T> getPointAlongRay(T t) const
+    {
+        Pos<N, T> point;
+        for (size_t i = 0; i < N; i++) {
+            point[i] = m_origin[i] + (m_direction[i] * t);
+        }
+        return point;
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const Ray<N, T>& ray)
+    {
+        os << "origin: " << static_cast<LinearAlgebra::Vec<N, T>>(ray.getOrigin()) << ", direction: " << ray.getDirection();
+        return os;
+    }
+};
+
+template <size_t R, size_t C, typename T, typename Layout>
+class Mat {
+    static_assert([] {
+        if constexpr (TiledLayout<Layout>) {
+            return R % Layout::TILE == 0 && C % Layout::TILE == 0;
+        }
+        return true;
+    }(), "Tiled Mat dimensions must be multiples of the tile size");
+
+    // Row of a column-major or tiled Mat, indexes through at().
+    template <typename M>
+    struct RowRef {
+        M& mat;
+        size_t row;
+
+        constexpr auto& operator[](size_t col) const
+        {
+            return mat.at(row, col);
+        }
+    };
+
+public:
+    using layout_type = Layout;
+    static constexpr size_t N = R * C;
+    T data[N];
+    constexpr Mat()
+        : data()
+    {
+    }
+    constexpr Mat(T fill_value)
+    {
+        std::fill(data, data + N, fill_value);
+    }
+
+    // Evaluates an element-wise expression in one pass.
+    template <typename E>
+        requires ElementExpressionOf<E, Mat<R, C, T, Layout>>
+    constexpr Mat(const E& expr)
+    {
+        expr.evaluateInto(data);
+    }
+    template <typename E>
+        requires ElementExpressionOf<E, Mat<R, C, T, Layout>>
+    constexpr Mat<R, C, T, Layout>& operator=(const E& expr)
+    {
+        expr.evaluateInto(data);
+        return *this;
+    }
+
+    // Elements are listed row by row whatever the layout.
+    constexpr Mat(const std::initializer_list<std::initializer_list<T>>& elements)
+    {
+        // C++23
+        // auto flattened = std::views::join(elements);
+        // std::ranges::copy(flattened, data);
+
+        // lowkey hate this.
+        size_t i = 0;
+        for (const auto& column : elements) {
+            for (const auto& element : column) {
+                at(i / C, i % C) = element;
+                i++;
+            }
+        }
+    }
+
+    // Copies between layouts.
+    template <typename Layout2>
+        requires(!std::is_same_v<Layout, Layout2>)
+    explicit constexpr Mat(const Mat<R, C, T, Layout2>& other)
+    {
+        for (size_t row = 0; row < R; ++row) {
+            for (size_t col = 0; col < C; ++col) {
+                at(row, col) = other.at(row, col);
+            }
+        }
+    }
+
+    constexpr auto begin() -> T*
+    {
+        return data;
+    }
+    constexpr auto begin() const -> const T*
+    {
+        return data;
+    }
+    constexpr auto cbegin() const -> const T*
+    {
+        return data;
+    }
+    constexpr auto end() -> T*
+    {
+        return data + N;
+    }
+    constexpr auto end() const -> const T*
+    {
+        return data + N;
+    }
+    constexpr auto cend() const -> const T*
+    {
+        return data + N;
+    }
+    constexpr T& at(size_t row, size_t col)
+    {
+        assert(row < R && col < C);
+        return data[Layout::template index<R, C>(row, col)];
+    }
+    constexpr const T& at(size_t row, size_t col) const
+    {
+        assert(row < R && col < C);
+        return data[Layout::template index<R, C>(row, col)];
+    }
+    // A pointer to the row when row-major, a proxy indexing through at() otherwise.
+    constexpr auto operator[](size_t row)
+    {
+        assert(row < R);
+        if constexpr (std::is_same_v<Layout, RowMajor>) {
+            return data + (row * C);
+        } else {
+            return RowRef<Mat> { *this, row };
+        }
+    }
+    constexpr auto operator[](size_t row) const
+    {
+        assert(row < R);
+        if constexpr (std::is_same_v<Layout, RowMajor>) {
+            return data + (row * C);
+        } else {
+            return RowRef<const Mat> { *this, row };
+        }
+    }
+
+    // The storage as a strided block for the kernels.
+    constexpr Kernel::Strided<T> strided()
+        requires StridedLayout<Layout>
+    {
+        return { data, Layout::template index<R, C>(1, 0), Layout::template index<R, C>(0, 1) };
+    }
+    constexpr Kernel::Strided<const T> strided() const
+        requires StridedLayout<Layout>
+    {
+        return { data, Layout::template index<R, C>(1, 0), Layout::template index<R, C>(0, 1) };
+    }
+    // Tile (row, col) of a tiled Mat, counted in tiles.
+    constexpr MatView<T> tile(size_t row, size_t col)
+        requires TiledLayout<Layout>
+    {
+        constexpr size_t TILE = Layout::TILE;
+        assert(row < R / TILE && col < C / TILE);
+        return { data + (row * (C / TILE) + col) * TILE * TILE, TILE, TILE, TILE };
+    }
+    constexpr MatView<const T> tile(size_t row, size_t col) const
+        requires TiledLayout<Layout>
+    {
+        constexpr size_t TILE = Layout::TILE;
+        assert(row < R / TILE && col < C / TILE);
+        return { data + (row * (C / TILE) + col) * TILE * TILE, TILE, TILE, TILE };
+    }
+
+    template <size_t R2, size_t C2, typename Layout2>
+    constexpr bool operator==(const Mat<R2, C2, T, Layout2>& other) const
+    {
+        constexpr float TOLERANCE = equalityTolerance<T>(1e-4f);
+        auto abs = [](auto x) { return (x < 0) ? -x : x; };
+        auto equal = [&](const T& lhs, const T& rhs) { return abs(lhs - rhs) < TOLERANCE; };
+
+        if constexpr (R != R2 || C != C2) {
+            return false;
+        } else if constexpr (std::is_same_v<Layout, Layout2>) {
+            return std::ranges::equal(*this, other, equal);
+        } else {
+            for (size_t row = 0; row < R; ++row) {
+                for (size_t col = 0; col < C; ++col) {
+                    if (!equal(at(row, col), other.at(row, col))) {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+    }
+    template <size_t R2, size_t C2, typename Layout2>
+    constexpr bool operator!=(const Mat<R2, C2, T, Layout2>& other) const
+    {
+        return !(*this == other);
+    }
+
+    template <typename X>
+        requires SameShape<X, Mat<R, C, T, Layout>>
+    constexpr Mat<R, C, T, Layout>& operator+=(X&& other)
+    {
+        return *this = *this + std::forward<X>(other);
+    }
+    template <typename X>
+        requires SameShape<X, Mat<R, C, T, Layout>>
+    constexpr Mat<R, C, T, Layout>& operator-=(X&& other)
+    {
+        return *this = *this - std::forward<X>(other);
+    }
+    template <typename S>
+        requires ScalarOf<S, Mat<R, C, T, Layout>>
+    constexpr Mat<R, C, T, Layout>& operator*=(S scalar)
+    {
+        return *this = *this * scalar;
+    }
+
+    /*
+        Any combination of layouts can be multiplied, the result has this Mat's layout.
+        Row- and column-major operands go to gemm() as strided blocks, two tiled operands
+        with the same tile size to tiledGemm(). A tiled operand or result mixed with the
+        other layouts is copied through row-major once.
+    */
+    template <size_t R2, size_t C2, typename Layout2>
+    constexpr Mat<R, C2, T, Layout> operator*(const Mat<R2, C2, T, Layout2>& b) const
+    {
+        static_assert(R2 == C, "Incompatible operation");
+        const auto& a = *this;
+        Mat<R, C2, T, Layout> c {};
+        if !consteval {
+            if constexpr (R * C * C2 >= Kernel::GEMM_THRESHOLD) {
+                if constexpr (TiledLayout<Layout> && std::is_same_v<Layout, Layout2>) {
+                    if constexpr (Kernel::TILED_KERNELS<T, Layout::TILE>) {
+                        Kernel::tiledGemm<Layout::TILE, T>(R, C2, C, data, b.data, c.data);
+                        return c;
+                    }
+                }
+                std::unique_ptr<Mat<R, C, T>> a_copy;
+                std::unique_ptr<Mat<R2, C2, T>> b_copy;
+                if constexpr (StridedLayout<Layout>) {
+                    Kernel::gemm<T>(R, C2, C, Kernel::stridedOperand(a, a_copy), Kernel::stridedOperand(b, b_copy), c.strided());
+                } else {
+                    auto c_copy = std::make_unique<Mat<R, C2, T>>();
+                    Kernel::gemm<T>(R, C2, C, Kernel::stridedOperand(a, a_copy), Kernel::stridedOperand(b, b_copy), c_copy->strided());
+                    for (size_t row = 0; row < R; ++row) {
+                        for (size_t col = 0; col < C2; ++col) {
+                            c.at(row, col) = c_copy->at(row, col);
+                        }
+                    }
+                }
+                return c;
+            }
+        }
+        for (size_t row = 0; row < R; ++row) {
+            for (size_t col = 0; col < C2; ++col) {
+                Accumulator<T> value = {};
+                for (size_t i = 0; i < C; ++i) {
+                    value += a.at(row, i) * b.at(i, col);
+                }
+                c.at(row, col) = value;
+            }
+        }
+        return c;
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const Mat<R, C, T, Layout>& mat)
+    {
+        os << '[';
+        for (size_t i = 0; i < R; ++i) {
+            os << "{ ";
+            for (size_t j = 0; j < C; ++j) {
+                os << mat[i][j] << ' ';
+            }
+            os << '}';
+        }
+        os << ']';
+        return os;
+    }
+};
+
+template <size_t R, size_t C, typename T, typename Layout>
+Kernel::Strided<const T> Kernel::stridedOperand(const Mat<R, C, T, Layout>& mat, std::unique_ptr<Mat<R, C, T>>& copy)
+{
+    if constexpr (StridedLayout<Layout>) {
+        return mat.strided();
+    } else {
+        copy = std::make_unique<Mat<R, C, T>>(mat);
+        return copy->strided();
+    }
+}
+
+struct Radian;
+
+template <typename T = float>
+class Quat {
+private:
+    static constexpr size_t W = 0;
+    static constexpr size_t X = 1;
+    static constexpr size_t Y = 2;
+    static constexpr size_t Z = 3;
+
+public:
+    Vec<4, T> data;
+
+    /*
+        Rotation about x, then y, then z (q = z * y * x).
+    */
+    constexpr Quat(Radians x_rotation, Radians y_rotation, Radians z_rotation)
+    {
+        const auto [sx, cx] = Math::sincos(static_cast<T>(x_rotation.angle / 2));
+        const auto [sy, cy] = Math::sincos(static_cast<T>(y_rotation.angle / 2));
+        const auto [sz, cz] = Math::sincos(static_cast<T>(z_rotation.angle / 2));
+        // z * y * x expanded.
+        data[W] = cz * cy * cx + sz * sy * sx;
+        data[X] = cz * cy * sx - sz * sy * cx;
+        data[Y] = cz * sy * cx + sz * cy * sx;
+        data[Z] = sz * cy * cx - cz * sy * sx;
+    }
+
+    constexpr Quat()
+    {
+        data[W] = 1;
+    }
+    constexpr Quat(T w, T x, T y, T z)
+    {
+        data[W] = w;
+        data[X] = x;
+        data[Y] = y;
+        data[Z] = z;
+    }
+
+    constexpr Quat(T w, const Vec<3, T>& vec)
+    {
+        data[W] = w;
+        data[X] = vec[0];
+        data[Y] = vec[1];
+        data[Z] = vec[2];
+    }
+
+    /*
+        Rotation of angle about axis (axis must be normalised).
+    */
+    static constexpr Quat<T> fromAxisAngle(const Vec<3, T>& axis, Radians angle)
+    {
+        const auto [s, c] = Math::sincos(static_cast<T>(angle.angle / 2));
+        return Quat<T>(c, axis * s);
+    }
+
+    constexpr Quat<T> operator*(const Quat<T>& other) const
+    {
+        const auto& w1 = this->data[W];
+        const auto& x1 = this->data[X];
+        const auto& y1 = this->data[Y];
+        const auto& z1 = this->data[Z];
+        const auto& w2 = other.data[W];
+        const auto& x2 = other.data[X];
+        const auto& y2 = other.data[Y];
+        const auto& z2 = other.data[Z];
+
+        return Quat<T> {
+            w1 * w2 - x1 * x2 - y1 * y2 - z1 * z2,
+            w1 * x2 + x1 * w2 + y1 * z2 - z1 * y2,
+            w1 * y2 - x1 * z2 + y1 * w2 + z1 * x2,
+            w1 * z2 + x1 * y2 - y1 * x2 + z1 * w2
+        };
+    }
+
+    constexpr T getScalar() const
+    {
+        return data[W];
+    }
+    // The vector (imaginary) part.
+    constexpr Vec<3, T> getVec() const
+    {
+        return Vec<3, T> { data[X], data[Y], data[Z] };
+    }
+
+    constexpr T getLengthSquared() const
+    {
+        return data.getLengthSquared();
+    }
+    constexpr T getLength() const
+    {
+        return data.getLength();
+    }
+    constexpr Quat<T> getNormalised() const
+    {
+        Quat<T> result;
+        result.data = data / getLength();
+        return result;
+    }
+    constexpr Quat<T> getConjugate() const
+    {
+        return Quat<T> { data[W], -data[X], -data[Y], -data[Z] };
+    }
+    constexpr Quat<T> getInverse() const
+    {
+        Quat<T> result = getConjugate();
+        result.data = result.data / getLengthSquared();
+        return result;
+    }
+
+    /*
+        Rotates vec by this (unit) quaternion without building q * v * q^-1 or a matrix:
+        t = 2 (q.xyz x v), v' = v + w t + q.xyz x t.
+    */
+    constexpr Vec<3, T> rotate(const Vec<3, T>& vec) const
+    {
+        const T w = data[W];
+        const T x = data[X];
+        const T y = data[Y];
+        const T z = data[Z];
+        const T tx = 2 * (y * vec[2] - z * vec[1]);
+        const T ty = 2 * (z * vec[0] - x * vec[2]);
+        const T tz = 2 * (x * vec[1] - y * vec[0]);
+        return Vec<3, T> {
+            vec[0] + w * tx + (y * tz - z * ty),
+            vec[1] + w * ty + (z * tx - x * tz),
+            vec[2] + w * tz + (x * ty - y * tx)
+        };
+    }
+
+    // Rotation matrix of this (unit) quaternion.
+    constexpr Mat<3, 3, T> toMat3x3() const
+    {
+        const T w = data[W];
+        const T x = data[X];
+        const T y = data[Y];
+        const T z = data[Z];
+        return Mat<3, 3, T>(
+            { { 1 - 2 * (y * y + z * z), 2 * (x * y - w * z), 2 * (x * z + w * y) },
+                { 2 * (x * y + w * z), 1 - 2 * (x * x + z * z), 2 * (y * z - w * x) },
+                { 2 * (x * z - w * y), 2 * (y * z + w * x), 1 - 2 * (x * x + y * y) } });
+    }
+
+    constexpr bool operator==(const Quat<T>& other) const
+    {
+        return data == other.data;
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const Quat<T>& quat)
+    {
+        os << quat.data;
+        return os;
+    }
+};
+
+/*
+    Normalised linear interpolation from a (t = 0) to b (t = 1) along the shorter arc.
+*/
+template <typename T>
+constexpr Quat<T> nlerp(const Quat<T>& a, const Quat<T>& b, T t)
+{
+    const T sign = dotProduct(a.data, b.data) < 0 ? T { -1 } : T { 1 };
+    Quat<T> result;
+    result.data = a.data * (1 - t) + b.data * (sign * t);
+    return result.getNormalised();
+}
+
+/*
+    Spherical linear interpolation from a (t = 0) to b (t = 1) along the shorter arc, a and b unit.
+    Uses Eberly's polynomial form of sin(t theta) / sin(theta) (A Fast and Accurate Algorithm for
+    Computing SLERP), so there is no acos, sin or division and a == b needs no special case.
+*/
+template <typename T>
+constexpr Quat<T> slerp(const Quat<T>& a, const Quat<T>& b, T t)
+{
+    constexpr size_t TERMS = 16;
+    constexpr T MU = static_cast<T>(1.91667214007039);
+    constexpr auto coefficients = [] {
+        std::array<std::array<T, TERMS>, 2> uv {};
+        for (size_t i = 0; i < TERMS; ++i) {
+            const T n = static_cast<T>(i + 1);
+            uv[0][i] = 1 / (n * (2 * n + 1));
+            uv[1][i] = n / (2 * n + 1);
+        }
+        uv[0][TERMS - 1] *= MU;
+        uv[1][TERMS - 1] *= MU;
+        return uv;
+    }();
+    const auto& u = coefficients[0];
+    const auto& v = coefficients[1];
+
+    T cos_theta = dotProduct(a.data, b.data);
+    T sign = 1;
+    if (cos_theta < 0) {
+        cos_theta = -cos_theta;
+        sign = -1;
+    }
+    const T x_minus_1 = cos_theta - 1;
+    const T d = 1 - t;
+    T weight_b = 1;
+    T weight_a = 1;
+    for (size_t i = TERMS; i-- > 0;) {
+        weight_b = 1 + (u[i] * t * t - v[i]) * x_minus_1 * weight_b;
+        weight_a = 1 + (u[i] * d * d - v[i]) * x_minus_1 * weight_a;
+    }
+    Quat<T> result;
+    result.data = a.data * (d * weight_a) + b.data * (sign * t * weight_b);
+    return result;
+}
+
+/*
+    out[i] = rotation.rotate(in[i]), out may be in but must not partially overlap it. The rotation
+    matrix is built once and applied with the same kernel as transformPoints.
+*/
+template <typename T>
+void rotate(const Quat<T>& rotation, std::span<const Vec<3, T>> in, std::span<Vec<3, T>> out)
+{
+    static_assert(sizeof(Vec<3, T>) == 3 * sizeof(T), "affineTransform3 reads Vec<3> spans as packed xyz triples");
+    assert(in.size() == out.size());
+    const Mat<3, 3, T> mat = rotation.toMat3x3();
+    T columns[4][4] = {};
+    for (size_t row = 0; row < 3; ++row) {
+        for (size_t col = 0; col < 3; ++col) {
+            columns[col][row] = mat[row][col];
+        }
+    }
+    if (!in.empty()) {
+        Kernel::affineTransform3<T>(columns, in.data()->data, out.data()->data, in.size());
+    }
+}
+
+/*
+    out[i] = rotations[i].rotate(in[i]), out may be in.
+    rotate is branch free so this loop vectorises as is; packing the array of structures
+    input into lanes by hand costs more in shuffles and store forwarding than it saves.
+*/
+template <typename T>
+void rotate(std::span<const Quat<T>> rotations, std::span<const Vec<3, T>> in, std::span<Vec<3, T>> out)
+{
+    assert(rotations.size() == in.size() && in.size() == out.size());
+    for (size_t i = 0; i < in.size(); ++i) {
+        out[i] = rotations[i].rotate(in[i]);
+    }
+}
+
+/*
+    Mat * Vec for any layout. Large row- and column-major Mats go through gemv() with their
+    strides, so column-major storage is summed a column at a time rather than walked with
+    stride R, tiled ones through tiledGemv().
+*/
+template <size_t R, size_t C, size_t N, typename T, typename Layout>
+constexpr Vec<R, T> dotProduct(const Mat<R, C, T, Layout>& mat, const Vec<N, T>& vec)
+{
+    static_assert(N == C, "Incompatible operation");
+    Vec<R, T> output;
+    if !consteval {
+        if constexpr (R * C >= Kernel::GEMV_THRESHOLD) {
+            if constexpr (TiledLayout<Layout>) {
+                Kernel::tiledGemv<Layout::TILE, false>(R, C, mat.data, vec.data, output.data);
+            } else {
+                Kernel::gemv<T>(R, C, mat.strided(), vec.data, output.data);
+            }
+            return output;
+        }
+    }
+
+    for (size_t row = 0; row < R; ++row) {
+        Accumulator<T> value = {};
+        for (size_t col = 0; col < C; ++col) {
+            value += mat.at(row, col) * vec[col];
+        }
+        output[row] = value;
+    }
+    return output;
+}
+
+// Vec * Mat, the product of the transpose. A row-major Mat is summed a row at a time.
+template <size_t R, size_t C, size_t N, typename T, typename Layout>
+constexpr Vec<C, T> dotProduct(const Vec<N, T>& vec, const Mat<R, C, T, Layout>& mat)
+{
+    static_assert(N == R, "Incompatible operation");
+    Vec<C, T> output;
+    if !consteval {
+        if constexpr (R * C >= Kernel::GEMV_THRESHOLD) {
+            if constexpr (TiledLayout<Layout>) {
+                Kernel::tiledGemv<Layout::TILE, true>(R, C, mat.data, vec.data, output.data);
+            } else {
+                const auto strided = mat.strided();
+                Kernel::gemv<T>(C, R, { strided.ptr, strided.col_stride, strided.row_stride }, vec.data, output.data);
+            }
+            return output;
+        }
+    }
+
+    for (size_t col = 0; col < C; ++col) {
+        Accumulator<T> value = {};
+        for (size_t row = 0; row < R; ++row) {
+            value += mat.at(row, col) * vec[row];
+        }
+        output[col] = value;
+    }
+    return output;
+}
+
+template <size_t N, typename T>
+constexpr T dotProduct(const Vec<N, T>& vec1, const Vec<N, T>& vec2)
+{
+    if !consteval {
+        if constexpr (Simd::VecKernel<N, T>::enabled) {
+            return Simd::VecKernel<N, T>::dot(vec1.data, vec2.data);
+        } else if constexpr (HalfPrecision<T>) {
+            return Kernel::dot(N, vec1.data, vec2.data);
+        }
+    }
+    return std::transform_reduce(
+        vec1.cbegin(), vec1.cend(),
+        vec2.cbegin(),
+        Accumulator<T> {},
+        std::plus {},
+        std::multiplies {});
+}
+
+template <typename T>
+constexpr Vec<3, T> crossProduct(const Vec<3, T>& vec1, const Vec<3, T>& vec2)
+{
+    return Vec<3, T> {
+        vec1[1] * vec2[2] - vec1[2] * vec2[1],
+        vec1[2] * vec2[0] - vec1[0] * vec2[2],
+        vec1[0] * vec2[1] - vec1[1] * vec2[0]
+    };
+}
+
+// Overloads taking unevaluated element-wise expressions, evaluated once up front.
+template <typename A, typename B>
+    requires SameShape<A, B> && VecElementwise<A> && (ElementExpression<A> || ElementExpression<B>)
+constexpr auto dotProduct(const A& vec1, const B& vec2)
+{
+    return dotProduct(Expr::evaluate(vec1), Expr::evaluate(vec2));
+}
+template <typename A, typename B>
+    requires SameShape<A, B> && VecElementwise<A> && (ElementExpression<A> || ElementExpression<B>)
+constexpr auto crossProduct(const A& vec1, const B& vec2)
+{
+    return crossProduct(Expr::evaluate(vec1), Expr::evaluate(vec2));
+}
+
+template <size_t R, size_t C, typename T, typename Layout>
+constexpr Mat<C, R, T, Layout> transpose(const Mat<R, C, T, Layout>& mat)
+{
+    Mat<C, R, T, Layout> transposed;
+    for (size_t row = 0; row < R; row++) {
+        for (size_t col = 0; col < C; col++) {
+            transposed.at(col, row) = mat.at(row, col);
+        }
+    }
+    return transposed;
+}
+
+/*
+Partially pivoted LU factorisation, P * A = L * U.
+Unblocked (and constexpr) for small N, blocked on top of the GEMM kernel for large N at runtime.
+Factor once and reuse it to solve many right hand sides.
+*/
+template <size_t N, typename T = float>
+class LUDecomposition {
+private:
+    static constexpr size_t BLOCKED_THRESHOLD = 64;
+
+    Mat<N, N, T> m_lu;
+    std::array<size_t, N> m_permutation;
+    T m_sign = 1;
+    bool m_singular = false;
+
+public:
+    // Any layout, the factors are kept row-major.
+    template <typename Layout>
+    constexpr explicit LUDecomposition(const Mat<N, N, T, Layout>& mat)
+        : m_lu(mat)
+        , m_permutation()
+    {
+        if !consteval {
+            if constexpr (N >= BLOCKED_THRESHOLD) {
+                m_singular = !Kernel::luFactor<T>(N, { m_lu.data, N, 1 }, m_permutation.data(), m_sign);
+                return;
+            }
+        }
+        auto abs = [](auto x) { return (x < 0) ? -x : x; };
+        for (size_t i = 0; i < N; ++i) {
+            m_permutation[i] = i;
+        }
+        for (size_t j = 0; j < N; ++j) {
+            size_t pivot = j;
+            for (size_t i = j + 1; i < N; ++i) {
+                if (abs(m_lu[i][j]) > abs(m_lu[pivot][j])) {
+                    pivot = i;
+                }
+            }
+            if (pivot != j) {
+                for (size_t col = 0; col < N; ++col) {
+                    std::swap(m_lu[j][col], m_lu[pivot][col]);
+                }
+                std::swap(m_permutation[j], m_permutation[pivot]);
+                m_sign = -m_sign;
+            }
+            if (m_lu[j][j] == T { 0 }) {
+                m_singular = true;
+                continue;
+            }
+            for (size_t i = j + 1; i < N; ++i) {
+                const T l = m_lu[i][j] /= m_lu[j][j];
+                for (size_t col = j + 1; col < N; ++col) {
+                    m_lu[i][col] -= l * m_lu[j][col];
+                }
+            }
+        }
+    }
+
+    constexpr bool isSingular() const
+    {
+        return m_singular;
+    }
+    // L below the diagonal (unit diagonal implied) and U on and above it.
+    constexpr auto getLU() const -> const Mat<N, N, T>&
+    {
+        return m_lu;
+    }
+    // Row i of P * A is row getPermutation()[i] of A.
+    constexpr auto getPermutation() const -> const std::array<size_t, N>&
+    {
+        return m_permutation;
+    }
+
+    constexpr T determinant() const
+    {
+        T result = m_sign;
+        for (size_t i = 0; i < N; ++i) {
+            result *= m_lu[i][i];
+        }
+        return result;
+    }
+
+    /*
+    x such that A * x = b, by forward then back substitution.
+    */
+    constexpr Vec<N, T> solve(const Vec<N, T>& b) const
+    {
+        assert(!m_singular);
+        Vec<N, T> x;
+        for (size_t i = 0; i < N; ++i) {
+            T value = b[m_permutation[i]];
+            for (size_t j = 0; j < i; ++j) {
+                value -= m_lu[i][j] * x[j];
+            }
+            x[i] = value;
+        }
+        for (size_t i = N; i-- > 0;) {
+            T value = x[i];
+            for (size_t j = i + 1; j < N; ++j) {
+                value -= m_lu[i][j] * x[j];
+            }
+            x[i] = value / m_lu[i][i];
+        }
+        return x;
+    }
+
+    /*
+    Solves A * X = I for all columns at once, row by row so the inner loops run along rows.
+    */
+    constexpr Mat<N, N, T> inverse() const
+    {
+        assert(!m_singular);
+        Mat<N, N, T> result;
+        for (size_t i = 0; i < N; ++i) {
+            result[i][m_permutation[i]] = 1;
+        }
+        for (size_t i = 0; i < N; ++i) {
+            for (size_t j = 0; j < i; ++j) {
+                const T l = m_lu[i][j];
+                for (size_t col = 0; col < N; ++col) {
+                    result[i][col] -= l * result[j][col];
+                }
+            }
+        }
+        for (size_t i = N; i-- > 0;) {
+            for (size_t j = i + 1; j < N; ++j) {
+                const T u = m_lu[i][j];
+                for (size_t col = 0; col < N; ++col) {
+                    result[i][col] -= u * result[j][col];
+                }
+            }
+            const T diagonal = m_lu[i][i];
+            for (size_t col = 0; col < N; ++col) {
+                result[i][col] /= diagonal;
+            }
+        }
+        return result;
+    }
+};
+
+/*
+Determinant of a Matrix, from its LU factorisation.
+*/
+template <size_t N, typename T, typename Layout>
+constexpr T determinant(const Mat<N, N, T, Layout>& mat)
+{
+    return LUDecomposition<N, T>(mat).determinant();
+}
+
+/*
+Determinant of a Matrix (closed form for 2x2).
+*/
+template <typename T, typename Layout>
+constexpr T determinant(const Mat<2, 2, T, Layout>& mat)
+{
+    return (mat[0][0] * mat[1][1]) - (mat[0][1] * mat[1][0]);
+}
+
+/*
+Determinant of a Matrix (closed form for 3x3).
+*/
+template <typename T, typename Layout>
+constexpr T determinant(const Mat<3, 3, T, Layout>& mat)
+{
+    Mat<2, 2, T> a({ { mat[1][1], mat[1][2] }, { mat[2][1], mat[2][2] } });
+    Mat<2, 2, T> b({ { mat[1][0], mat[1][2] }, { mat[2][0], mat[2][2] } });
+    Mat<2, 2, T> c({ { mat[1][0], mat[1][1] }, { mat[2][0], mat[2][1] } });
+    return (mat[0][0] * determinant(a)) - (mat[0][1] * determinant(b)) + (mat[0][2] * determinant(c));
+}
+
+/*
+Determinant of a Matrix (closed form for 4x4, Laplace expansion over 2x2 minors).
+*/
+template <typename T, typename Layout>
+constexpr T determinant(const Mat<4, 4, T, Layout>& mat)
+{
+    const T s0 = mat[0][0] * mat[1][1] - mat[1][0] * mat[0][1];
+    const T s1 = mat[0][0] * mat[1][2] - mat[1][0] * mat[0][2];
+    const T s2 = mat[0][0] * mat[1][3] - mat[1][0] * mat[0][3];
+    const T s3 = mat[0][1] * mat[1][2] - mat[1][1] * mat[0][2];
+    const T s4 = mat[0][1] * mat[1][3] - mat[1][1] * mat[0][3];
+    const T s5 = mat[0][2] * mat[1][3] - mat[1][2] * mat[0][3];
+
+    const T c5 = mat[2][2] * mat[3][3] - mat[3][2] * mat[2][3];
+    const T c4 = mat[2][1] * mat[3][3] - mat[3][1] * mat[2][3];
+    const T c3 = mat[2][1] * mat[3][2] - mat[3][1] * mat[2][2];
+    const T c2 = mat[2][0] * mat[3][3] - mat[3][0] * mat[2][3];
+    const T c1 = mat[2][0] * mat[3][2] - mat[3][0] * mat[2][2];
+    const T c0 = mat[2][0] * mat[3][1] - mat[3][0] * mat[2][1];
+
+    return s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+}
+
+/*
+Inverse of a Matrix, from its LU factorisation, in the same layout. The matrix must not be singular.
+*/
+template <size_t N, typename T, typename Layout>
+constexpr Mat<N, N, T, Layout> inverse(const Mat<N, N, T, Layout>& mat)
+{
+    const LUDecomposition<N, T> lu(mat);
+    assert(!lu.isSingular());
+    return Mat<N, N, T, Layout>(lu.inverse());
+}
+
+/*
+Inverse of a Matrix (closed form for 4x4, adjugate over 2x2 minors). The matrix must not be singular.
+*/
+template <typename T, typename Layout>
+constexpr Mat<4, 4, T, Layout> inverse(const Mat<4, 4, T, Layout>& mat)
+{
+    const T s0 = mat[0][0] * mat[1][1] - mat[1][0] * mat[0][1];
+    const T s1 = mat[0][0] * mat[1][2] - mat[1][0] * mat[0][2];
+    const T s2 = mat[0][0] * mat[1][3] - mat[1][0] * mat[0][3];
+    const T s3 = mat[0][1] * mat[1][2] - mat[1][1] * mat[0][2];
+    const T s4 = mat[0][1] * mat[1][3] - mat[1][1] * mat[0][3];
+    const T s5 = mat[0][2] * mat[1][3] - mat[1][2] * mat[0][3];
+
+    const T c5 = mat[2][2] * mat[3][3] - mat[3][2] * mat[2][3];
+    const T c4 = mat[2][1] * mat[3][3] - mat[3][1] * mat[2][3];
+    const T c3 = mat[2][1] * mat[3][2] - mat[3][1] * mat[2][2];
+    const T c2 = mat[2][0] * mat[3][3] - mat[3][0] * mat[2][3];
+    const T c1 = mat[2][0] * mat[3][2] - mat[3][0] * mat[2][2];
+    const T c0 = mat[2][0] * mat[3][1] - mat[3][0] * mat[2][1];
+
+    const T det = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+    assert(det != T { 0 });
+    const T inv_det = T { 1 } / det;
+
+    Mat<4, 4, T, Layout> result;
+    result[0][0] = (mat[1][1] * c5 - mat[1][2] * c4 + mat[1][3] * c3) * inv_det;
+    result[0][1] = (-mat[0][1] * c5 + mat[0][2] * c4 - mat[0][3] * c3) * inv_det;
+    result[0][2] = (mat[3][1] * s5 - mat[3][2] * s4 + mat[3][3] * s3) * inv_det;
+    result[0][3] = (-mat[2][1] * s5 + mat[2][2] * s4 - mat[2][3] * s3) * inv_det;
+    result[1][0] = (-mat[1][0] * c5 + mat[1][2] * c2 - mat[1][3] * c1) * inv_det;
+    result[1][1] = (mat[0][0] * c5 - mat[0][2] * c2 + mat[0][3] * c1) * inv_det;
+    result[1][2] = (-mat[3][0] * s5 + mat[3][2] * s2 - mat[3][3] * s1) * inv_det;
+    result[1][3] = (mat[2][0] * s5 - mat[2][2] * s2 + mat[2][3] * s1) * inv_det;
+    result[2][0] = (mat[1][0] * c4 - mat[1][1] * c2 + mat[1][3] * c0) * inv_det;
+    result[2][1] = (-mat[0][0] * c4 + mat[0][1] * c2 - mat[0][3] * c0) * inv_det;
+    result[2][2] = (mat[3][0] * s4 - mat[3][1] * s2 + mat[3][3] * s0) * inv_det;
+    result[2][3] = (-mat[2][0] * s4 + mat[2][1] * s2 - mat[2][3] * s0) * inv_det;
+    result[3][0] = (-mat[1][0] * c3 + mat[1][1] * c1 - mat[1][2] * c0) * inv_det;
+    result[3][1] = (mat[0][0] * c3 - mat[0][1] * c1 + mat[0][2] * c0) * inv_det;
+    result[3][2] = (-mat[3][0] * s3 + mat[3][1] * s1 - mat[3][2] * s0) * inv_det;
+    result[3][3] = (mat[2][0] * s3 - mat[2][1] * s1 + mat[2][2] * s0) * inv_det;
+    return result;
+}
+
+/*
+x such that mat * x = b. Use LUDecomposition directly to reuse one factorisation.
+*/
+template <size_t N, typename T, typename Layout>
+constexpr Vec<N, T> solve(const Mat<N, N, T, Layout>& mat, const Vec<N, T>& b)
+{
+    return LUDecomposition<N, T>(mat).solve(b);
+}
+
+/*
+Distance between two vectors (as if they were points).
+*/
+template <size_t N, typename T>
+constexpr T distance(const Pos<N, T>& pos1, const Pos<N, T>& pos2)
+{
+    const Vec<N, T> vec1 { pos1 };
+    const Vec<N, T> vec2 { pos2 };
+
+    auto squaredDifference = [](const auto& lhs, const auto& rhs) { return (lhs - rhs) * (lhs - rhs); };
+
+    return Math::sqrt(
+        std::transform_reduce(
+            vec1.begin(), vec1.end(),
+            vec2.begin(),
+            0.0f,
+            std::plus {},
+            squaredDifference));
+}
+
+/*
+Generate the rotation Matrix with the inputs of yaw, pitch, and roll.
+(Input units are in radians). PRECISION picks the Math::sincos() tier used at runtime.
+*/
+template <typename T, Precision PRECISION = Precision::Exact>
+constexpr Mat<3, 3, T> getRotationMat3x3(Radians x_rotation_radians, Radians y_rotation_radians, Radians z_rotation_radians)
+{
+    const T angles[3] = {
+        static_cast<T>(x_rotation_radians.angle),
+        static_cast<T>(y_rotation_radians.angle),
+        static_cast<T>(z_rotation_radians.angle),
+    };
+    alignas(32) T s[4];
+    alignas(32) T c[4];
+    if consteval {
+        for (size_t i = 0; i < 3; ++i) {
+            std::tie(s[i], c[i]) = std::pair { Math::sin(angles[i]), Math::cos(angles[i]) };
+        }
+    } else {
+        if constexpr (PRECISION == Precision::Exact) {
+            for (size_t i = 0; i < 3; ++i) {
+                s[i] = static_cast<T>(std::sin(angles[i]));
+                c[i] = static_cast<T>(std::cos(angles[i]));
+            }
+        } else {
+            // All three angles in one pack.
+            using P = Simd::Pack<T, 4>;
+            P sin_pack;
+            P cos_pack;
+            Simd::sincos<PRECISION>(P::loadPartial(angles, 3), sin_pack, cos_pack);
+            sin_pack.store(s);
+            cos_pack.store(c);
+        }
+    }
+    const T sx = s[0], cx = c[0];
+    const T sy = s[1], cy = c[1];
+    const T sz = s[2], cz = c[2];
+
+    // x_rot_mat * y_rot_mat * z_rot_mat expanded.
+    Mat<3, 3, T> rotation;
+    rotation[0][0] = cy * cz;
+    rotation[0][1] = -cy * sz;
+    rotation[0][2] = sy;
+    rotation[1][0] = sx * sy * cz + cx * sz;
+    rotation[1][1] = cx * cz - sx * sy * sz;
+    rotation[1][2] = -sx * cy;
+    rotation[2][0] = sx * sz - cx * sy * cz;
+    rotation[2][1] = cx * sy * sz + sx * cz;
+    rotation[2][2] = cx * cy;
+    return rotation;
+}
+
+/*
+    3D affine transform, p' = linear * p + translation. Equivalent to a Mat<4, 4> with a
+    last row of { 0, 0, 0, 1 } but composes, inverts and transforms points with less work.
+*/
+template <typename T = float>
+class Affine3 {
+public:
+    Mat<3, 3, T> linear;
+    Vec<3, T> translation;
+
+    constexpr Affine3()
+        : linear({ { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } })
+        , translation()
+    {
+    }
+    constexpr Affine3(const Mat<3, 3, T>& linear_part, const Vec<3, T>& translation_part)
+        : linear(linear_part)
+        , translation(translation_part)
+    {
+    }
+    // The last row of mat must be { 0, 0, 0, 1 }.
+    constexpr explicit Affine3(const Mat<4, 4, T>& mat)
+        : linear({ { mat[0][0], mat[0][1], mat[0][2] }, { mat[1][0], mat[1][1], mat[1][2] }, { mat[2][0], mat[2][1], mat[2][2] } })
+        , translation(mat[0][3], mat[1][3], mat[2][3])
+    {
+        assert(mat[3][0] == 0 && mat[3][1] == 0 && mat[3][2] == 0 && mat[3][3] == 1);
+    }
+
+    static constexpr Affine3<T> fromTranslation(const Vec<3, T>& offset)
+    {
+        return { Affine3<T>().linear, offset };
+    }
+    static constexpr Affine3<T> fromRotation(const Mat<3, 3, T>& rotation)
+    {
+        return { rotation, Vec<3, T>() };
+    }
+    static constexpr Affine3<T> fromRotation(Radians x_rotation, Radians y_rotation, Radians z_rotation)
+    {
+        return fromRotation(getRotationMat3x3<T>(x_rotation, y_rotation, z_rotation));
+    }
+    static constexpr Affine3<T> fromScale(const Vec<3, T>& scale)
+    {
+        return { Mat<3, 3, T>({ { scale[0], 0, 0 }, { 0, scale[1], 0 }, { 0, 0, scale[2] } }), Vec<3, T>() };
+    }
+    static constexpr Affine3<T> fromScale(T scale)
+    {
+        return fromScale(Vec<3, T> { scale, scale, scale });
+    }
+
+    constexpr explicit operator Mat<4, 4, T>() const
+    {
+        Mat<4, 4, T> mat;
+        for (size_t row = 0; row < 3; ++row) {
+            for (size_t col = 0; col < 3; ++col) {
+                mat[row][col] = linear[row][col];
+            }
+            mat[row][3] = translation[row];
+        }
+        mat[3][3] = 1;
+        return mat;
+    }
+
+    // Applies other first, then this.
+    constexpr Affine3<T> operator*(const Affine3<T>& other) const
+    {
+        return { linear * other.linear, dotProduct(linear, other.translation) + translation };
+    }
+
+    constexpr bool operator==(const Affine3<T>& other) const
+    {
+        return linear == other.linear && translation == other.translation;
+    }
+
+    constexpr Pos<3, T> transformPoint(const Pos<3, T>& point) const
+    {
+        const T* p = point.data;
+        return Pos<3, T> {
+            linear[0][0] * p[0] + linear[0][1] * p[1] + linear[0][2] * p[2] + translation[0],
+            linear[1][0] * p[0] + linear[1][1] * p[1] + linear[1][2] * p[2] + translation[1],
+            linear[2][0] * p[0] + linear[2][1] * p[1] + linear[2][2] * p[2] + translation[2]
+        };
+    }
+    constexpr Vec<3, T> transformVec(const Vec<3, T>& vec) const
+    {
+        return Vec<3, T> {
+            linear[0][0] * vec[0] + linear[0][1] * vec[1] + linear[0][2] * vec[2],
+            linear[1][0] * vec[0] + linear[1][1] * vec[1] + linear[1][2] * vec[2],
+            linear[2][0] * vec[0] + linear[2][1] * vec[1] + linear[2][2] * vec[2]
+        };
+    }
+
+    /*
+        Inverse of a rigid transform (rotation and translation only): the rotation is
+        transposed instead of inverted.
+    */
+    constexpr Affine3<T> getRigidInverse() const
+    {
+        const Mat<3, 3, T> rotation = transpose(linear);
+        return { rotation, -dotProduct(rotation, translation) };
+    }
+    // Inverse of any invertible affine transform.
+    constexpr Affine3<T> getInverse() const
+    {
+        const Mat<3, 3, T> inverse_linear = inverse(linear);
+        return { inverse_linear, -dotProduct(inverse_linear, translation) };
+    }
+};
+
+/*
+    out[i] = transform.transformPoint(in[i]), out may be in but must not partially overlap it.
+*/
+template <typename T>
+void transformPoints(const Affine3<T>& transform, std::span<const Pos<3, T>> in, std::span<Pos<3, T>> out)
+{
+    static_assert(sizeof(Pos<3, T>) == 3 * sizeof(T), "affineTransform3 reads Pos<3> spans as packed xyz triples");
+    assert(in.size() == out.size());
+    T columns[4][4] = {};
+    for (size_t row = 0; row < 3; ++row) {
+        for (size_t col = 0; col < 3; ++col) {
+            columns[col][row] = transform.linear[row][col];
+        }
+        columns[3][row] = transform.translation[row];
+    }
+    if (!in.empty()) {
+        Kernel::affineTransform3<T>(columns, in.data()->data, out.data()->data, in.size());
+    }
+}
+
+template <typename T>
+void transformPoints(const Affine3<T>& transform, std::span<Pos<3, T>> points)
+{
+    transformPoints(transform, std::span<const Pos<3, T>>(points), points);
+}
+
+template <typename Policy, typename T>
+    requires std::is_execution_policy_v<std::remove_cvref_t<Policy>>
+void transformPoints(Policy&&, const Affine3<T>& transform, std::span<const Pos<3, T>> in, std::span<Pos<3, T>> out)
+{
+    if constexpr (!Parallel::IS_PARALLEL_POLICY<Policy>) {
+        transformPoints(transform, in, out);
+    } else {
+        assert(in.size() == out.size());
+        constexpr size_t BLOCK_POINTS = 16384;
+        const size_t blocks = (in.size() + BLOCK_POINTS - 1) / BLOCK_POINTS;
+        Parallel::ThreadPool::instance().parallelFor(blocks, [&](size_t block) {
+            const size_t first = block * BLOCK_POINTS;
+            const size_t count = std::min(BLOCK_POINTS, in.size() - first);
+            transformPoints(transform, in.subspan(first, count), out.subspan(first, count));
+        });
+    }
+}
+
+/*
+    Move-only, 64 byte aligned heap storage for the runtime sized types.
+*/
+template <typename T>
+class AlignedBuffer {
+private:
+    static constexpr std::align_val_t ALIGNMENT { 64 };
+    struct Deleter {
+        void operator()(T* ptr) const
+        {
+            ::operator delete(ptr, ALIGNMENT);
+        }
+    };
+    std::unique_ptr<T[], Deleter> m_data;
+    size_t m_size;
+
+public:
+    AlignedBuffer()
+        : m_data()
+        , m_size(0)
+    {
+    }
+    explicit AlignedBuffer(size_t size)
+        : m_data(static_cast<T*>(::operator new(size * sizeof(T), ALIGNMENT)))
+        , m_size(size)
+    {
+        static_assert(std::is_trivially_destructible_v<T>);
+        std::uninitialized_value_construct_n(m_data.get(), size);
+    }
+    AlignedBuffer(AlignedBuffer&& other) noexcept
+        : m_data(std::move(other.m_data))
+        , m_size(std::exchange(other.m_size, 0))
+    {
+    }
+    AlignedBuffer& operator=(AlignedBuffer&& other) noexcept
+    {
+        m_data = std::move(other.m_data);
+        m_size = std::exchange(other.m_size, 0);
+        return *this;
+    }
+    AlignedBuffer(const AlignedBuffer&) = delete;
+    AlignedBuffer& operator=(const AlignedBuffer&) = delete;
+
+    T* data()
+    {
+        return m_data.get();
+    }
+    const T* data() const
+    {
+        return m_data.get();
+    }
+    size_t size() const
+    {
+        return m_size;
+    }
+};
+
+/*
+    Runtime sized vector. Move-only, use clone() for an explicit copy.
+*/
+template <typename T>
+class DynVec {
+private:
+    AlignedBuffer<T> m_buffer;
+
+public:
+    DynVec() = default;
+    explicit DynVec(size_t size)
+        : m_buffer(size)
+    {
+    }
+    DynVec(size_t size, T fill_value)
+        : m_buffer(size)
+    {
+        std::fill(begin(), end(), fill_value);
+    }
+    DynVec(std::initializer_list<T> elements)
+        : m_buffer(elements.size())
+    {
+        std::ranges::copy(elements, begin());
+    }
+    template <size_t N>
+    explicit DynVec(const Vec<N, T>& vec)
+        : m_buffer(N)
+    {
+        std::ranges::copy(vec, begin());
+    }
+    template <size_t N>
+    explicit operator Vec<N, T>() const
+    {
+        assert(N == size());
+        Vec<N, T> vec;
+        std::ranges::copy(*this, vec.begin());
+        return vec;
+    }
+
+    DynVec(DynVec&&) noexcept = default;
+    DynVec& operator=(DynVec&&) noexcept = default;
+
+    DynVec clone() const
+    {
+        DynVec copy(size());
+        std::ranges::copy(*this, copy.begin());
+        return copy;
+    }
+
+    T* data()
+    {
+        return m_buffer.data();
+    }
+    const T* data() const
+    {
+        return m_buffer.data();
+    }
+    size_t size() const
+    {
+        return m_buffer.size();
+    }
+    auto begin() -> T*
+    {
+        return data();
+    }
+    auto begin() const -> const T*
+    {
+        return data();
+    }
+    auto cbegin() const -> const T*
+    {
+        return data();
+    }
+    auto end() -> T*
+    {
+        return data() + size();
+    }
+    auto end() const -> const T*
+    {
+        return data() + size();
+    }
+    auto cend() const -> const T*
+    {
+        return data() + size();
+    }
+    T& operator[](size_t index)
+    {
+        assert(index < size());
+        return data()[index];
+    }
+    const T& operator[](size_t index) const
+    {
+        assert(index < size());
+        return data()[index];
+    }
+
+    bool operator==(const DynVec<T>& other) const
+    {
+        constexpr float TOLERANCE = equalityTolerance<T>(1e-6f);
+        auto abs = [](auto x) { return (x < 0) ? -x : x; };
+        return size() == other.size()
+            && std::ranges::equal(*this, other, [&](const T& lhs, const T& rhs) { return abs(lhs - rhs) < TOLERANCE; });
+    }
+    bool operator!=(const DynVec<T>& other) const
+    {
+        return !(*this == other);
+    }
+
+    DynVec<T> operator+(const DynVec<T>& other) const
+    {
+        assert(size() == other.size());
+        DynVec<T> result(size());
+        std::ranges::transform(*this, other, result.begin(), std::plus {});
+        return result;
+    }
+    DynVec<T> operator-(const DynVec<T>& other) const
+    {
+        assert(size() == other.size());
+        DynVec<T> result(size());
+        std::ranges::transform(*this, other, result.begin(), std::minus {});
+        return result;
+    }
+    DynVec<T> operator*(const DynVec<T>& other) const
+    {
+        assert(size() == other.size());
+        DynVec<T> result(size());
+        std::ranges::transform(*this, other, result.begin(), std::multiplies {});
+        return result;
+    }
+    DynVec<T> operator/(const DynVec<T>& other) const
+    {
+        assert(size() == other.size());
+        DynVec<T> result(size());
+        std::ranges::transform(*this, other, result.begin(), std::divides {});
+        return result;
+    }
+    DynVec<T> operator*(T scalar) const
+    {
+        DynVec<T> result(size());
+        std::ranges::transform(*this, result.begin(), [&](const T& e) { return e * scalar; });
+        return result;
+    }
+    DynVec<T> operator/(T scalar) const
+    {
+        DynVec<T> result(size());
+        std::ranges::transform(*this, result.begin(), [&](const T& e) { return e / scalar; });
+        return result;
+    }
+    friend DynVec<T> operator*(T scalar, const DynVec<T>& vector)
+    {
+        return vector * scalar;
+    }
+    DynVec<T> operator-() const
+    {
+        return (*this) * T { -1 };
+    }
+
+    T getLengthSquared() const
+    {
+        return Kernel::dot(size(), data(), data());
+    }
+    T getLength() const
+    {
+        return Math::sqrt(Kernel::dot(size(), data(), data()));
+    }
+    DynVec<T> getNormalised() const
+    {
+        return (*this) / getLength();
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const DynVec<T>& vec)
+    {
+        os << "{ ";
+        for (const auto& e : vec) {
+            os << e << " ";
+        }
+        os << '}';
+        return os;
+    }
+};
+
+/*
+    Runtime sized, row-major matrix. Move-only, use clone() for an explicit copy.
+    Indexing matches Mat, mat[row] is a pointer to the start of that row.
+*/
+template <typename T>
+class DynMat {
+private:
+    AlignedBuffer<T> m_buffer;
+    size_t m_rows = 0;
+    size_t m_cols = 0;
+
+public:
+    DynMat() = default;
+    DynMat(size_t rows, size_t cols)
+        : m_buffer(rows * cols)
+        , m_rows(rows)
+        , m_cols(cols)
+    {
+    }
+    DynMat(size_t rows, size_t cols, T fill_value)
+        : DynMat(rows, cols)
+    {
+        std::fill(begin(), end(), fill_value);
+    }
+    DynMat(const std::initializer_list<std::initializer_list<T>>& elements)
+        : DynMat(elements.size(), elements.size() ? elements.begin()->size() : 0)
+    {
+        size_t i = 0;
+        for (const auto& row : elements) {
+            assert(row.size() == m_cols);
+            for (const auto& element : row) {
+                data()[i] = element;
+                i++;
+            }
+        }
+    }
+    template <size_t R, size_t C, typename Layout>
+    explicit DynMat(const Mat<R, C, T, Layout>& mat)
+        : DynMat(R, C)
+    {
+        if constexpr (std::is_same_v<Layout, RowMajor>) {
+            std::ranges::copy(mat, begin());
+        } else {
+            for (size_t row = 0; row < R; ++row) {
+                for (size_t col = 0; col < C; ++col) {
+                    (*this)[row][col] = mat.at(row, col);
+                }
+            }
+        }
+    }
+    template <size_t R, size_t C, typename Layout>
+    explicit operator Mat<R, C, T, Layout>() const
+    {
+        assert(R == m_rows && C == m_cols);
+        Mat<R, C, T, Layout> mat;
+        if constexpr (std::is_same_v<Layout, RowMajor>) {
+            std::ranges::copy(*this, mat.begin());
+        } else {
+            for (size_t row = 0; row < R; ++row) {
+                for (size_t col = 0; col < C; ++col) {
+                    mat.at(row, col) = (*this)[row][col];
+                }
+            }
+        }
+        return mat;
+    }
+
+    DynMat(DynMat&& other) noexcept
+        : m_buffer(std::move(other.m_buffer))
+        , m_rows(std::exchange(other.m_rows, 0))
+        , m_cols(std::exchange(other.m_cols, 0))
+    {
+    }
+    DynMat& operator=(DynMat&& other) noexcept
+    {
+        m_buffer = std::move(other.m_buffer);
+        m_rows = std::exchange(other.m_rows, 0);
+        m_cols = std::exchange(other.m_cols, 0);
+        return *this;
+    }
+
+    DynMat clone() const
+    {
+        DynMat copy(m_rows, m_cols);
+        std::ranges::copy(*this, copy.begin());
+        return copy;
+    }
+
+    T* data()
+    {
+        return m_buffer.data();
+    }
+    const T* data() const
+    {
+        return m_buffer.data();
+    }
+    size_t rows() const
+    {
+        return m_rows;
+    }
+    size_t cols() const
+    {
+        return m_cols;
+    }
+    size_t size() const
+    {
+        return m_buffer.size();
+    }
+    auto begin() -> T*
+    {
+        return data();
+    }
+    auto begin() const -> const T*
+    {
+        return data();
+    }
+    auto cbegin() const -> const T*
+    {
+        return data();
+    }
+    auto end() -> T*
+    {
+        return data() + size();
+    }
+    auto end() const -> const T*
+    {
+        return data() + size();
+    }
+    auto cend() const -> const T*
+    {
+        return data() + size();
+    }
+    T* operator[](size_t row)
+    {
+        assert(row < m_rows);
+        return data() + (row * m_cols);
+    }
+    const T* operator[](size_t row) const
+    {
+        assert(row < m_rows);
+        return data() + (row * m_cols);
+    }
+
+    bool operator==(const DynMat<T>& other) const
+    {
+        constexpr float TOLERANCE = equalityTolerance<T>(1e-4f);
+        auto abs = [](auto x) { return (x < 0) ? -x : x; };
+        return m_rows == other.m_rows && m_cols == other.m_cols
+            && std::ranges::equal(*this, other, [&](const T& lhs, const T& rhs) { return abs(lhs - rhs) < TOLERANCE; });
+    }
+    bool operator!=(const DynMat<T>& other) const
+    {
+        return !(*this == other);
+    }
+
+    DynMat<T> operator*(T scalar) const
+    {
+        DynMat<T> out(m_rows, m_cols);
+        std::ranges::transform(*this, out.begin(), [&](const T& e) { return e * scalar; });
+        return out;
+    }
+    DynMat<T> operator*(const DynMat<T>& b) const
+    {
+        assert(m_cols == b.m_rows);
+        DynMat<T> c(m_rows, b.m_cols);
+        Kernel::gemm<T>(m_rows, b.m_cols, m_cols, { data(), m_cols, 1 }, { b.data(), b.m_cols, 1 }, { c.data(), c.m_cols, 1 });
+        return c;
+    }
+    // Mixed products accept a Mat of any layout, a tiled one is copied to row-major first.
+    template <size_t R2, size_t C2, typename Layout>
+    DynMat<T> operator*(const Mat<R2, C2, T, Layout>& b) const
+    {
+        assert(m_cols == R2);
+        DynMat<T> c(m_rows, C2);
+        std::unique_ptr<Mat<R2, C2, T>> b_copy;
+        Kernel::gemm<T>(m_rows, C2, m_cols, { data(), m_cols, 1 }, Kernel::stridedOperand(b, b_copy), { c.data(), C2, 1 });
+        return c;
+    }
+    template <size_t R1, size_t C1, typename Layout>
+    friend DynMat<T> operator*(const Mat<R1, C1, T, Layout>& a, const DynMat<T>& b)
+    {
+        assert(C1 == b.m_rows);
+        DynMat<T> c(R1, b.m_cols);
+        std::unique_ptr<Mat<R1, C1, T>> a_copy;
+        Kernel::gemm<T>(R1, b.m_cols, C1, Kernel::stridedOperand(a, a_copy), { b.data(), b.m_cols, 1 }, { c.data(), b.m_cols, 1 });
+        return c;
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const DynMat<T>& mat)
+    {
+        os << '[';
+        for (size_t i = 0; i < mat.rows(); ++i) {
+            os << "{ ";
+            for (size_t j = 0; j < mat.cols(); ++j) {
+                os << mat[i][j] << ' ';
+            }
+            os << '}';
+        }
+        os << ']';
+        return os;
+    }
+};
+
+template <typename T>
+DynVec<T> dotProduct(const DynMat<T>& mat, const DynVec<T>& vec)
+{
+    assert(mat.cols() == vec.size());
+    DynVec<T> output(mat.rows());
+    Kernel::gemv<T>(mat.rows(), mat.cols(), { mat.data(), mat.cols(), 1 }, vec.data(), output.data());
+    return output;
+}
+
+template <size_t N, typename T>
+DynVec<T> dotProduct(const DynMat<T>& mat, const Vec<N, T>& vec)
+{
+    assert(mat.cols() == N);
+    DynVec<T> output(mat.rows());
+    Kernel::gemv<T>(mat.rows(), N, { mat.data(), N, 1 }, vec.data, output.data());
+    return output;
+}
+
+template <typename T>
+DynVec<T> dotProduct(const DynVec<T>& vec, const DynMat<T>& mat)
+{
+    assert(mat.rows() == vec.size());
+    DynVec<T> output(mat.cols());
+    for (size_t row = 0; row < mat.rows(); ++row) {
+        const T scale = vec[row];
+        std::transform(mat[row], mat[row] + mat.cols(), output.begin(), output.begin(), [&](const T& m, const T& o) { return o + m * scale; });
+    }
+    return output;
+}
+
+template <typename T>
+T dotProduct(const DynVec<T>& vec1, const DynVec<T>& vec2)
+{
+    assert(vec1.size() == vec2.size());
+    return Kernel::dot(vec1.size(), vec1.data(), vec2.data());
+}
+
+template <typename T>
+DynMat<T> transpose(const DynMat<T>& mat)
+{
+    DynMat<T> transposed(mat.cols(), mat.rows());
+    for (size_t row = 0; row < mat.rows(); row++) {
+        for (size_t col = 0; col < mat.cols(); col++) {
+            transposed[col][row] = mat[row][col];
+        }
+    }
+    return transposed;
+}
+
+/*
+    Non-owning strided views of Vec / Mat / DynVec / DynMat storage. Element i of a VecView is
+    data[i * stride], element (row, col) of a MatView is data[row * row_stride + col * col_stride],
+    so rows, columns, blocks, the diagonal and the transpose of a matrix are all views of the
+    same elements and nothing is copied.
+    A view of T writes through to the storage, a view of const T is read-only. Views are cheap
+    to copy and must not outlive what they refer to.
+*/
+template <typename T>
+class VecView {
+private:
+    T* m_data = nullptr;
+    size_t m_size = 0;
+    size_t m_stride = 1;
+
+public:
+    using value_type = std::remove_const_t<T>;
+
+    constexpr VecView() = default;
+    constexpr VecView(T* data, size_t size, size_t stride = 1)
+        : m_data(data)
+        , m_size(size)
+        , m_stride(stride)
+    {
+    }
+    template <size_t N>
+    constexpr VecView(Vec<N, value_type>& vec)
+        : VecView(vec.data, N)
+    {
+    }
+    template <size_t N>
+        requires std::is_const_v<T>
+    constexpr VecView(const Vec<N, value_type>& vec)
+        : VecView(vec.data, N)
+    {
+    }
+    VecView(DynVec<value_type>& vec)
+        : VecView(vec.data(), vec.size())
+    {
+    }
+    VecView(const DynVec<value_type>& vec)
+        requires std::is_const_v<T>
+        : VecView(vec.data(), vec.size())
+    {
+    }
+    template <typename U>
+        requires std::is_const_v<T> && std::is_same_v<U, value_type>
+    constexpr VecView(const VecView<U>& other)
+        : VecView(other.data(), other.size(), other.stride())
+    {
+    }
+
+    template <size_t N>
+    explicit constexpr operator Vec<N, value_type>() const
+    {
+        assert(N == m_size);
+        Vec<N, value_type> vec;
+        for (size_t i = 0; i < N; ++i) {
+            vec[i] = (*this)[i];
+        }
+        return vec;
+    }
+    explicit operator DynVec<value_type>() const
+    {
+        DynVec<value_type> vec(m_size);
+        for (size_t i = 0; i < m_size; ++i) {
+            vec[i] = (*this)[i];
+        }
+        return vec;
+    }
+
+    constexpr T* data() const
+    {
+        return m_data;
+    }
+    constexpr size_t size() const
+    {
+        return m_size;
+    }
+    constexpr size_t stride() const
+    {
+        return m_stride;
+    }
+
+    constexpr T& operator[](size_t index) const
+    {
+        assert(index < m_size);
+        return m_data[index * m_stride];
+    }
+
+    // count elements starting at begin, every step-th element of this view.
+    constexpr VecView slice(size_t begin, size_t count, size_t step = 1) const
+    {
+        assert(count == 0 || begin + (count - 1) * step < m_size);
+        return { m_data + begin * m_stride, count, m_stride * step };
+    }
+
+    constexpr VecView& assign(VecView<const value_type> other)
+        requires(!std::is_const_v<T>)
+    {
+        return combine(other, [](const auto&, const auto& b) { return b; });
+    }
+    constexpr VecView& fill(value_type value)
+        requires(!std::is_const_v<T>)
+    {
+        for (size_t i = 0; i < m_size; ++i) {
+            (*this)[i] = value;
+        }
+        return *this;
+    }
+    constexpr VecView& operator+=(VecView<const value_type> other)
+        requires(!std::is_const_v<T>)
+    {
+        return combine(other, std::plus {});
+    }
+    constexpr VecView& operator-=(VecView<const value_type> other)
+        requires(!std::is_const_v<T>)
+    {
+        return combine(other, std::minus {});
+    }
+    constexpr VecView& operator*=(value_type scalar)
+        requires(!std::is_const_v<T>)
+    {
+        for (size_t i = 0; i < m_size; ++i) {
+            (*this)[i] *= scalar;
+        }
+        return *this;
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const VecView& vec)
+    {
+        os << "{ ";
+        for (size_t i = 0; i < vec.size(); ++i) {
+            os << vec[i] << ' ';
+        }
+        os << '}';
+        return os;
+    }
+
+private:
+    // this[i] = op(this[i], other[i]), on packs when both views are contiguous.
+    template <typename F>
+    constexpr VecView& combine(VecView<const value_type> other, const F& op)
+    {
+        assert(other.size() == m_size);
+        if !consteval {
+            if (m_stride == 1 && other.stride() == 1) {
+                Kernel::blockedTransform<value_type>(nullptr, m_size, m_data, other.data(), m_data, op);
+                return *this;
+            }
+        }
+        for (size_t i = 0; i < m_size; ++i) {
+            (*this)[i] = op((*this)[i], other[i]);
+        }
+        return *this;
+    }
+};
+
+template <size_t N, typename T>
+VecView(Vec<N, T>&) -> VecView<T>;
+template <size_t N, typename T>
+VecView(const Vec<N, T>&) -> VecView<const T>;
+template <typename T>
+VecView(DynVec<T>&) -> VecView<T>;
+template <typename T>
+VecView(const DynVec<T>&) -> VecView<const T>;
+
+template <typename T>
+class MatView {
+private:
+    T* m_data = nullptr;
+    size_t m_rows = 0;
+    size_t m_cols = 0;
+    size_t m_row_stride = 0;
+    size_t m_col_stride = 1;
+
+public:
+    using value_type = std::remove_const_t<T>;
+
+    constexpr MatView() = default;
+    constexpr MatView(T* data, size_t rows, size_t cols, size_t row_stride, size_t col_stride = 1)
+        : m_data(data)
+        , m_rows(rows)
+        , m_cols(cols)
+        , m_row_stride(row_stride)
+        , m_col_stride(col_stride)
+    {
+    }
+    template <size_t R, size_t C, StridedLayout Layout>
+    constexpr MatView(Mat<R, C, value_type, Layout>& mat)
+        : MatView(mat.data, R, C, mat.strided().row_stride, mat.strided().col_stride)
+    {
+    }
+    template <size_t R, size_t C, StridedLayout Layout>
+        requires std::is_const_v<T>
+    constexpr MatView(const Mat<R, C, value_type, Layout>& mat)
+        : MatView(mat.data, R, C, mat.strided().row_stride, mat.strided().col_stride)
+    {
+    }
+    MatView(DynMat<value_type>& mat)
+        : MatView(mat.data(), mat.rows(), mat.cols(), mat.cols())
+    {
+    }
+    MatView(const DynMat<value_type>& mat)
+        requires std::is_const_v<T>
+        : MatView(mat.data(), mat.rows(), mat.cols(), mat.cols())
+    {
+    }
+    template <typename U>
+        requires std::is_const_v<T> && std::is_same_v<U, value_type>
+    constexpr MatView(const MatView<U>& other)
+        : MatView(other.data(), other.rows(), other.cols(), other.rowStride(), other.colStride())
+    {
+    }
+
+    template <size_t R, size_t C, typename Layout>
+    explicit constexpr operator Mat<R, C, value_type, Layout>() const
+    {
+        assert(R == m_rows && C == m_cols);
+        Mat<R, C, value_type, Layout> mat;
+        if constexpr (StridedLayout<Layout>) {
+            MatView<value_type>(mat).assign(*this);
+        } else {
+            for (size_t row = 0; row < R; ++row) {
+                for (size_t col = 0; col < C; ++col) {
+                    mat.at(row, col) = at(row, col);
+                }
+            }
+        }
+        return mat;
+    }
+    explicit operator DynMat<value_type>() const
+    {
+        DynMat<value_type> mat(m_rows, m_cols);
+        MatView<value_type>(mat).assign(*this);
+        return mat;
+    }
+
+    constexpr T* data() const
+    {
+        return m_data;
+    }
+    constexpr size_t rows() const
+    {
+        return m_rows;
+    }
+    constexpr size_t cols() const
+    {
+        return m_cols;
+    }
+    constexpr size_t rowStride() const
+    {
+        return m_row_stride;
+    }
+    constexpr size_t colStride() const
+    {
+        return m_col_stride;
+    }
+    constexpr Kernel::Strided<T> strided() const
+    {
+        return { m_data, m_row_stride, m_col_stride };
+    }
+
+    constexpr T& at(size_t row, size_t col) const
+    {
+        assert(row < m_rows && col < m_cols);
+        return m_data[row * m_row_stride + col * m_col_stride];
+    }
+    constexpr VecView<T> operator[](size_t index) const
+    {
+        return row(index);
+    }
+    constexpr VecView<T> row(size_t index) const
+    {
+        assert(index < m_rows);
+        return { m_data + index * m_row_stride, m_cols, m_col_stride };
+    }
+    constexpr VecView<T> col(size_t index) const
+    {
+        assert(index < m_cols);
+        return { m_data + index * m_col_stride, m_rows, m_row_stride };
+    }
+    constexpr VecView<T> diagonal() const
+    {
+        return { m_data, std::min(m_rows, m_cols), m_row_stride + m_col_stride };
+    }
+    // The rows x cols block with its top left corner at (row, col).
+    constexpr MatView block(size_t row, size_t col, size_t rows, size_t cols) const
+    {
+        assert(row + rows <= m_rows && col + cols <= m_cols);
+        return { m_data + row * m_row_stride + col * m_col_stride, rows, cols, m_row_stride, m_col_stride };
+    }
+    constexpr MatView transposed() const
+    {
+        return { m_data, m_cols, m_rows, m_col_stride, m_row_stride };
+    }
+
+    constexpr MatView& assign(MatView<const value_type> other)
+        requires(!std::is_const_v<T>)
+    {
+        assert(other.rows() == m_rows && other.cols() == m_cols);
+        for (size_t i = 0; i < m_rows; ++i) {
+            row(i).assign(other.row(i));
+        }
+        return *this;
+    }
+    constexpr MatView& fill(value_type value)
+        requires(!std::is_const_v<T>)
+    {
+        for (size_t i = 0; i < m_rows; ++i) {
+            row(i).fill(value);
+        }
+        return *this;
+    }
+    constexpr MatView& operator+=(MatView<const value_type> other)
+        requires(!std::is_const_v<T>)
+    {
+        assert(other.rows() == m_rows && other.cols() == m_cols);
+        for (size_t i = 0; i < m_rows; ++i) {
+            row(i) += other.row(i);
+        }
+        return *this;
+    }
+    constexpr MatView& operator-=(MatView<const value_type> other)
+        requires(!std::is_const_v<T>)
+    {
+        assert(other.rows() == m_rows && other.cols() == m_cols);
+        for (size_t i = 0; i < m_rows; ++i) {
+            row(i) -= other.row(i);
+        }
+        return *this;
+    }
+    constexpr MatView& operator*=(value_type scalar)
+        requires(!std::is_const_v<T>)
+    {
+        for (size_t i = 0; i < m_rows; ++i) {
+            row(i) *= scalar;
+        }
+        return *this;
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const MatView& mat)
+    {
+        os << '[';
+        for (size_t i = 0; i < mat.rows(); ++i) {
+            os << mat.row(i);
+        }
+        os << ']';
+        return os;
+    }
+};
+
+template <size_t R, size_t C, typename T, StridedLayout Layout>
+MatView(Mat<R, C, T, Layout>&) -> MatView<T>;
+template <size_t R, size_t C, typename T, StridedLayout Layout>
+MatView(const Mat<R, C, T, Layout>&) -> MatView<const T>;
+template <typename T>
+MatView(DynMat<T>&) -> MatView<T>;
+template <typename T>
+MatView(const DynMat<T>&) -> MatView<const T>;
+
+template <typename A, typename B>
+concept SameValueType = std::is_same_v<std::remove_const_t<A>, std::remove_const_t<B>>;
+
+// Zero-copy, the view with rows and columns swapped.
+template <typename T>
+constexpr MatView<T> transpose(const MatView<T>& mat)
+{
+    return mat.transposed();
+}
+
+template <typename A, typename B>
+    requires SameValueType<A, B>
+constexpr std::remove_const_t<A> dotProduct(VecView<A> vec1, VecView<B> vec2)
+{
+    using T = std::remove_const_t<A>;
+    assert(vec1.size() == vec2.size());
+    if !consteval {
+        if (vec1.stride() == 1 && vec2.stride() == 1) {
+            return Kernel::dot<T>(vec1.size(), vec1.data(), vec2.data());
+        }
+    }
+    Accumulator<T> value = {};
+    for (size_t i = 0; i < vec1.size(); ++i) {
+        value += vec1[i] * vec2[i];
+    }
+    return value;
+}
+
+// A strided vec is gathered once, the matrix is read in place whatever its strides.
+template <typename A, typename B>
+    requires SameValueType<A, B>
+DynVec<std::remove_const_t<A>> dotProduct(MatView<A> mat, VecView<B> vec)
+{
+    using T = std::remove_const_t<A>;
+    assert(mat.cols() == vec.size());
+    DynVec<T> output(mat.rows());
+    DynVec<T> gathered;
+    const T* x = vec.data();
+    if (vec.stride() != 1) {
+        gathered = static_cast<DynVec<T>>(vec);
+        x = gathered.data();
+    }
+    Kernel::gemv<T>(mat.rows(), mat.cols(), mat.strided(), x, output.data());
+    return output;
+}
+
+template <typename A, typename B>
+    requires SameValueType<A, B>
+DynVec<std::remove_const_t<A>> dotProduct(VecView<A> vec, MatView<B> mat)
+{
+    return dotProduct(mat.transposed(), vec);
+}
+
+namespace Kernel {
+    // C += A * B (-= when SUBTRACT) on views, gemm() for large products at runtime.
+    template <bool SUBTRACT, typename A, typename B, typename T>
+    constexpr void viewProduct(MatView<A> a, MatView<B> b, MatView<T> c)
+    {
+        assert(a.cols() == b.rows() && c.rows() == a.rows() && c.cols() == b.cols());
+        if !consteval {
+            if (a.rows() * a.cols() * b.cols() >= GEMM_THRESHOLD) {
+                if constexpr (SUBTRACT) {
+                    gemmSubtract<T>(c.rows(), c.cols(), a.cols(), a.strided(), b.strided(), c.strided());
+                } else {
+                    gemm<T>(c.rows(), c.cols(), a.cols(), a.strided(), b.strided(), c.strided());
+                }
+                return;
+            }
+        }
+        for (size_t row = 0; row < c.rows(); ++row) {
+            for (size_t col = 0; col < c.cols(); ++col) {
+                Accumulator<T> value = {};
+                for (size_t i = 0; i < a.cols(); ++i) {
+                    value += a.at(row, i) * b.at(i, col);
+                }
+                if constexpr (SUBTRACT) {
+                    c.at(row, col) -= value;
+                } else {
+                    c.at(row, col) += value;
+                }
+            }
+        }
+    }
+}
+
+// C += A * B. c must not overlap a or b.
+template <typename A, typename B, typename T>
+    requires SameValueType<A, B> && std::is_same_v<std::remove_const_t<A>, T>
+constexpr void multiplyAdd(MatView<A> a, MatView<B> b, MatView<T> c)
+{
+    Kernel::viewProduct<false>(a, b, c);
+}
+
+// C -= A * B, the trailing update of blocked factorisations. c must not overlap a or b.
+template <typename A, typename B, typename T>
+    requires SameValueType<A, B> && std::is_same_v<std::remove_const_t<A>, T>
+constexpr void multiplySubtract(MatView<A> a, MatView<B> b, MatView<T> c)
+{
+    Kernel::viewProduct<true>(a, b, c);
+}
+
+template <typename A, typename B>
+    requires SameValueType<A, B>
+DynMat<std::remove_const_t<A>> operator*(MatView<A> a, MatView<B> b)
+{
+    DynMat<std::remove_const_t<A>> c(a.rows(), b.cols());
+    multiplyAdd(a, b, MatView(c));
+    return c;
+}
+
+/*
+    Runtime sized collection of Vec<N, T> stored as N separate 64 byte aligned component arrays,
+    so per-component work over the whole set runs at full SIMD width. Move-only, use clone()
+    for an explicit copy. soa[i] reads and writes element i as a Vec<N, T>.
+*/
+template <size_t N, typename T = float>
+class SoAVec {
+private:
+    std::array<AlignedBuffer<T>, N> m_components;
+    size_t m_size = 0;
+
+public:
+    /*
+        Proxy for element i, converts to and assigns from Vec<N, T>.
+    */
+    class Reference {
+    private:
+        SoAVec* m_owner;
+        size_t m_index;
+
+    public:
+        Reference(SoAVec& owner, size_t index)
+            : m_owner(&owner)
+            , m_index(index)
+        {
+        }
+
+        operator Vec<N, T>() const
+        {
+            return std::as_const(*m_owner)[m_index];
+        }
+        Reference& operator=(const Vec<N, T>& vec)
+        {
+            for (size_t c = 0; c < N; ++c) {
+                m_owner->component(c)[m_index] = vec[c];
+            }
+            return *this;
+        }
+        Reference& operator=(const Reference& other)
+        {
+            return *this = static_cast<Vec<N, T>>(other);
+        }
+        T& operator[](size_t c) const
+        {
+            assert(c < N);
+            return m_owner->component(c)[m_index];
+        }
+    };
+
+    SoAVec() = default;
+    explicit SoAVec(size_t size)
+        : m_size(size)
+    {
+        for (auto& component : m_components) {
+            component = AlignedBuffer<T>(size);
+        }
+    }
+    SoAVec(size_t size, const Vec<N, T>& fill_value)
+        : SoAVec(size)
+    {
+        for (size_t c = 0; c < N; ++c) {
+            std::fill(component(c), component(c) + size, fill_value[c]);
+        }
+    }
+    explicit SoAVec(std::span<const Vec<N, T>> vecs)
+        : SoAVec(vecs.size())
+    {
+        for (size_t i = 0; i < size(); ++i) {
+            for (size_t c = 0; c < N; ++c) {
+                component(c)[i] = vecs[i].data[c];
+            }
+        }
+    }
+    explicit SoAVec(std::span<const Pos<N, T>> positions)
+        : SoAVec(positions.size())
+    {
+        for (size_t i = 0; i < size(); ++i) {
+            for (size_t c = 0; c < N; ++c) {
+                component(c)[i] = positions[i].data[c];
+            }
+        }
+    }
+
+    SoAVec(SoAVec&& other) noexcept
+        : m_components(std::move(other.m_components))
+        , m_size(std::exchange(other.m_size, 0))
+    {
+    }
+    SoAVec& operator=(SoAVec&& other) noexcept
+    {
+        m_components = std::move(other.m_components);
+        m_size = std::exchange(other.m_size, 0);
+        return *this;
+    }
+
+    SoAVec clone() const
+    {
+        SoAVec copy(size());
+        for (size_t c = 0; c < N; ++c) {
+            std::copy(component(c), component(c) + size(), copy.component(c));
+        }
+        return copy;
+    }
+
+    // Writes the elements back out as an array of structures, out.size() must equal size().
+    void toAoS(std::span<Vec<N, T>> out) const
+    {
+        assert(out.size() == size());
+        for (size_t i = 0; i < size(); ++i) {
+            for (size_t c = 0; c < N; ++c) {
+                out[i].data[c] = component(c)[i];
+            }
+        }
+    }
+    void toAoS(std::span<Pos<N, T>> out) const
+    {
+        assert(out.size() == size());
+        for (size_t i = 0; i < size(); ++i) {
+            for (size_t c = 0; c < N; ++c) {
+                out[i].data[c] = component(c)[i];
+            }
+        }
+    }
+
+    T* component(size_t c)
+    {
+        assert(c < N);
+        return m_components[c].data();
+    }
+    const T* component(size_t c) const
+    {
+        assert(c < N);
+        return m_components[c].data();
+    }
+    size_t size() const
+    {
+        return m_size;
+    }
+
+    Reference operator[](size_t index)
+    {
+        assert(index < size());
+        return Reference(*this, index);
+    }
+    Vec<N, T> operator[](size_t index) const
+    {
+        assert(index < size());
+        Vec<N, T> vec;
+        for (size_t c = 0; c < N; ++c) {
+            vec[c] = component(c)[index];
+        }
+        return vec;
+    }
+};
+
+namespace Kernel {
+    /*
+        Runs step(i, n) over [0, size) in packs of width lanes, n == width for every call but
+        the tail so the full width loads and stores inline for the main loop.
+    */
+    template <size_t W, typename F>
+    void forEachPack(size_t size, F&& step)
+    {
+        size_t i = 0;
+        for (; i + W <= size; i += W) {
+            step(i, W);
+        }
+        if (i < size) {
+            step(i, size - i);
+        }
+    }
+
+    template <typename P, typename T>
+    P loadLanes(const T* ptr, size_t n)
+    {
+        return n == P::width ? P::load(ptr) : P::loadPartial(ptr, n);
+    }
+
+    template <typename P, typename T>
+    void storeLanes(const P& pack, T* ptr, size_t n)
+    {
+        if (n == P::width) {
+            pack.store(ptr);
+        } else {
+            pack.storePartial(ptr, n);
+        }
+    }
+
+    // Sum over components of a[c][i] * b[c][i] for the n lanes starting at i.
+    template <typename P, size_t N, typename T>
+    P soaDot(const SoAVec<N, T>& a, const SoAVec<N, T>& b, size_t i, size_t n)
+    {
+        P sum = P::zero();
+        for (size_t c = 0; c < N; ++c) {
+            sum = mulAdd(loadLanes<P>(a.component(c) + i, n), loadLanes<P>(b.component(c) + i, n), sum);
+        }
+        return sum;
+    }
+}
+
+/*
+    Element-wise bulk operations over whole SoAVec sets, out may alias an input.
+*/
+template <size_t N, typename T>
+void add(const SoAVec<N, T>& a, const SoAVec<N, T>& b, SoAVec<N, T>& out)
+{
+    using P = Simd::Pack<T, Simd::NATIVE_WIDTH<T>>;
+    assert(a.size() == b.size() && a.size() == out.size());
+
+    for (size_t c = 0; c < N; ++c) {
+        const T* lhs = a.component(c);
+        const T* rhs = b.component(c);
+        T* dst = out.component(c);
+        Kernel::forEachPack<P::width>(a.size(), [&](size_t i, size_t n) {
+            Kernel::storeLanes(Kernel::loadLanes<P>(lhs + i, n) + Kernel::loadLanes<P>(rhs + i, n), dst + i, n);
+        });
+    }
+}
+
+template <size_t N, typename T>
+void scale(const SoAVec<N, T>& a, T factor, SoAVec<N, T>& out)
+{
+    using P = Simd::Pack<T, Simd::NATIVE_WIDTH<T>>;
+    assert(a.size() == out.size());
+
+    const P factor_pack = P::broadcast(factor);
+    for (size_t c = 0; c < N; ++c) {
+        const T* src = a.component(c);
+        T* dst = out.component(c);
+        Kernel::forEachPack<P::width>(a.size(), [&](size_t i, size_t n) {
+            Kernel::storeLanes(Kernel::loadLanes<P>(src + i, n) * factor_pack, dst + i, n);
+        });
+    }
+}
+
+// out[i] = dotProduct(a[i], b[i])
+template <size_t N, typename T>
+void dotProduct(const SoAVec<N, T>& a, const SoAVec<N, T>& b, std::span<T> out)
+{
+    using P = Simd::Pack<T, Simd::NATIVE_WIDTH<T>>;
+    assert(a.size() == b.size() && out.size() >= a.size());
+
+    Kernel::forEachPack<P::width>(a.size(), [&](size_t i, size_t n) {
+        Kernel::storeLanes(Kernel::soaDot<P>(a, b, i, n), out.data() + i, n);
+    });
+}
+
+// out[i] = a[i].getLength()
+template <size_t N, typename T>
+void length(const SoAVec<N, T>& a, std::span<T> out)
+{
+    using P = Simd::Pack<T, Simd::NATIVE_WIDTH<T>>;
+    assert(out.size() >= a.size());
+
+    Kernel::forEachPack<P::width>(a.size(), [&](size_t i, size_t n) {
+        Kernel::storeLanes(sqrt(Kernel::soaDot<P>(a, a, i, n)), out.data() + i, n);
+    });
+}
+
+// out[i] = a[i].getNormalised()
+template <size_t N, typename T>
+void normalise(const SoAVec<N, T>& a, SoAVec<N, T>& out)
+{
+    using P = Simd::Pack<T, Simd::NATIVE_WIDTH<T>>;
+    assert(a.size() == out.size());
+
+    Kernel::forEachPack<P::width>(a.size(), [&](size_t i, size_t n) {
+        const P inverse_length = P::broadcast(1) / sqrt(Kernel::soaDot<P>(a, a, i, n));
+        for (size_t c = 0; c < N; ++c) {
+            Kernel::storeLanes(Kernel::loadLanes<P>(a.component(c) + i, n) * inverse_length, out.component(c) + i, n);
+        }
+    });
+}
+
+/*
+    Matrix product with an explicit execution policy, the result has a's layout.
+    Parallel policies split the output into tiles computed on Parallel::ThreadPool::instance().
+    Products with a tiled operand or result run as a * b on the calling thread.
+*/
+template <typename Policy, size_t R, size_t C, size_t C2, typename T, typename Layout, typename Layout2>
+    requires std::is_execution_policy_v<std::remove_cvref_t<Policy>>
+Mat<R, C2, T, Layout> multiply(Policy&&, const Mat<R, C, T, Layout>& a, const Mat<C, C2, T, Layout2>& b)
+{
+    if constexpr (!Parallel::IS_PARALLEL_POLICY<Policy> || R * C * C2 < Kernel::GEMM_THRESHOLD || !StridedLayout<Layout> || !StridedLayout<Layout2>) {
+        return a * b;
+    } else {
+        Mat<R, C2, T, Layout> c {};
+        Kernel::parallelGemm<T>(Parallel::ThreadPool::instance(), R, C2, C, a.strided(), b.strided(), c.strided());
+        return c;
+    }
+}
+
+template <typename Policy, typename T>
+    requires std::is_execution_policy_v<std::remove_cvref_t<Policy>>
+DynMat<T> multiply(Policy&&, const DynMat<T>& a, const DynMat<T>& b)
+{
+    if constexpr (!Parallel::IS_PARALLEL_POLICY<Policy>) {
+        return a * b;
+    } else {
+        assert(a.cols() == b.rows());
+        DynMat<T> c(a.rows(), b.cols());
+        Kernel::parallelGemm<T>(Parallel::ThreadPool::instance(), a.rows(), b.cols(), a.cols(), { a.data(), a.cols(), 1 }, { b.data(), b.cols(), 1 }, { c.data(), c.cols(), 1 });
+        return c;
+    }
+}
+
+// Tiled Mats run on tiledGemv() on the calling thread.
+template <typename Policy, size_t R, size_t C, size_t N, typename T, typename Layout>
+    requires std::is_execution_policy_v<std::remove_cvref_t<Policy>>
+Vec<R, T> dotProduct(Policy&&, const Mat<R, C, T, Layout>& mat, const Vec<N, T>& vec)
+{
+    static_assert(N == C, "Incompatible operation");
+    if constexpr (!Parallel::IS_PARALLEL_POLICY<Policy> || !StridedLayout<Layout>) {
+        return dotProduct(mat, vec);
+    } else {
+        Vec<R, T> output;
+        Kernel::parallelGemv<T>(Parallel::ThreadPool::instance(), R, C, mat.strided(), vec.data, output.data);
+        return output;
+    }
+}
+
+template <typename Policy, typename T>
+    requires std::is_execution_policy_v<std::remove_cvref_t<Policy>>
+DynVec<T> dotProduct(Policy&&, const DynMat<T>& mat, const DynVec<T>& vec)
+{
+    if constexpr (!Parallel::IS_PARALLEL_POLICY<Policy>) {
+        return dotProduct(mat, vec);
+    } else {
+        assert(mat.cols() == vec.size());
+        DynVec<T> output(mat.rows());
+        Kernel::parallelGemv<T>(Parallel::ThreadPool::instance(), mat.rows(), mat.cols(), { mat.data(), mat.cols(), 1 }, vec.data(), output.data());
+        return output;
+    }
+}
+
+/*
+    Reductions and element-wise operations over long vectors with an explicit execution policy.
+    Parallel policies split the vectors into Kernel::REDUCE_BLOCK sized blocks computed on
+    Parallel::ThreadPool::instance(). Reductions return the same value for every policy, see
+    Summation for their accuracy.
+*/
+namespace Kernel {
+    template <typename Policy>
+    Parallel::ThreadPool* policyPool()
+    {
+        if constexpr (Parallel::IS_PARALLEL_POLICY<Policy>) {
+            return &Parallel::ThreadPool::instance();
+        } else {
+            return nullptr;
+        }
+    }
+
+    struct DotTerm {
+        template <typename P>
+        P operator()(const P& a, const P& b) const
+        {
+            return a * b;
+        }
+    };
+
+    struct SquaredDifferenceTerm {
+        template <typename P>
+        P operator()(const P& a, const P& b) const
+        {
+            const P difference = a - b;
+            return difference * difference;
+        }
+    };
+}
+
+template <typename Policy, size_t N, typename T>
+    requires std::is_execution_policy_v<std::remove_cvref_t<Policy>>
+T dotProduct(Policy&&, const Vec<N, T>& vec1, const Vec<N, T>& vec2, Summation summation = Summation::Pairwise)
+{
+    return Kernel::blockedReduce(Kernel::policyPool<Policy>(), N, vec1.data, vec2.data, summation, Kernel::DotTerm {});
+}
+
+template <typename Policy, typename T>
+    requires std::is_execution_policy_v<std::remove_cvref_t<Policy>>
+T dotProduct(Policy&&, const DynVec<T>& vec1, const DynVec<T>& vec2, Summation summation = Summation::Pairwise)
+{
+    assert(vec1.size() == vec2.size());
+    return Kernel::blockedReduce(Kernel::policyPool<Policy>(), vec1.size(), vec1.data(), vec2.data(), summation, Kernel::DotTerm {});
+}
+
+template <typename Policy, size_t N, typename T>
+    requires std::is_execution_policy_v<std::remove_cvref_t<Policy>>
+T lengthSquared(Policy&& policy, const Vec<N, T>& vec, Summation summation = Summation::Pairwise)
+{
+    return dotProduct(std::forward<Policy>(policy), vec, vec, summation);
+}
+
+template <typename Policy, typename T>
+    requires std::is_execution_policy_v<std::remove_cvref_t<Policy>>
+T lengthSquared(Policy&& policy, const DynVec<T>& vec, Summation summation = Summation::Pairwise)
+{
+    return dotProduct(std::forward<Policy>(policy), vec, vec, summation);
+}
+
+template <typename Policy, size_t N, typename T>
+    requires std::is_execution_policy_v<std::remove_cvref_t<Policy>>
+T length(Policy&& policy, const Vec<N, T>& vec, Summation summation = Summation::Pairwise)
+{
+    return Math::sqrt(lengthSquared(std::forward<Policy>(policy), vec, summation));
+}
+
+template <typename Policy, typename T>
+    requires std::is_execution_policy_v<std::remove_cvref_t<Policy>>
+T length(Policy&& policy, const DynVec<T>& vec, Summation summation = Summation::Pairwise)
+{
+    return Math::sqrt(lengthSquared(std::forward<Policy>(policy), vec, summation));
+}
+
+template <typename Policy, size_t N, typename T>
+    requires std::is_execution_policy_v<std::remove_cvref_t<Policy>>
+T distance(Policy&&, const Vec<N, T>& vec1, const Vec<N, T>& vec2, Summation summation = Summation::Pairwise)
+{
+    return Math::sqrt(Kernel::blockedReduce(Kernel::policyPool<Policy>(), N, vec1.data, vec2.data, summation, Kernel::SquaredDifferenceTerm {}));
+}
+
+template <typename Policy, size_t N, typename T>
+    requires std::is_execution_policy_v<std::remove_cvref_t<Policy>>
+T distance(Policy&&, const Pos<N, T>& pos1, const Pos<N, T>& pos2, Summation summation = Summation::Pairwise)
+{
+    return Math::sqrt(Kernel::blockedReduce(Kernel::policyPool<Policy>(), N, pos1.data, pos2.data, summation, Kernel::SquaredDifferenceTerm {}));
+}
+
+template <typename Policy, typename T>
+    requires std::is_execution_policy_v<std::remove_cvref_t<Policy>>
+T distance(Policy&&, const DynVec<T>& vec1, const DynVec<T>& vec2, Summation summation = Summation::Pairwise)
+{
+    assert(vec1.size() == vec2.size());
+    return Math::sqrt(Kernel::blockedReduce(Kernel::policyPool<Policy>(), vec1.size(), vec1.data(), vec2.data(), summation, Kernel::SquaredDifferenceTerm {}));
+}
+
+template <typename Policy, size_t N, typename T>
+    requires std::is_execution_policy_v<std::remove_cvref_t<Policy>>
+Vec<N, T> add(Policy&&, const Vec<N, T>& vec1, const Vec<N, T>& vec2)
+{
+    Vec<N, T> output;
+    Kernel::blockedTransform(Kernel::policyPool<Policy>(), N, vec1.data, vec2.data, output.data, std::plus {});
+    return output;
+}
+
+template <typename Policy, typename T>
+    requires std::is_execution_policy_v<std::remove_cvref_t<Policy>>
+DynVec<T> add(Policy&&, const DynVec<T>& vec1, const DynVec<T>& vec2)
+{
+    assert(vec1.size() == vec2.size());
+    DynVec<T> output(vec1.size());
+    Kernel::blockedTransform(Kernel::policyPool<Policy>(), vec1.size(), vec1.data(), vec2.data(), output.data(), std::plus {});
+    return output;
+}
+
+template <typename Policy, size_t N, typename T>
+    requires std::is_execution_policy_v<std::remove_cvref_t<Policy>>
+Vec<N, T> subtract(Policy&&, const Vec<N, T>& vec1, const Vec<N, T>& vec2)
+{
+    Vec<N, T> output;
+    Kernel::blockedTransform(Kernel::policyPool<Policy>(), N, vec1.data, vec2.data, output.data, std::minus {});
+    return output;
+}
+
+template <typename Policy, typename T>
+    requires std::is_execution_policy_v<std::remove_cvref_t<Policy>>
+DynVec<T> subtract(Policy&&, const DynVec<T>& vec1, const DynVec<T>& vec2)
+{
+    assert(vec1.size() == vec2.size());
+    DynVec<T> output(vec1.size());
+    Kernel::blockedTransform(Kernel::policyPool<Policy>(), vec1.size(), vec1.data(), vec2.data(), output.data(), std::minus {});
+    return output;
+}
+
+template <typename Policy, size_t N, typename T>
+    requires std::is_execution_policy_v<std::remove_cvref_t<Policy>>
+Vec<N, T> scale(Policy&&, const Vec<N, T>& vec, T factor)
+{
+    using P = Simd::Pack<T, Simd::NATIVE_WIDTH<T>>;
+    Vec<N, T> output;
+    const P factor_pack = P::broadcast(factor);
+    Kernel::blockedTransform(Kernel::policyPool<Policy>(), N, vec.data, vec.data, output.data, [&](const P& a, const P&) { return a * factor_pack; });
+    return output;
+}
+
+template <typename Policy, typename T>
+    requires std::is_execution_policy_v<std::remove_cvref_t<Policy>>
+DynVec<T> scale(Policy&&, const DynVec<T>& vec, T factor)
+{
+    using P = Simd::Pack<T, Simd::NATIVE_WIDTH<T>>;
+    DynVec<T> output(vec.size());
+    const P factor_pack = P::broadcast(factor);
+    Kernel::blockedTransform(Kernel::policyPool<Policy>(), vec.size(), vec.data(), vec.data(), output.data(), [&](const P& a, const P&) { return a * factor_pack; });
+    return output;
+}
+
+/*
+    Fused dense layer, activation(weights * input + bias) in one pass over the output.
+    Tiled weights are copied to row-major first.
+*/
+template <size_t R, size_t C, typename T, typename Layout, typename F = Activation::Linear>
+constexpr Vec<R, T> dense(const Mat<R, C, T, Layout>& weights, const Vec<C, T>& input, const Vec<R, T>& bias, const F& activation = {})
+{
+    Vec<R, T> output;
+    if !consteval {
+        std::unique_ptr<Mat<R, C, T>> weights_copy;
+        Kernel::denseGemv<T>(R, C, Kernel::stridedOperand(weights, weights_copy), input.data, bias.data, activation, output.data);
+        return output;
+    }
+    for (size_t row = 0; row < R; ++row) {
+        T value = bias[row];
+        for (size_t col = 0; col < C; ++col) {
+            value += weights[row][col] * input[col];
+        }
+        output[row] = activation(value);
+    }
+    return output;
+}
+
+/*
+    Batched dense layer, row b of the output is dense(weights, row b of inputs, bias).
+    Weights and inputs may have any layout, tiled ones are copied to row-major first. The output is row-major.
+*/
+template <size_t B, size_t R, size_t C, typename T, typename Layout, typename InputLayout, typename F = Activation::Linear>
+constexpr Mat<B, R, T> dense(const Mat<R, C, T, Layout>& weights, const Mat<B, C, T, InputLayout>& inputs, const Vec<R, T>& bias, const F& activation = {})
+{
+    Mat<B, R, T> output {};
+    if !consteval {
+        std::unique_ptr<Mat<R, C, T>> weights_copy;
+        std::unique_ptr<Mat<B, C, T>> inputs_copy;
+        const Kernel::Strided<const T> w = Kernel::stridedOperand(weights, weights_copy);
+        Kernel::gemm<T>(B, R, C, Kernel::stridedOperand(inputs, inputs_copy), { w.ptr, w.col_stride, w.row_stride }, output.strided(), Kernel::DenseEpilogue<T, F> { bias.data, activation });
+        return output;
+    }
+    for (size_t b = 0; b < B; ++b) {
+        for (size_t row = 0; row < R; ++row) {
+            T value = bias[row];
+            for (size_t col = 0; col < C; ++col) {
+                value += weights[row][col] * inputs[b][col];
+            }
+            output[b][row] = activation(value);
+        }
+    }
+    return output;
+}
+
+template <typename T, typename F = Activation::Linear>
+DynVec<T> dense(const DynMat<T>& weights, const DynVec<T>& input, const DynVec<T>& bias, const F& activation = {})
+{
+    assert(weights.cols() == input.size() && weights.rows() == bias.size());
+    DynVec<T> output(weights.rows());
+    Kernel::denseGemv<T>(weights.rows(), weights.cols(), { weights.data(), weights.cols(), 1 }, input.data(), bias.data(), activation, output.data());
+    return output;
+}
+
+template <typename T, typename F = Activation::Linear>
+DynMat<T> dense(const DynMat<T>& weights, const DynMat<T>& inputs, const DynVec<T>& bias, const F& activation = {})
+{
+    assert(weights.cols() == inputs.cols() && weights.rows() == bias.size());
+    DynMat<T> output(inputs.rows(), weights.rows());
+    Kernel::gemm<T>(inputs.rows(), weights.rows(), weights.cols(), { inputs.data(), inputs.cols(), 1 }, { weights.data(), 1, weights.cols() }, { output.data(), output.cols(), 1 }, Kernel::DenseEpilogue<T, F> { bias.data(), activation });
+    return output;
+}
+
+/*
+    Score used by SimilarityIndex. Dot and Cosine rank higher scores first, L2 is the euclidean
+    distance and ranks lower scores first.
+*/
+enum class Similarity {
+    Dot,
+    Cosine,
+    L2
+};
+
+template <typename T = float>
+struct Neighbour {
+    static constexpr size_t NONE = std::numeric_limits<size_t>::max();
+    T score = 0;
+    size_t index = NONE;
+};
+
+/*
+    Brute force nearest neighbour search over a fixed set of vectors of one dimension.
+    The vectors are kept as the rows of a DynMat with their norms computed once on construction.
+    Queries are scored QUERY_BLOCK at a time against DATABASE_BLOCK vectors with one gemm() and
+    each query keeps its best k in a bounded heap, so the full score matrix is never stored.
+*/
+template <typename T = float>
+class SimilarityIndex {
+public:
+    static constexpr size_t QUERY_BLOCK = 64;
+    static constexpr size_t DATABASE_BLOCK = 1024;
+
+private:
+    DynMat<T> m_vectors;
+    DynVec<T> m_squared_norms;
+    DynVec<T> m_inverse_norms;
+
+    void computeNorms()
+    {
+        m_squared_norms = DynVec<T>(size());
+        m_inverse_norms = DynVec<T>(size());
+        for (size_t i = 0; i < size(); ++i) {
+            m_squared_norms[i] = Kernel::dot(getDimension(), m_vectors[i], m_vectors[i]);
+            m_inverse_norms[i] = m_squared_norms[i] > 0 ? 1 / Math::sqrt(m_squared_norms[i]) : T { 0 };
+        }
+    }
+
+    // Ranking key for a raw dot product, higher is better for every Similarity.
+    static T toKey(Similarity similarity, T dot, T query_squared_norm, T query_inverse_norm, T squared_norm, T inverse_norm)
+    {
+        switch (similarity) {
+        case Similarity::Cosine:
+            return dot * query_inverse_norm * inverse_norm;
+        case Similarity::L2:
+            return 2 * dot - query_squared_norm - squared_norm;
+        default:
+            return dot;
+        }
+    }
+    static T fromKey(Similarity similarity, T key)
+    {
+        return similarity == Similarity::L2 ? Math::sqrt(std::max(T { 0 }, -key)) : key;
+    }
+
+    /*
+        Top k of the queries in rows [begin, end), written best first to out[(row - begin) * k].
+        Rows without k neighbours (size() < k) are padded with Neighbour::NONE.
+    */
+    void searchBlock(const T* queries, size_t begin, size_t end, size_t k, Similarity similarity, Neighbour<T>* out) const
+    {
+        const size_t dimension = getDimension();
+        const size_t query_count = end - begin;
+        const T* query_block = queries + begin * dimension;
+
+        thread_local std::vector<T> scores;
+        thread_local std::vector<Neighbour<T>> heaps;
+        scores.resize(QUERY_BLOCK * DATABASE_BLOCK);
+        heaps.assign(query_count * k, Neighbour<T> {});
+        size_t heap_sizes[QUERY_BLOCK] = {};
+        T query_squared_norms[QUERY_BLOCK];
+        T query_inverse_norms[QUERY_BLOCK];
+        for (size_t q = 0; q < query_count; ++q) {
+            const T* query = query_block + q * dimension;
+            query_squared_norms[q] = Kernel::dot(dimension, query, query);
+            query_inverse_norms[q] = query_squared_norms[q] > 0 ? 1 / Math::sqrt(query_squared_norms[q]) : T { 0 };
+        }
+
+        // Min-heap on the key, the root is the worst of the current k.
+        auto worse = [](const Neighbour<T>& a, const Neighbour<T>& b) { return a.score > b.score; };
+        for (size_t block = 0; block < size(); block += DATABASE_BLOCK) {
+            const size_t block_size = std::min(DATABASE_BLOCK, size() - block);
+            std::fill_n(scores.begin(), query_count * block_size, T {});
+            if (query_count == 1) {
+                Kernel::gemv<T>(block_size, dimension, { m_vectors[block], dimension, 1 }, query_block, scores.data());
+            } else {
+                Kernel::gemm<T>(query_count, block_size, dimension, { query_block, dimension, 1 }, { m_vectors[block], 1, dimension }, { scores.data(), block_size, 1 });
+            }
+
+            for (size_t q = 0; q < query_count; ++q) {
+                Neighbour<T>* heap = heaps.data() + q * k;
+                size_t& heap_size = heap_sizes[q];
+                const T* row = scores.data() + q * block_size;
+                for (size_t j = 0; j < block_size; ++j) {
+                    const size_t index = block + j;
+                    const T key = toKey(similarity, row[j], query_squared_norms[q], query_inverse_norms[q], m_squared_norms[index], m_inverse_norms[index]);
+                    if (heap_size < k) {
+                        heap[heap_size++] = { key, index };
+                        std::push_heap(heap, heap + heap_size, worse);
+                    } else if (key > heap[0].score) {
+                        std::pop_heap(heap, heap + k, worse);
+                        heap[k - 1] = { key, index };
+                        std::push_heap(heap, heap + k, worse);
+                    }
+                }
+            }
+        }
+
+        for (size_t q = 0; q < query_count; ++q) {
+            Neighbour<T>* heap = heaps.data() + q * k;
+            std::sort_heap(heap, heap + heap_sizes[q], worse);
+            for (size_t i = 0; i < k; ++i) {
+                out[q * k + i] = i < heap_sizes[q] ? Neighbour<T> { fromKey(similarity, heap[i].score), heap[i].index } : Neighbour<T> {};
+            }
+        }
+    }
+
+public:
+    SimilarityIndex() = default;
+    // Takes the vectors as the rows of a matrix.
+    explicit SimilarityIndex(DynMat<T>&& vectors)
+        : m_vectors(std::move(vectors))
+    {
+        computeNorms();
+    }
+    template <size_t N>
+    explicit SimilarityIndex(std::span<const Vec<N, T>> vectors)
+        : m_vectors(vectors.size(), N)
+    {
+        for (size_t i = 0; i < vectors.size(); ++i) {
+            std::ranges::copy(vectors[i], m_vectors[i]);
+        }
+        computeNorms();
+    }
+
+    size_t size() const
+    {
+        return m_vectors.rows();
+    }
+    size_t getDimension() const
+    {
+        return m_vectors.cols();
+    }
+    const DynMat<T>& getVectors() const
+    {
+        return m_vectors;
+    }
+    T getNorm(size_t index) const
+    {
+        return Math::sqrt(m_squared_norms[index]);
+    }
+
+    /*
+        Score of every query (row) against every vector, queries.rows() x size().
+    */
+    DynMat<T> getScores(const DynMat<T>& queries, Similarity similarity) const
+    {
+        assert(queries.cols() == getDimension());
+        DynMat<T> output(queries.rows(), size());
+        Kernel::gemm<T>(queries.rows(), size(), getDimension(), { queries.data(), getDimension(), 1 }, { m_vectors.data(), 1, getDimension() }, { output.data(), size(), 1 });
+        for (size_t q = 0; q < queries.rows(); ++q) {
+            const T query_squared_norm = Kernel::dot(getDimension(), queries[q], queries[q]);
+            const T query_inverse_norm = query_squared_norm > 0 ? 1 / Math::sqrt(query_squared_norm) : T { 0 };
+            for (size_t i = 0; i < size(); ++i) {
+                output[q][i] = fromKey(similarity, toKey(similarity, output[q][i], query_squared_norm, query_inverse_norm, m_squared_norms[i], m_inverse_norms[i]));
+            }
+        }
+        return output;
+    }
+
+    /*
+        The k best vectors for each query (row), result[q * k + i] is the i-th best for query q.
+        Padded with Neighbour::NONE when size() < k.
+    */
+    std::vector<Neighbour<T>> topK(const DynMat<T>& queries, size_t k, Similarity similarity) const
+    {
+        return topK(std::execution::seq, queries, k, similarity);
+    }
+
+    template <typename Policy>
+        requires std::is_execution_policy_v<std::remove_cvref_t<Policy>>
+    std::vector<Neighbour<T>> topK(Policy&&, const DynMat<T>& queries, size_t k, Similarity similarity) const
+    {
+        assert(queries.cols() == getDimension());
+        std::vector<Neighbour<T>> result(queries.rows() * k);
+        if (k == 0) {
+            return result;
+        }
+        const size_t blocks = (queries.rows() + QUERY_BLOCK - 1) / QUERY_BLOCK;
+        auto searchQueryBlock = [&](size_t block) {
+            const size_t begin = block * QUERY_BLOCK;
+            searchBlock(queries.data(), begin, std::min(begin + QUERY_BLOCK, queries.rows()), k, similarity, result.data() + begin * k);
+        };
+        if constexpr (Parallel::IS_PARALLEL_POLICY<Policy>) {
+            Parallel::ThreadPool::instance().parallelFor(blocks, searchQueryBlock);
+        } else {
+            for (size_t block = 0; block < blocks; ++block) {
+                searchQueryBlock(block);
+            }
+        }
+        return result;
+    }
+
+    template <size_t N>
+    std::vector<Neighbour<T>> topK(const Vec<N, T>& query, size_t k, Similarity similarity) const
+    {
+        assert(N == getDimension());
+        std::vector<Neighbour<T>> result(k);
+        if (k > 0) {
+            searchBlock(query.data, 0, 1, k, similarity, result.data());
+        }
+        return result;
+    }
+};
+
+/*
+    Storage order of a SparseMat. CSR compresses rows, CSC compresses columns.
+*/
+enum class SparseFormat {
+    CSR,
+    CSC
+};
+
+template <typename T = float>
+struct Triplet {
+    size_t row;
+    size_t col;
+    T value;
+};
+
+namespace Kernel {
+    // Parallel sparse products hand each task at least this many non-zeros.
+    constexpr size_t SPARSE_BLOCK = 1 << 14;
+    // Parallel CSC products with a dense right hand side split it into slices of this many columns.
+    constexpr size_t SPARSE_SLICE_COLS = 64;
+
+    /*
+        y[major] = row major of A * x for major in [begin, end), A in CSR form.
+        Two accumulators hide the latency of the dependent adds on long rows.
+    */
+    template <typename T, typename I>
+    void csrGemv(size_t begin, size_t end, const size_t* offsets, const I* indices, const T* values, const T* x, T* y)
+    {
+        for (size_t row = begin; row < end; ++row) {
+            T sum0 = {};
+            T sum1 = {};
+            size_t k = offsets[row];
+            const size_t last = offsets[row + 1];
+            for (; k + 2 <= last; k += 2) {
+                sum0 += values[k] * x[indices[k]];
+                sum1 += values[k + 1] * x[indices[k + 1]];
+            }
+            if (k < last) {
+                sum0 += values[k] * x[indices[k]];
+            }
+            y[row] = sum0 + sum1;
+        }
+    }
+
+    // y += columns [begin, end) of A * x[begin, end), A in CSC form.
+    template <typename T, typename I>
+    void cscGemv(size_t begin, size_t end, const size_t* offsets, const I* indices, const T* values, const T* x, T* y)
+    {
+        for (size_t col = begin; col < end; ++col) {
+            const T scale = x[col];
+            for (size_t k = offsets[col]; k < offsets[col + 1]; ++k) {
+                y[indices[k]] += values[k] * scale;
+            }
+        }
+    }
+
+    /*
+        Rows [begin, end) of C (m x n) += A * B (k x n), A in CSR form. Every non-zero adds a
+        scaled row of B to a row of C, so B and C are read and written contiguously.
+    */
+    template <typename T, typename I>
+    void csrGemm(size_t begin, size_t end, size_t n, const size_t* offsets, const I* indices, const T* values, Strided<const T> b, Strided<T> c)
+    {
+        for (size_t row = begin; row < end; ++row) {
+            for (size_t k = offsets[row]; k < offsets[row + 1]; ++k) {
+                axpy(n, values[k], &b.at(indices[k], 0), &c.at(row, 0));
+            }
+        }
+    }
+
+    // C (m x n) += columns [begin, end) of A * rows [begin, end) of B (k x n), A in CSC form.
+    template <typename T, typename I>
+    void cscGemm(size_t begin, size_t end, size_t n, const size_t* offsets, const I* indices, const T* values, Strided<const T> b, Strided<T> c)
+    {
+        for (size_t col = begin; col < end; ++col) {
+            for (size_t k = offsets[col]; k < offsets[col + 1]; ++k) {
+                axpy(n, values[k], &b.at(col, 0), &c.at(indices[k], 0));
+            }
+        }
+    }
+
+    /*
+        Splits the compressed dimension into ranges holding about the same number of non-zeros,
+        range i is [bounds[i], bounds[i + 1]). Returns at most parts ranges of at least SPARSE_BLOCK
+        non-zeros each (a single range for small matrices).
+    */
+    inline std::vector<size_t> balancedPartition(std::span<const size_t> offsets, size_t parts)
+    {
+        const size_t major = offsets.size() - 1;
+        const size_t non_zeros = offsets.back();
+        parts = std::clamp<size_t>(non_zeros / SPARSE_BLOCK, 1, std::max<size_t>(parts, 1));
+        std::vector<size_t> bounds(parts + 1, major);
+        bounds[0] = 0;
+        for (size_t i = 1; i < parts; ++i) {
+            const auto it = std::lower_bound(offsets.begin(), offsets.end(), non_zeros * i / parts);
+            bounds[i] = std::max(bounds[i - 1], static_cast<size_t>(it - offsets.begin()));
+        }
+        return bounds;
+    }
+}
+
+/*
+    Compressed sparse matrix. In CSR form the non-zeros of row r are
+    getValues()[getOffsets()[r], getOffsets()[r + 1]) and getIndices() holds their columns in
+    ascending order. CSC stores the columns the same way. Move-only, use clone() for an explicit
+    copy.
+*/
+template <typename T = float>
+class SparseMat {
+public:
+    using Index = uint32_t;
+
+private:
+    SparseFormat m_format = SparseFormat::CSR;
+    size_t m_rows = 0;
+    size_t m_cols = 0;
+    std::vector<size_t> m_offsets { 0 };
+    std::vector<Index> m_indices;
+    std::vector<T> m_values;
+
+    size_t majorSize() const
+    {
+        return m_format == SparseFormat::CSR ? m_rows : m_cols;
+    }
+
+    // Compresses a dense block read through at(row, col), walking it in storage order keeps the indices sorted.
+    template <typename Dense>
+    void compressDense(const Dense& dense, T drop_threshold)
+    {
+        const bool csr = m_format == SparseFormat::CSR;
+        const size_t minor_size = csr ? m_cols : m_rows;
+        m_offsets.assign(majorSize() + 1, 0);
+        for (size_t major = 0; major < majorSize(); ++major) {
+            for (size_t minor = 0; minor < minor_size; ++minor) {
+                const T value = csr ? dense.at(major, minor) : dense.at(minor, major);
+                if ((value < 0 ? -value : value) > drop_threshold) {
+                    m_indices.push_back(static_cast<Index>(minor));
+                    m_values.push_back(value);
+                }
+            }
+            m_offsets[major + 1] = m_indices.size();
+        }
+    }
+
+public:
+    SparseMat() = default;
+    // All zero rows x cols matrix.
+    SparseMat(size_t rows, size_t cols, SparseFormat format = SparseFormat::CSR)
+        : m_format(format)
+        , m_rows(rows)
+        , m_cols(cols)
+        , m_offsets(majorSize() + 1, 0)
+    {
+        assert(rows <= std::numeric_limits<Index>::max() && cols <= std::numeric_limits<Index>::max());
+    }
+    /*
+        From (row, col, value) triplets in any order, duplicates are summed.
+        Bucketed on the compressed dimension with a counting sort, then each bucket is sorted.
+    */
+    SparseMat(size_t rows, size_t cols, std::span<const Triplet<T>> triplets, SparseFormat format = SparseFormat::CSR)
+        : SparseMat(rows, cols, format)
+    {
+        const bool csr = m_format == SparseFormat::CSR;
+        std::vector<size_t> starts(majorSize() + 1, 0);
+        for (const Triplet<T>& triplet : triplets) {
+            assert(triplet.row < rows && triplet.col < cols);
+            ++starts[(csr ? triplet.row : triplet.col) + 1];
+        }
+        std::partial_sum(starts.begin(), starts.end(), starts.begin());
+
+        std::vector<std::pair<Index, T>> entries(triplets.size());
+        std::vector<size_t> next(starts.begin(), starts.end() - 1);
+        for (const Triplet<T>& triplet : triplets) {
+            const size_t major = csr ? triplet.row : triplet.col;
+            entries[next[major]++] = { static_cast<Index>(csr ? triplet.col : triplet.row), triplet.value };
+        }
+
+        m_indices.reserve(entries.size());
+        m_values.reserve(entries.size());
+        for (size_t major = 0; major < majorSize(); ++major) {
+            const auto first = entries.begin() + static_cast<std::ptrdiff_t>(starts[major]);
+            const auto last = entries.begin() + static_cast<std::ptrdiff_t>(starts[major + 1]);
+            std::sort(first, last, [](const auto& a, const auto& b) { return a.first < b.first; });
+            for (auto it = first; it != last; ++it) {
+                if (m_indices.size() > m_offsets[major] && m_indices.back() == it->first) {
+                    m_values.back() += it->second;
+                } else {
+                    m_indices.push_back(it->first);
+                    m_values.push_back(it->second);
+                }
+            }
+            m_offsets[major + 1] = m_indices.size();
+        }
+    }
+    // Keeps the entries of mat with |value| > drop_threshold, mat may have any layout.
+    template <size_t R, size_t C, typename Layout>
+    explicit SparseMat(const Mat<R, C, T, Layout>& mat, T drop_threshold = 0, SparseFormat format = SparseFormat::CSR)
+        : SparseMat(R, C, format)
+    {
+        compressDense(mat, drop_threshold);
+    }
+    explicit SparseMat(const DynMat<T>& mat, T drop_threshold = 0, SparseFormat format = SparseFormat::CSR)
+        : SparseMat(mat.rows(), mat.cols(), format)
+    {
+        compressDense(Kernel::Strided<const T> { mat.data(), mat.cols(), 1 }, drop_threshold);
+    }
+
+    // A moved-from SparseMat is an empty 0 x 0 matrix.
+    SparseMat(SparseMat&& other) noexcept
+        : m_format(other.m_format)
+        , m_rows(std::exchange(other.m_rows, 0))
+        , m_cols(std::exchange(other.m_cols, 0))
+        , m_offsets(std::exchange(other.m_offsets, { 0 }))
+        , m_indices(std::move(other.m_indices))
+        , m_values(std::move(other.m_values))
+    {
+    }
+    SparseMat& operator=(SparseMat&& other) noexcept
+    {
+        m_format = other.m_format;
+        m_rows = std::exchange(other.m_rows, 0);
+        m_cols = std::exchange(other.m_cols, 0);
+        m_offsets = std::exchange(other.m_offsets, { 0 });
+        m_indices = std::move(other.m_indices);
+        m_values = std::move(other.m_values);
+        return *this;
+    }
+    SparseMat(const SparseMat&) = delete;
+    SparseMat& operator=(const SparseMat&) = delete;
+
+    SparseMat clone() const
+    {
+        SparseMat copy(m_rows, m_cols, m_format);
+        copy.m_offsets = m_offsets;
+        copy.m_indices = m_indices;
+        copy.m_values = m_values;
+        return copy;
+    }
+
+    /*
+        The same matrix in the given format. Converting between CSR and CSC is a counting sort
+        on the indices, which visits the old compressed dimension in order and so keeps the new
+        indices sorted.
+    */
+    SparseMat convert(SparseFormat format) const
+    {
+        if (format == m_format) {
+            return clone();
+        }
+        SparseMat converted(m_rows, m_cols, format);
+        const size_t minor_size = converted.majorSize();
+        for (Index index : m_indices) {
+            ++converted.m_offsets[index + 1];
+        }
+        std::partial_sum(converted.m_offsets.begin(), converted.m_offsets.end(), converted.m_offsets.begin());
+
+        converted.m_indices.resize(nonZeros());
+        converted.m_values.resize(nonZeros());
+        std::vector<size_t> next(converted.m_offsets.begin(), converted.m_offsets.begin() + static_cast<std::ptrdiff_t>(minor_size));
+        for (size_t major = 0; major < majorSize(); ++major) {
+            for (size_t k = m_offsets[major]; k < m_offsets[major + 1]; ++k) {
+                const size_t position = next[m_indices[k]]++;
+                converted.m_indices[position] = static_cast<Index>(major);
+                converted.m_values[position] = m_values[k];
+            }
+        }
+        return converted;
+    }
+
+    DynMat<T> toDense() const
+    {
+        DynMat<T> dense(m_rows, m_cols);
+        for (size_t major = 0; major < majorSize(); ++major) {
+            for (size_t k = m_offsets[major]; k < m_offsets[major + 1]; ++k) {
+                (m_format == SparseFormat::CSR ? dense[major][m_indices[k]] : dense[m_indices[k]][major]) = m_values[k];
+            }
+        }
+        return dense;
+    }
+
+    SparseFormat getFormat() const
+    {
+        return m_format;
+    }
+    size_t rows() const
+    {
+        return m_rows;
+    }
+    size_t cols() const
+    {
+        return m_cols;
+    }
+    size_t nonZeros() const
+    {
+        return m_values.size();
+    }
+    std::span<const size_t> getOffsets() const
+    {
+        return m_offsets;
+    }
+    std::span<const Index> getIndices() const
+    {
+        return m_indices;
+    }
+    std::span<const T> getValues() const
+    {
+        return m_values;
+    }
+    // The stored values can be updated in place, the sparsity pattern cannot.
+    std::span<T> getValues()
+    {
+        return m_values;
+    }
+
+    // Element (row, col), zero when it is not stored. Binary search within the row (CSR) or column (CSC).
+    T at(size_t row, size_t col) const
+    {
+        assert(row < m_rows && col < m_cols);
+        const size_t major = m_format == SparseFormat::CSR ? row : col;
+        const Index minor = static_cast<Index>(m_format == SparseFormat::CSR ? col : row);
+        const auto first = m_indices.begin() + static_cast<std::ptrdiff_t>(m_offsets[major]);
+        const auto last = m_indices.begin() + static_cast<std::ptrdiff_t>(m_offsets[major + 1]);
+        const auto it = std::lower_bound(first, last, minor);
+        return (it != last && *it == minor) ? m_values[static_cast<size_t>(it - m_indices.begin())] : T {};
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const SparseMat<T>& mat)
+    {
+        const bool csr = mat.m_format == SparseFormat::CSR;
+        os << (csr ? "CSR" : "CSC") << '<' << mat.m_rows << 'x' << mat.m_cols << ">{ ";
+        for (size_t major = 0; major < mat.majorSize(); ++major) {
+            for (size_t k = mat.m_offsets[major]; k < mat.m_offsets[major + 1]; ++k) {
+                os << '(' << (csr ? major : mat.m_indices[k]) << ", " << (csr ? mat.m_indices[k] : major) << ") " << mat.m_values[k] << ' ';
+            }
+        }
+        os << '}';
+        return os;
+    }
+};
+
+/*
+    Sparse matrix vector product with an explicit execution policy. Parallel policies split CSR
+    rows into ranges of about equal non-zeros. CSC columns are split the same way, each range
+    scatters into its own partial vector and the partials are summed.
+*/
+template <typename Policy, typename T>
+    requires std::is_execution_policy_v<std::remove_cvref_t<Policy>>
+DynVec<T> dotProduct(Policy&&, const SparseMat<T>& mat, const DynVec<T>& vec)
+{
+    assert(mat.cols() == vec.size());
+    DynVec<T> output(mat.rows());
+    const size_t* offsets = mat.getOffsets().data();
+    const auto* indices = mat.getIndices().data();
+    const T* values = mat.getValues().data();
+    const size_t major = mat.getOffsets().size() - 1;
+
+    if (mat.getFormat() == SparseFormat::CSR) {
+        if constexpr (Parallel::IS_PARALLEL_POLICY<Policy>) {
+            auto& pool = Parallel::ThreadPool::instance();
+            const std::vector<size_t> bounds = Kernel::balancedPartition(mat.getOffsets(), pool.size() * 4);
+            pool.parallelFor(bounds.size() - 1, [&](size_t part) {
+                Kernel::csrGemv(bounds[part], bounds[part + 1], offsets, indices, values, vec.data(), output.data());
+            });
+        } else {
+            Kernel::csrGemv(0, major, offsets, indices, values, vec.data(), output.data());
+        }
+    } else {
+        if constexpr (Parallel::IS_PARALLEL_POLICY<Policy>) {
+            auto& pool = Parallel::ThreadPool::instance();
+            const std::vector<size_t> bounds = Kernel::balancedPartition(mat.getOffsets(), pool.size());
+            const size_t parts = bounds.size() - 1;
+            std::vector<T> partials((parts - 1) * mat.rows(), T {});
+            pool.parallelFor(parts, [&](size_t part) {
+                T* partial = part == 0 ? output.data() : partials.data() + (part - 1) * mat.rows();
+                Kernel::cscGemv(bounds[part], bounds[part + 1], offsets, indices, values, vec.data(), partial);
+            });
+            for (size_t part = 1; part < parts; ++part) {
+                Kernel::axpy(mat.rows(), T { 1 }, partials.data() + (part - 1) * mat.rows(), output.data());
+            }
+        } else {
+            Kernel::cscGemv(0, major, offsets, indices, values, vec.data(), output.data());
+        }
+    }
+    return output;
+}
+
+template <typename T>
+DynVec<T> dotProduct(const SparseMat<T>& mat, const DynVec<T>& vec)
+{
+    return dotProduct(std::execution::seq, mat, vec);
+}
+
+/*
+    Sparse times dense matrix product with an explicit execution policy. Parallel policies split
+    CSR rows into ranges of about equal non-zeros and CSC products into slices of
+    Kernel::SPARSE_SLICE_COLS columns of b.
+*/
+template <typename Policy, typename T>
+    requires std::is_execution_policy_v<std::remove_cvref_t<Policy>>
+DynMat<T> multiply(Policy&&, const SparseMat<T>& a, const DynMat<T>& b)
+{
+    assert(a.cols() == b.rows());
+    DynMat<T> c(a.rows(), b.cols());
+    const size_t* offsets = a.getOffsets().data();
+    const auto* indices = a.getIndices().data();
+    const T* values = a.getValues().data();
+    const size_t major = a.getOffsets().size() - 1;
+    const size_t n = b.cols();
+
+    if (a.getFormat() == SparseFormat::CSR) {
+        if constexpr (Parallel::IS_PARALLEL_POLICY<Policy>) {
+            auto& pool = Parallel::ThreadPool::instance();
+            const std::vector<size_t> bounds = Kernel::balancedPartition(a.getOffsets(), pool.size() * 4);
+            pool.parallelFor(bounds.size() - 1, [&](size_t part) {
+                Kernel::csrGemm<T>(bounds[part], bounds[part + 1], n, offsets, indices, values, { b.data(), n, 1 }, { c.data(), n, 1 });
+            });
+        } else {
+            Kernel::csrGemm<T>(0, major, n, offsets, indices, values, { b.data(), n, 1 }, { c.data(), n, 1 });
+        }
+    } else {
+        if constexpr (Parallel::IS_PARALLEL_POLICY<Policy>) {
+            constexpr size_t SLICE = Kernel::SPARSE_SLICE_COLS;
+            Parallel::ThreadPool::instance().parallelFor((n + SLICE - 1) / SLICE, [&](size_t slice) {
+                const size_t col = slice * SLICE;
+                Kernel::cscGemm<T>(0, major, std::min(SLICE, n - col), offsets, indices, values, { b.data() + col, n, 1 }, { c.data() + col, n, 1 });
+            });
+        } else {
+            Kernel::cscGemm<T>(0, major, n, offsets, indices, values, { b.data(), n, 1 }, { c.data(), n, 1 });
+        }
+    }
+    return c;
+}
+
+template <typename T>
+DynMat<T> operator*(const SparseMat<T>& a, const DynMat<T>& b)
+{
+    return multiply(std::execution::seq, a, b);
+}
+
+/*
+    Scale and zero point granularity of a QuantisedMat.
+*/
+enum class Quantisation {
+    PerTensor,
+    PerRow
+};
+
+namespace Kernel {
+#ifdef MATH_SIMD_AVX2
+    /*
+        acc += a * b summed over groups of four bytes into each 32 bit lane, a unsigned and b signed.
+        VNNI does this in one instruction, AVX2 multiplies into saturating 16 bit pairs first, which
+        cannot saturate for |a| <= 128 and |b| <= 127.
+    */
+    inline __m256i mulAddInt8(__m256i acc, __m256i a, __m256i b)
+    {
+#if defined(__AVXVNNI__)
+        return _mm256_dpbusd_avx_epi32(acc, a, b);
+#elif defined(MATH_SIMD_VNNI)
+        return _mm256_dpbusd_epi32(acc, a, b);
+#else
+        return _mm256_add_epi32(acc, _mm256_madd_epi16(_mm256_maddubs_epi16(a, b), _mm256_set1_epi16(1)));
+#endif
+    }
+
+    inline int32_t reduceAddInt32(__m256i x)
+    {
+        __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(x), _mm256_extracti128_si256(x, 1));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+        return _mm_cvtsi128_si32(sum);
+    }
+#endif
+
+    /*
+        out[r] = dot(a + r * a_stride, b) over n signed bytes for the four rows r of a, accumulated
+        in 32 bits. b is loaded once for all four. The unsigned x signed multiply takes |a| and b
+        with the sign of a, so a may hold -128 but b must stay within [-127, 127].
+    */
+    inline void dotInt8x4(size_t n, const int8_t* a, size_t a_stride, const int8_t* b, int32_t* out)
+    {
+        size_t i = 0;
+#ifdef MATH_SIMD_AVX2
+        __m256i acc[4] = { _mm256_setzero_si256(), _mm256_setzero_si256(), _mm256_setzero_si256(), _mm256_setzero_si256() };
+        for (; i + 32 <= n; i += 32) {
+            const __m256i bv = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+            for (size_t r = 0; r < 4; ++r) {
+                const __m256i av = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + r * a_stride + i));
+                acc[r] = mulAddInt8(acc[r], _mm256_sign_epi8(av, av), _mm256_sign_epi8(bv, av));
+            }
+        }
+        for (size_t r = 0; r < 4; ++r) {
+            out[r] = reduceAddInt32(acc[r]);
+        }
+#else
+        std::fill_n(out, 4, 0);
+#endif
+        for (size_t r = 0; r < 4; ++r) {
+            const int8_t* row = a + r * a_stride;
+            int32_t sum = 0;
+            for (size_t j = i; j < n; ++j) {
+                sum += static_cast<int32_t>(row[j]) * static_cast<int32_t>(b[j]);
+            }
+            out[r] += sum;
+        }
+    }
+
+    inline int32_t dotInt8(size_t n, const int8_t* a, const int8_t* b)
+    {
+        size_t i = 0;
+        int32_t sum = 0;
+#ifdef MATH_SIMD_AVX2
+        __m256i acc = _mm256_setzero_si256();
+        for (; i + 32 <= n; i += 32) {
+            const __m256i av = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+            const __m256i bv = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+            acc = mulAddInt8(acc, _mm256_sign_epi8(av, av), _mm256_sign_epi8(bv, av));
+        }
+        sum = reduceAddInt32(acc);
+#endif
+        for (; i < n; ++i) {
+            sum += static_cast<int32_t>(a[i]) * static_cast<int32_t>(b[i]);
+        }
+        return sum;
+    }
+
+    /*
+        Symmetric quantisation of n values with a given stride to [-127, 127]. Returns the scale,
+        value ~= scale * q, and the sum of the quantised values.
+    */
+    template <typename T>
+    T quantiseSymmetric(size_t n, const T* values, size_t stride, int8_t* out, int32_t& sum)
+    {
+        T max_abs = 0;
+        for (size_t i = 0; i < n; ++i) {
+            max_abs = std::max(max_abs, values[i * stride] < 0 ? -values[i * stride] : values[i * stride]);
+        }
+        const T scale = max_abs > 0 ? max_abs / 127 : T { 1 };
+        const T inverse_scale = 1 / scale;
+        sum = 0;
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = static_cast<int8_t>(std::clamp(std::lround(values[i * stride] * inverse_scale), -127l, 127l));
+            sum += out[i];
+        }
+        return scale;
+    }
+
+    /*
+        Asymmetric quantisation of n values to [-128, 127], value ~= scale * (q - zero_point).
+        The range always includes zero so that zero is exact.
+    */
+    template <typename T>
+    void quantiseAffine(size_t n, const T* values, int8_t* out, T& scale, int32_t& zero_point)
+    {
+        T low = 0;
+        T high = 0;
+        for (size_t i = 0; i < n; ++i) {
+            low = std::min(low, values[i]);
+            high = std::max(high, values[i]);
+        }
+        scale = high > low ? (high - low) / 255 : T { 1 };
+        zero_point = static_cast<int32_t>(std::clamp(std::lround(-128 - low / scale), -128l, 127l));
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = static_cast<int8_t>(std::clamp(std::lround(values[i] / scale) + zero_point, -128l, 127l));
+        }
+    }
+}
+
+/*
+    Matrix of signed 8 bit values, element (r, c) ~= scale(r) * (q(r, c) - zeroPoint(r)). PerRow
+    keeps a scale and zero point for every row, PerTensor one for the whole matrix.
+    Products quantise their float operand symmetrically per vector (per column of a matrix),
+    accumulate int8 x int8 products in int32 and rescale once per output. Move-only, use clone()
+    for an explicit copy.
+*/
+template <std::floating_point T = float>
+class QuantisedMat {
+private:
+    AlignedBuffer<int8_t> m_values;
+    std::vector<T> m_scales;
+    std::vector<int32_t> m_zero_points;
+    size_t m_rows = 0;
+    size_t m_cols = 0;
+    Quantisation m_quantisation = Quantisation::PerRow;
+
+    void quantise(const T* values)
+    {
+        if (m_quantisation == Quantisation::PerRow) {
+            m_scales.resize(m_rows);
+            m_zero_points.resize(m_rows);
+            for (size_t row = 0; row < m_rows; ++row) {
+                Kernel::quantiseAffine(m_cols, values + row * m_cols, (*this)[row], m_scales[row], m_zero_points[row]);
+            }
+        } else {
+            m_scales.resize(1);
+            m_zero_points.resize(1);
+            Kernel::quantiseAffine(m_rows * m_cols, values, data(), m_scales[0], m_zero_points[0]);
+        }
+    }
+
+public:
+    QuantisedMat() = default;
+    // Any layout, the quantised values are stored row-major.
+    template <size_t R, size_t C, typename Layout>
+    explicit QuantisedMat(const Mat<R, C, T, Layout>& mat, Quantisation quantisation = Quantisation::PerRow)
+        : m_values(R * C)
+        , m_rows(R)
+        , m_cols(C)
+        , m_quantisation(quantisation)
+    {
+        if constexpr (std::is_same_v<Layout, RowMajor>) {
+            quantise(mat.data);
+        } else {
+            quantise(std::make_unique<Mat<R, C, T>>(mat)->data);
+        }
+    }
+    explicit QuantisedMat(const DynMat<T>& mat, Quantisation quantisation = Quantisation::PerRow)
+        : m_values(mat.size())
+        , m_rows(mat.rows())
+        , m_cols(mat.cols())
+        , m_quantisation(quantisation)
+    {
+        quantise(mat.data());
+    }
+
+    QuantisedMat(QuantisedMat&& other) noexcept
+        : m_values(std::move(other.m_values))
+        , m_scales(std::move(other.m_scales))
+        , m_zero_points(std::move(other.m_zero_points))
+        , m_rows(std::exchange(other.m_rows, 0))
+        , m_cols(std::exchange(other.m_cols, 0))
+        , m_quantisation(other.m_quantisation)
+    {
+    }
+    QuantisedMat& operator=(QuantisedMat&& other) noexcept
+    {
+        m_values = std::move(other.m_values);
+        m_scales = std::move(other.m_scales);
+        m_zero_points = std::move(other.m_zero_points);
+        m_rows = std::exchange(other.m_rows, 0);
+        m_cols = std::exchange(other.m_cols, 0);
+        m_quantisation = other.m_quantisation;
+        return *this;
+    }
+
+    QuantisedMat clone() const
+    {
+        QuantisedMat copy;
+        copy.m_values = AlignedBuffer<int8_t>(size());
+        std::copy(data(), data() + size(), copy.data());
+        copy.m_scales = m_scales;
+        copy.m_zero_points = m_zero_points;
+        copy.m_rows = m_rows;
+        copy.m_cols = m_cols;
+        copy.m_quantisation = m_quantisation;
+        return copy;
+    }
+
+    DynMat<T> dequantise() const
+    {
+        DynMat<T> mat(m_rows, m_cols);
+        for (size_t row = 0; row < m_rows; ++row) {
+            const T scale = getScale(row);
+            const int32_t zero_point = getZeroPoint(row);
+            std::transform((*this)[row], (*this)[row] + m_cols, mat[row], [&](int8_t q) { return scale * static_cast<T>(q - zero_point); });
+        }
+        return mat;
+    }
+    template <size_t R, size_t C>
+    explicit operator Mat<R, C, T>() const
+    {
+        return static_cast<Mat<R, C, T>>(dequantise());
+    }
+
+    int8_t* data()
+    {
+        return m_values.data();
+    }
+    const int8_t* data() const
+    {
+        return m_values.data();
+    }
+    size_t rows() const
+    {
+        return m_rows;
+    }
+    size_t cols() const
+    {
+        return m_cols;
+    }
+    size_t size() const
+    {
+        return m_values.size();
+    }
+    Quantisation getQuantisation() const
+    {
+        return m_quantisation;
+    }
+    T getScale(size_t row) const
+    {
+        return m_scales[m_quantisation == Quantisation::PerRow ? row : 0];
+    }
+    int32_t getZeroPoint(size_t row) const
+    {
+        return m_zero_points[m_quantisation == Quantisation::PerRow ? row : 0];
+    }
+    int8_t* operator[](size_t row)
+    {
+        assert(row < m_rows);
+        return data() + row * m_cols;
+    }
+    const int8_t* operator[](size_t row) const
+    {
+        assert(row < m_rows);
+        return data() + row * m_cols;
+    }
+};
+
+namespace Kernel {
+    /*
+        Rows [begin, end) of C (m x n) = A * B for a quantised A (m x k) and B given as its
+        quantised columns, b_t (n x k) with per column scales and sums. Columns are taken
+        QUANTISED_BLOCK_COLS at a time so their block of b_t stays in cache across the rows of A.
+    */
+    constexpr size_t QUANTISED_BLOCK_COLS = 64;
+
+    template <typename T>
+    void quantisedGemm(const QuantisedMat<T>& a, size_t begin, size_t end, size_t n, const int8_t* b_t, const T* b_scales, const int32_t* b_sums, Strided<T> c)
+    {
+        const size_t k = a.cols();
+        int32_t acc[4];
+        for (size_t block = 0; block < n; block += QUANTISED_BLOCK_COLS) {
+            const size_t block_end = std::min(n, block + QUANTISED_BLOCK_COLS);
+            size_t row = begin;
+            for (; row + 4 <= end; row += 4) {
+                for (size_t col = block; col < block_end; ++col) {
+                    dotInt8x4(k, a[row], k, b_t + col * k, acc);
+                    for (size_t r = 0; r < 4; ++r) {
+                        c.at(row + r, col) = a.getScale(row + r) * b_scales[col] * static_cast<T>(acc[r] - a.getZeroPoint(row + r) * b_sums[col]);
+                    }
+                }
+            }
+            for (; row < end; ++row) {
+                for (size_t col = block; col < block_end; ++col) {
+                    const int32_t dot = dotInt8(k, a[row], b_t + col * k);
+                    c.at(row, col) = a.getScale(row) * b_scales[col] * static_cast<T>(dot - a.getZeroPoint(row) * b_sums[col]);
+                }
+            }
+        }
+    }
 }
 
 /*
-Generate the rotation Matrix with the inputs of yaw, pitch, and roll.
-(Input units are in radians).
+    Quantised matrix vector product. vec is quantised to int8 with one scale, then every output
+    is scale(r) * vec_scale * (sum(q * vec_q) - zeroPoint(r) * sum(vec_q)).
 */
 template <typename T>
-constexpr Mat<3, 3, T> getRotationMat3x3(Radians x_rotation_radians, Radians y_rotation_radians, Radians z_rotation_radians)
+DynVec<T> dotProduct(const QuantisedMat<T>& mat, std::span<const T> vec)
 {
-    const T x = static_cast<T>(x_rotation_radians.angle);
-    const T y = static_cast<T>(y_rotation_radians.angle);
-    const T z = static_cast<T>(z_rotation_radians.angle);
+    assert(mat.cols() == vec.size());
+    std::vector<int8_t> quantised(vec.size());
+    int32_t sum = 0;
+    const T scale = Kernel::quantiseSymmetric(vec.size(), vec.data(), 1, quantised.data(), sum);
+    DynVec<T> output(mat.rows());
+    Kernel::quantisedGemm<T>(mat, 0, mat.rows(), 1, quantised.data(), &scale, &sum, { output.data(), 1, 0 });
+    return output;
+}
 
-    namespace LA = Math::LinearAlgebra;
+template <typename T>
+DynVec<T> dotProduct(const QuantisedMat<T>& mat, const DynVec<T>& vec)
+{
+    return dotProduct(mat, std::span<const T>(vec.data(), vec.size()));
+}
 
-    Mat<3, 3, T> x_rot_mat(
-        { { 1, 0, 0 },
-            { 0, Math::cos(x), -Math::sin(x) },
-            { 0, Math::sin(x), Math::cos(x) } });
+template <size_t N, typename T>
+DynVec<T> dotProduct(const QuantisedMat<T>& mat, const Vec<N, T>& vec)
+{
+    return dotProduct(mat, std::span<const T>(vec.data, N));
+}
 
-    Mat<3, 3, T> y_rot_mat(
-        { { Math::cos(y), 0, Math::sin(y) },
-            { 0, 1, 0 },
-            { -Math::sin(y), 0, Math::cos(y) } });
+/*
+    Quantised matrix product with an explicit execution policy. Every column of b is quantised
+    with its own scale into a transposed int8 copy, parallel policies split the rows of a into
+    blocks.
+*/
+template <typename Policy, typename T>
+    requires std::is_execution_policy_v<std::remove_cvref_t<Policy>>
+DynMat<T> multiply(Policy&&, const QuantisedMat<T>& a, const DynMat<T>& b)
+{
+    assert(a.cols() == b.rows());
+    const size_t k = b.rows();
+    const size_t n = b.cols();
+    std::vector<int8_t> b_t(n * k);
+    std::vector<T> b_scales(n);
+    std::vector<int32_t> b_sums(n);
+    for (size_t col = 0; col < n; ++col) {
+        b_scales[col] = Kernel::quantiseSymmetric(k, b.data() + col, n, b_t.data() + col * k, b_sums[col]);
+    }
 
-    Mat<3, 3, T> z_rot_mat(
-        { { Math::cos(z), -Math::sin(z), 0 },
-            { Math::sin(z), Math::cos(z), 0 },
-            { 0, 0, 1 } });
+    DynMat<T> c(a.rows(), n);
+    auto rowBlock = [&](size_t begin, size_t end) {
+        Kernel::quantisedGemm<T>(a, begin, end, n, b_t.data(), b_scales.data(), b_sums.data(), { c.data(), n, 1 });
+    };
+    if constexpr (Parallel::IS_PARALLEL_POLICY<Policy>) {
+        constexpr size_t BLOCK_ROWS = 64;
+        Parallel::ThreadPool::instance().parallelFor((a.rows() + BLOCK_ROWS - 1) / BLOCK_ROWS, [&](size_t block) {
+            rowBlock(block * BLOCK_ROWS, std::min(a.rows(), (block + 1) * BLOCK_ROWS));
+        });
+    } else {
+        rowBlock(0, a.rows());
+    }
+    return c;
+}
 
-    return x_rot_mat * y_rot_mat * z_rot_mat;
+template <typename T>
+DynMat<T> operator*(const QuantisedMat<T>& a, const DynMat<T>& b)
+{
+    return multiply(std::execution::seq, a, b);
 }
 
 template <typename T = float>
@@ -973,22 +7586,75 @@ public:
     }
 };
 
-template <typename T>
+template <typename T = float>
 class Triangle3D {
+public:
     Pos<3, T> corners[3];
     constexpr Triangle3D(const Pos<3, T>& a, const Pos<3, T>& b, const Pos<3, T>& c)
-        : corners({ a, b, c })
+        : corners { a, b, c }
+    {
+    }
+};
+
+/*
+    Triangle stored as one corner and two edges (plus the unnormalised normal),
+    the form the intersection tests work on. Bake once for repeated queries.
+*/
+template <typename T = float>
+class BakedTriangle3D {
+public:
+    Pos<3, T> corner;
+    Vec<3, T> edge1;
+    Vec<3, T> edge2;
+    Vec<3, T> normal;
+    constexpr explicit BakedTriangle3D(const Triangle3D<T>& triangle)
+        : corner(triangle.corners[0])
+        , edge1(static_cast<Vec<3, T>>(triangle.corners[1]) - static_cast<Vec<3, T>>(triangle.corners[0]))
+        , edge2(static_cast<Vec<3, T>>(triangle.corners[2]) - static_cast<Vec<3, T>>(triangle.corners[0]))
+        , normal(crossProduct(edge1, edge2))
+    {
+    }
+};
+
+/*
+    Structure of arrays batch of baked triangles.
+*/
+template <typename T = float>
+struct TrianglePacket3D {
+    std::span<const T> corner_x;
+    std::span<const T> corner_y;
+    std::span<const T> corner_z;
+    std::span<const T> edge1_x;
+    std::span<const T> edge1_y;
+    std::span<const T> edge1_z;
+    std::span<const T> edge2_x;
+    std::span<const T> edge2_y;
+    std::span<const T> edge2_z;
+
+    size_t size() const
     {
+        return corner_x.size();
     }
 };
 
+/*
+    Distance along the ray and barycentric coordinates of a triangle hit,
+    the point is corners[0] * (1 - u - v) + corners[1] * u + corners[2] * v. A miss has distance 0.
+*/
+template <typename T = float>
+struct TriangleHit {
+    T distance = 0;
+    T u = 0;
+    T v = 0;
+};
+
 /*
     Returns the distance for the closet intersection IN FRONT OF ray.
 */
 template <typename T>
 constexpr T intersectionDist(const Ray<3, T>& ray, const Sphere3D<T>& sphere)
 {
-    const auto displacement = static_cast<Vec<3, T>>(ray.getOrigin()) - static_cast<Vec<3, T>>(sphere.center);
+    const Vec<3, T> displacement = static_cast<Vec<3, T>>(ray.getOrigin()) - static_cast<Vec<3, T>>(sphere.center);
     const T A = dotProduct(ray.getDirection(), ray.getDirection());
     const T B = T { 2 } * dotProduct(displacement, ray.getDirection());
     const T C = dotProduct(displacement, displacement) - (sphere.radius * sphere.radius);
@@ -1011,6 +7677,329 @@ constexpr T intersectionDist(const Ray<3, T>& ray, const Sphere3D<T>& sphere)
     return t;
 }
 
+/*
+    Structure of arrays batch of 3D rays, ray n starts at (origin_x[n], origin_y[n], origin_z[n]).
+    Directions do not need to be normalised.
+*/
+template <typename T = float>
+struct RayPacket3D {
+    std::span<const T> origin_x;
+    std::span<const T> origin_y;
+    std::span<const T> origin_z;
+    std::span<const T> direction_x;
+    std::span<const T> direction_y;
+    std::span<const T> direction_z;
+
+    size_t size() const
+    {
+        return origin_x.size();
+    }
+};
+
+/*
+    Structure of arrays batch of spheres.
+*/
+template <typename T = float>
+struct SpherePacket3D {
+    std::span<const T> center_x;
+    std::span<const T> center_y;
+    std::span<const T> center_z;
+    std::span<const T> radius;
+
+    size_t size() const
+    {
+        return center_x.size();
+    }
+};
+
+/*
+    Closest intersection found by a batched query, a miss has distance 0 and index NONE.
+*/
+template <typename T = float>
+struct Hit {
+    static constexpr size_t NONE = std::numeric_limits<size_t>::max();
+    T distance = 0;
+    size_t index = NONE;
+};
+
+namespace Kernel {
+    /*
+        Lane wise intersectionDist(Ray, Sphere3D), the root selection is branch free.
+    */
+    template <typename P>
+    P raySphereDist(const P (&origin)[3], const P (&direction)[3], const P (&center)[3], const P& radius)
+    {
+        const P t_min = P::broadcast(0.0001f);
+        const P zero = P::zero();
+        const P lx = origin[0] - center[0];
+        const P ly = origin[1] - center[1];
+        const P lz = origin[2] - center[2];
+        const P a = mulAdd(direction[0], direction[0], mulAdd(direction[1], direction[1], direction[2] * direction[2]));
+        const P half_b = mulAdd(lx, direction[0], mulAdd(ly, direction[1], lz * direction[2]));
+        const P c = mulAdd(lx, lx, mulAdd(ly, ly, lz * lz)) - radius * radius;
+        const P d = half_b * half_b - a * c;
+        const P root = sqrt(max(d, zero));
+        const P near_t = (zero - half_b - root) / a;
+        const P far_t = (zero - half_b + root) / a;
+        const P t = select(near_t > t_min, near_t, select(far_t > t_min, far_t, zero));
+        return select(d > zero, t, zero);
+    }
+
+    // Mask of the first n lanes, keeps the zero padding of a partial last packet out of a result.
+    template <typename P, typename T>
+    auto firstLanes(size_t n)
+    {
+        T ones[P::width];
+        std::fill(ones, ones + P::width, T { 1 });
+        return P::loadPartial(ones, n) > P::zero();
+    }
+
+    template <typename P, typename T>
+    void loadRays(const RayPacket3D<T>& rays, size_t i, size_t n, P (&origin)[3], P (&direction)[3])
+    {
+        origin[0] = P::loadPartial(rays.origin_x.data() + i, n);
+        origin[1] = P::loadPartial(rays.origin_y.data() + i, n);
+        origin[2] = P::loadPartial(rays.origin_z.data() + i, n);
+        direction[0] = P::loadPartial(rays.direction_x.data() + i, n);
+        direction[1] = P::loadPartial(rays.direction_y.data() + i, n);
+        direction[2] = P::loadPartial(rays.direction_z.data() + i, n);
+    }
+}
+
+/*
+    Batched intersectionDist(Ray, Sphere3D), distances[n] is the hit distance of ray n (0 on a miss).
+*/
+template <typename T>
+void intersectionDist(const RayPacket3D<T>& rays, const Sphere3D<T>& sphere, std::span<T> distances)
+{
+    using P = Simd::Pack<T, Simd::NATIVE_WIDTH<T>>;
+    constexpr size_t W = P::width;
+    assert(distances.size() >= rays.size());
+
+    const P center[3] = { P::broadcast(sphere.center[0]), P::broadcast(sphere.center[1]), P::broadcast(sphere.center[2]) };
+    const P radius = P::broadcast(sphere.radius);
+    for (size_t i = 0; i < rays.size(); i += W) {
+        const size_t n = std::min(W, rays.size() - i);
+        P origin[3];
+        P direction[3];
+        Kernel::loadRays(rays, i, n, origin, direction);
+        Kernel::raySphereDist(origin, direction, center, radius).storePartial(distances.data() + i, n);
+    }
+}
+
+/*
+    Tests every ray against one sphere and records it where it is closer than the current hit.
+    Initialise closest_distances to infinity before testing the first object.
+*/
+template <typename T>
+void closestIntersection(const RayPacket3D<T>& rays, const Sphere3D<T>& sphere, size_t sphere_index, std::span<T> closest_distances, std::span<size_t> closest_indices)
+{
+    using P = Simd::Pack<T, Simd::NATIVE_WIDTH<T>>;
+    constexpr size_t W = P::width;
+    assert(closest_distances.size() >= rays.size() && closest_indices.size() >= rays.size());
+
+    const P center[3] = { P::broadcast(sphere.center[0]), P::broadcast(sphere.center[1]), P::broadcast(sphere.center[2]) };
+    const P radius = P::broadcast(sphere.radius);
+    for (size_t i = 0; i < rays.size(); i += W) {
+        const size_t n = std::min(W, rays.size() - i);
+        P origin[3];
+        P direction[3];
+        Kernel::loadRays(rays, i, n, origin, direction);
+        const P t = Kernel::raySphereDist(origin, direction, center, radius);
+        const P closest = P::loadPartial(closest_distances.data() + i, n);
+        const auto closer = (t > P::zero()) & (t < closest);
+
+        unsigned lanes = bitmask(closer) & ((1u << n) - 1);
+        if (lanes == 0) {
+            continue;
+        }
+        select(closer, t, closest).storePartial(closest_distances.data() + i, n);
+        for (; lanes != 0; lanes &= lanes - 1) {
+            closest_indices[i + static_cast<size_t>(std::countr_zero(lanes))] = sphere_index;
+        }
+    }
+}
+
+/*
+    Closest sphere hit IN FRONT OF the ray, index refers to the position in spheres.
+*/
+template <typename T>
+Hit<T> closestIntersection(const Ray<3, T>& ray, const SpherePacket3D<T>& spheres)
+{
+    using P = Simd::Pack<T, Simd::NATIVE_WIDTH<T>>;
+    constexpr size_t W = P::width;
+    constexpr T INF = std::numeric_limits<T>::infinity();
+
+    const P origin[3] = { P::broadcast(ray.getOrigin()[0]), P::broadcast(ray.getOrigin()[1]), P::broadcast(ray.getOrigin()[2]) };
+    const P direction[3] = { P::broadcast(ray.getDirection()[0]), P::broadcast(ray.getDirection()[1]), P::broadcast(ray.getDirection()[2]) };
+
+    P best = P::broadcast(INF);
+    size_t best_index[W];
+    std::fill(best_index, best_index + W, Hit<T>::NONE);
+    for (size_t i = 0; i < spheres.size(); i += W) {
+        const size_t n = std::min(W, spheres.size() - i);
+        const P center[3] = {
+            P::loadPartial(spheres.center_x.data() + i, n),
+            P::loadPartial(spheres.center_y.data() + i, n),
+            P::loadPartial(spheres.center_z.data() + i, n)
+        };
+        const P t = Kernel::raySphereDist(origin, direction, center, P::loadPartial(spheres.radius.data() + i, n));
+        auto closer = (t > P::zero()) & (t < best);
+        if (n < W) {
+            // The padding is a zero radius sphere at the origin, which a ray through it hits.
+            closer = closer & Kernel::firstLanes<P, T>(n);
+        }
+
+        unsigned lanes = bitmask(closer);
+        if (lanes == 0) {
+            continue;
+        }
+        best = select(closer, t, best);
+        for (; lanes != 0; lanes &= lanes - 1) {
+            const auto lane = static_cast<size_t>(std::countr_zero(lanes));
+            best_index[lane] = i + lane;
+        }
+    }
+
+    T distances[W];
+    best.store(distances);
+    Hit<T> hit;
+    for (size_t lane = 0; lane < W; ++lane) {
+        if (best_index[lane] != Hit<T>::NONE && (hit.index == Hit<T>::NONE || distances[lane] < hit.distance)) {
+            hit = { distances[lane], best_index[lane] };
+        }
+    }
+    return hit;
+}
+
+/*
+    Moller-Trumbore, returns the closest intersection IN FRONT OF ray with its barycentric coordinates.
+*/
+template <typename T>
+constexpr TriangleHit<T> intersectionBarycentric(const Ray<3, T>& ray, const BakedTriangle3D<T>& triangle)
+{
+    constexpr T EPSILON = static_cast<T>(1e-8);
+    constexpr T t_min = static_cast<T>(0.0001);
+
+    const Vec<3, T> p = crossProduct(ray.getDirection(), triangle.edge2);
+    const T det = dotProduct(triangle.edge1, p);
+    if (det * det < EPSILON * EPSILON) {
+        return {};
+    }
+    const T inverse_det = T { 1 } / det;
+    const Vec<3, T> displacement = static_cast<Vec<3, T>>(ray.getOrigin()) - static_cast<Vec<3, T>>(triangle.corner);
+    const T u = dotProduct(displacement, p) * inverse_det;
+    if (u < 0 || u > 1) {
+        return {};
+    }
+    const Vec<3, T> q = crossProduct(displacement, triangle.edge1);
+    const T v = dotProduct(ray.getDirection(), q) * inverse_det;
+    if (v < 0 || u + v > 1) {
+        return {};
+    }
+    const T t = dotProduct(triangle.edge2, q) * inverse_det;
+    if (t <= t_min) {
+        return {};
+    }
+    return { t, u, v };
+}
+
+template <typename T>
+constexpr TriangleHit<T> intersectionBarycentric(const Ray<3, T>& ray, const Triangle3D<T>& triangle)
+{
+    return intersectionBarycentric(ray, BakedTriangle3D<T> { triangle });
+}
+
+/*
+    Returns the distance for the closet intersection IN FRONT OF ray.
+*/
+template <typename T>
+constexpr T intersectionDist(const Ray<3, T>& ray, const BakedTriangle3D<T>& triangle)
+{
+    return intersectionBarycentric(ray, triangle).distance;
+}
+
+template <typename T>
+constexpr T intersectionDist(const Ray<3, T>& ray, const Triangle3D<T>& triangle)
+{
+    return intersectionBarycentric(ray, triangle).distance;
+}
+
+/*
+    Closest triangle hit IN FRONT OF the ray, index refers to the position in triangles.
+    Use intersectionBarycentric() on the winner for its barycentric coordinates.
+*/
+template <typename T>
+Hit<T> closestIntersection(const Ray<3, T>& ray, const TrianglePacket3D<T>& triangles)
+{
+    using P = Simd::Pack<T, Simd::NATIVE_WIDTH<T>>;
+    constexpr size_t W = P::width;
+    constexpr T EPSILON = static_cast<T>(1e-8);
+    constexpr T t_min = static_cast<T>(0.0001);
+
+    const P origin[3] = { P::broadcast(ray.getOrigin()[0]), P::broadcast(ray.getOrigin()[1]), P::broadcast(ray.getOrigin()[2]) };
+    const P direction[3] = { P::broadcast(ray.getDirection()[0]), P::broadcast(ray.getDirection()[1]), P::broadcast(ray.getDirection()[2]) };
+    const P zero = P::zero();
+    const P one = P::broadcast(1);
+
+    P best = P::broadcast(std::numeric_limits<T>::infinity());
+    size_t best_index[W];
+    std::fill(best_index, best_index + W, Hit<T>::NONE);
+    for (size_t i = 0; i < triangles.size(); i += W) {
+        const size_t n = std::min(W, triangles.size() - i);
+        const P e1[3] = { P::loadPartial(triangles.edge1_x.data() + i, n), P::loadPartial(triangles.edge1_y.data() + i, n), P::loadPartial(triangles.edge1_z.data() + i, n) };
+        const P e2[3] = { P::loadPartial(triangles.edge2_x.data() + i, n), P::loadPartial(triangles.edge2_y.data() + i, n), P::loadPartial(triangles.edge2_z.data() + i, n) };
+        const P d[3] = {
+            origin[0] - P::loadPartial(triangles.corner_x.data() + i, n),
+            origin[1] - P::loadPartial(triangles.corner_y.data() + i, n),
+            origin[2] - P::loadPartial(triangles.corner_z.data() + i, n)
+        };
+
+        const P p[3] = {
+            direction[1] * e2[2] - direction[2] * e2[1],
+            direction[2] * e2[0] - direction[0] * e2[2],
+            direction[0] * e2[1] - direction[1] * e2[0]
+        };
+        const P det = mulAdd(e1[0], p[0], mulAdd(e1[1], p[1], e1[2] * p[2]));
+        const P inverse_det = one / det;
+        const P u = mulAdd(d[0], p[0], mulAdd(d[1], p[1], d[2] * p[2])) * inverse_det;
+        const P q[3] = {
+            d[1] * e1[2] - d[2] * e1[1],
+            d[2] * e1[0] - d[0] * e1[2],
+            d[0] * e1[1] - d[1] * e1[0]
+        };
+        const P v = mulAdd(direction[0], q[0], mulAdd(direction[1], q[1], direction[2] * q[2])) * inverse_det;
+        const P t = mulAdd(e2[0], q[0], mulAdd(e2[1], q[1], e2[2] * q[2])) * inverse_det;
+
+        auto closer = (det * det >= P::broadcast(EPSILON * EPSILON))
+            & (u >= zero) & (v >= zero) & (u + v <= one)
+            & (t > P::broadcast(t_min)) & (t < best);
+        if (n < W) {
+            closer = closer & Kernel::firstLanes<P, T>(n);
+        }
+
+        unsigned lanes = bitmask(closer);
+        if (lanes == 0) {
+            continue;
+        }
+        best = select(closer, t, best);
+        for (; lanes != 0; lanes &= lanes - 1) {
+            const auto lane = static_cast<size_t>(std::countr_zero(lanes));
+            best_index[lane] = i + lane;
+        }
+    }
+
+    T distances[W];
+    best.store(distances);
+    Hit<T> hit;
+    for (size_t lane = 0; lane < W; ++lane) {
+        if (best_index[lane] != Hit<T>::NONE && (hit.index == Hit<T>::NONE || distances[lane] < hit.distance)) {
+            hit = { distances[lane], best_index[lane] };
+        }
+    }
+    return hit;
+}
+
 template <typename T = float>
 constexpr Vec<3, T> getNormalVec(const Pos<3, T>& hit_point, const Sphere3D<T>& sphere)
 {
@@ -1032,4 +8021,294 @@ constexpr Vec<3, T> getRefracted(const Vec<3, T>& vec, const Vec<3, T>& normal,
     return perpendicular + parallel;
 }
 
+/*
+    Axis aligned bounding box.
+*/
+template <typename T = float>
+struct BoundingBox3D {
+    using value_type = T;
+    Pos<3, T> lower { std::numeric_limits<T>::max(), std::numeric_limits<T>::max(), std::numeric_limits<T>::max() };
+    Pos<3, T> upper { std::numeric_limits<T>::lowest(), std::numeric_limits<T>::lowest(), std::numeric_limits<T>::lowest() };
+
+    constexpr void grow(const Pos<3, T>& point)
+    {
+        for (size_t i = 0; i < 3; ++i) {
+            lower[i] = std::min(lower[i], point[i]);
+            upper[i] = std::max(upper[i], point[i]);
+        }
+    }
+    constexpr void grow(const BoundingBox3D<T>& other)
+    {
+        for (size_t i = 0; i < 3; ++i) {
+            lower[i] = std::min(lower[i], other.lower[i]);
+            upper[i] = std::max(upper[i], other.upper[i]);
+        }
+    }
+    constexpr Pos<3, T> getCentroid() const
+    {
+        return { (lower[0] + upper[0]) / 2, (lower[1] + upper[1]) / 2, (lower[2] + upper[2]) / 2 };
+    }
+    constexpr T getSurfaceArea() const
+    {
+        const T x = upper[0] - lower[0];
+        const T y = upper[1] - lower[1];
+        const T z = upper[2] - lower[2];
+        return (x < 0) ? T {} : 2 * (x * y + y * z + z * x);
+    }
+};
+
+template <typename T>
+constexpr BoundingBox3D<T> getBounds(const Sphere3D<T>& sphere)
+{
+    const auto& c = sphere.center;
+    const T r = sphere.radius;
+    return { { c[0] - r, c[1] - r, c[2] - r }, { c[0] + r, c[1] + r, c[2] + r } };
+}
+
+template <typename T>
+constexpr BoundingBox3D<T> getBounds(const Triangle3D<T>& triangle)
+{
+    BoundingBox3D<T> bounds;
+    for (const auto& corner : triangle.corners) {
+        bounds.grow(corner);
+    }
+    return bounds;
+}
+
+template <typename T>
+constexpr BoundingBox3D<T> getBounds(const BakedTriangle3D<T>& triangle)
+{
+    BoundingBox3D<T> bounds;
+    bounds.grow(triangle.corner);
+    bounds.grow(static_cast<Pos<3, T>>(static_cast<Vec<3, T>>(triangle.corner) + triangle.edge1));
+    bounds.grow(static_cast<Pos<3, T>>(static_cast<Vec<3, T>>(triangle.corner) + triangle.edge2));
+    return bounds;
+}
+
+/*
+    Bounding volume hierarchy over any primitive with getBounds() and intersectionDist(Ray<3, T>, Primitive).
+    Built top down with a binned surface area heuristic and flattened depth first into one node array,
+    the left child of an interior node is the next node.
+*/
+template <typename Primitive>
+class BVH3D {
+public:
+    using T = typename decltype(getBounds(std::declval<const Primitive&>()))::value_type;
+
+    static constexpr size_t MAX_LEAF_SIZE = 4;
+    static constexpr size_t MAX_DEPTH = 63;
+    static constexpr size_t BIN_COUNT = 16;
+
+private:
+    struct Node {
+        BoundingBox3D<T> bounds;
+        uint32_t offset; // first primitive for leaves, right child for interior nodes
+        uint32_t count; // primitives in a leaf, 0 for interior nodes
+    };
+    struct BuildPrimitive {
+        BoundingBox3D<T> bounds;
+        Pos<3, T> centroid;
+        size_t index;
+    };
+
+    std::vector<Node> m_nodes;
+    std::vector<Primitive> m_primitives;
+    std::vector<size_t> m_indices;
+
+    uint32_t build(std::span<const Primitive> source, std::vector<BuildPrimitive>& prims, size_t begin, size_t end, size_t depth)
+    {
+        const auto node_index = static_cast<uint32_t>(m_nodes.size());
+        m_nodes.push_back({});
+
+        BoundingBox3D<T> bounds;
+        BoundingBox3D<T> centroid_bounds;
+        for (size_t i = begin; i < end; ++i) {
+            bounds.grow(prims[i].bounds);
+            centroid_bounds.grow(prims[i].centroid);
+        }
+        m_nodes[node_index].bounds = bounds;
+
+        const size_t count = end - begin;
+        auto makeLeaf = [&] {
+            m_nodes[node_index].offset = static_cast<uint32_t>(m_primitives.size());
+            m_nodes[node_index].count = static_cast<uint32_t>(count);
+            for (size_t i = begin; i < end; ++i) {
+                m_indices.push_back(prims[i].index);
+                m_primitives.push_back(source[prims[i].index]);
+            }
+            return node_index;
+        };
+        if (count <= 1 || depth >= MAX_DEPTH) {
+            return makeLeaf();
+        }
+
+        // Binned SAH, cost is relative to testing one primitive.
+        constexpr T TRAVERSAL_COST = T { 1 };
+        T best_cost = std::numeric_limits<T>::max();
+        size_t best_axis = 0;
+        size_t best_split = 0;
+        for (size_t axis = 0; axis < 3; ++axis) {
+            const T extent = centroid_bounds.upper[axis] - centroid_bounds.lower[axis];
+            if (extent <= 0) {
+                continue;
+            }
+            BoundingBox3D<T> bin_bounds[BIN_COUNT];
+            size_t bin_counts[BIN_COUNT] = {};
+            const T scale = static_cast<T>(BIN_COUNT) / extent;
+            for (size_t i = begin; i < end; ++i) {
+                const size_t bin = std::min(BIN_COUNT - 1, static_cast<size_t>((prims[i].centroid[axis] - centroid_bounds.lower[axis]) * scale));
+                bin_bounds[bin].grow(prims[i].bounds);
+                bin_counts[bin]++;
+            }
+
+            T right_area[BIN_COUNT];
+            size_t right_count[BIN_COUNT];
+            BoundingBox3D<T> accumulated;
+            size_t accumulated_count = 0;
+            for (size_t bin = BIN_COUNT - 1; bin > 0; --bin) {
+                accumulated.grow(bin_bounds[bin]);
+                accumulated_count += bin_counts[bin];
+                right_area[bin] = accumulated.getSurfaceArea();
+                right_count[bin] = accumulated_count;
+            }
+            accumulated = {};
+            accumulated_count = 0;
+            for (size_t split = 1; split < BIN_COUNT; ++split) {
+                accumulated.grow(bin_bounds[split - 1]);
+                accumulated_count += bin_counts[split - 1];
+                if (accumulated_count == 0 || right_count[split] == 0) {
+                    continue;
+                }
+                const T cost = accumulated.getSurfaceArea() * static_cast<T>(accumulated_count)
+                    + right_area[split] * static_cast<T>(right_count[split]);
+                if (cost < best_cost) {
+                    best_cost = cost;
+                    best_axis = axis;
+                    best_split = split;
+                }
+            }
+        }
+
+        const T leaf_cost = static_cast<T>(count);
+        const T split_cost = TRAVERSAL_COST + best_cost / bounds.getSurfaceArea();
+        if (best_split == 0 || (count <= MAX_LEAF_SIZE && leaf_cost <= split_cost)) {
+            return makeLeaf();
+        }
+
+        const T lower = centroid_bounds.lower[best_axis];
+        const T scale = static_cast<T>(BIN_COUNT) / (centroid_bounds.upper[best_axis] - lower);
+        const auto middle = std::partition(prims.begin() + static_cast<std::ptrdiff_t>(begin), prims.begin() + static_cast<std::ptrdiff_t>(end), [&](const BuildPrimitive& prim) {
+            return std::min(BIN_COUNT - 1, static_cast<size_t>((prim.centroid[best_axis] - lower) * scale)) < best_split;
+        });
+        const auto split = static_cast<size_t>(middle - prims.begin());
+
+        build(source, prims, begin, split, depth + 1);
+        m_nodes[node_index].offset = build(source, prims, split, end, depth + 1);
+        m_nodes[node_index].count = 0;
+        return node_index;
+    }
+
+    // Slab test, returns the entry distance or infinity on a miss.
+    static T intersectBox(const BoundingBox3D<T>& box, const Pos<3, T>& origin, const T (&inverse_direction)[3], T max_distance)
+    {
+        T t_near = 0;
+        T t_far = max_distance;
+        for (size_t i = 0; i < 3; ++i) {
+            const T t0 = (box.lower[i] - origin[i]) * inverse_direction[i];
+            const T t1 = (box.upper[i] - origin[i]) * inverse_direction[i];
+            t_near = std::max(t_near, std::min(t0, t1));
+            t_far = std::min(t_far, std::max(t0, t1));
+        }
+        return (t_near <= t_far) ? t_near : std::numeric_limits<T>::infinity();
+    }
+
+    template <bool ANY_HIT>
+    Hit<T> traverse(const Ray<3, T>& ray, T max_distance) const
+    {
+        Hit<T> hit;
+        if (m_nodes.empty()) {
+            return hit;
+        }
+        const Pos<3, T>& origin = ray.getOrigin();
+        const T inverse_direction[3] = { T { 1 } / ray.getDirection()[0], T { 1 } / ray.getDirection()[1], T { 1 } / ray.getDirection()[2] };
+        T closest = max_distance;
+
+        uint32_t stack[MAX_DEPTH + 1];
+        size_t stack_size = 0;
+        stack[stack_size++] = 0;
+        while (stack_size > 0) {
+            const Node& node = m_nodes[stack[--stack_size]];
+            if (intersectBox(node.bounds, origin, inverse_direction, closest) == std::numeric_limits<T>::infinity()) {
+                continue;
+            }
+            if (node.count > 0) {
+                for (uint32_t i = node.offset; i < node.offset + node.count; ++i) {
+                    const T t = intersectionDist(ray, m_primitives[i]);
+                    if (t > 0 && t < closest) {
+                        closest = t;
+                        hit = { t, m_indices[i] };
+                        if constexpr (ANY_HIT) {
+                            return hit;
+                        }
+                    }
+                }
+                continue;
+            }
+
+            // Push the further child first so the nearer one is visited next.
+            const auto left = static_cast<uint32_t>(&node - m_nodes.data()) + 1;
+            const uint32_t right = node.offset;
+            const T left_t = intersectBox(m_nodes[left].bounds, origin, inverse_direction, closest);
+            const T right_t = intersectBox(m_nodes[right].bounds, origin, inverse_direction, closest);
+            const bool left_first = left_t <= right_t;
+            stack[stack_size++] = left_first ? right : left;
+            stack[stack_size++] = left_first ? left : right;
+        }
+        return hit;
+    }
+
+public:
+    BVH3D() = default;
+    explicit BVH3D(std::span<const Primitive> primitives)
+    {
+        std::vector<BuildPrimitive> prims;
+        prims.reserve(primitives.size());
+        for (size_t i = 0; i < primitives.size(); ++i) {
+            const BoundingBox3D<T> bounds = getBounds(primitives[i]);
+            prims.push_back({ bounds, bounds.getCentroid(), i });
+        }
+        m_nodes.reserve(2 * primitives.size());
+        m_primitives.reserve(primitives.size());
+        m_indices.reserve(primitives.size());
+        if (!prims.empty()) {
+            build(primitives, prims, 0, prims.size(), 0);
+        }
+    }
+
+    size_t size() const
+    {
+        return m_primitives.size();
+    }
+    size_t getNodeCount() const
+    {
+        return m_nodes.size();
+    }
+
+    /*
+        Closest hit IN FRONT OF the ray, index refers to the position in the primitives given on construction.
+    */
+    Hit<T> closestIntersection(const Ray<3, T>& ray, T max_distance = std::numeric_limits<T>::infinity()) const
+    {
+        return traverse<false>(ray, max_distance);
+    }
+
+    /*
+        True if any primitive is hit closer than max_distance (shadow / occlusion queries).
+    */
+    bool anyIntersection(const Ray<3, T>& ray, T max_distance = std::numeric_limits<T>::infinity()) const
+    {
+        return traverse<true>(ray, max_distance).index != Hit<T>::NONE;
+    }
+};
+
 }
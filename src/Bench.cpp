@@ -0,0 +1,1088 @@
+#include "Math.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <string>
+#include <string_view>
+
+/*
+    Micro benchmark suite, `make bench`.
+
+    Every benchmark is a function run for a number of iterations, the count is grown until one
+    run takes at least MIN_TIME and the median of REPETITIONS runs is reported. Results go to
+    stdout as JSON (default) or CSV.
+
+    ./bench.exe [--format=json|csv] [--filter=<substring>] [--min-time=<seconds>]
+*/
+
+namespace LA = Math::LinearAlgebra;
+namespace Act = Math::Activation;
+
+namespace {
+namespace Bench {
+
+// Keeps the compiler from discarding or hoisting the computation that produced value.
+template <typename T>
+inline void doNotOptimize(const T& value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+inline void clobberMemory()
+{
+    asm volatile("" : : : "memory");
+}
+
+struct Benchmark {
+    std::string name;
+    std::function<void(size_t iterations)> run;
+    double flops_per_op = 0;
+    double bytes_per_op = 0;
+    double items_per_op = 1;
+};
+
+struct Result {
+    std::string name;
+    size_t iterations;
+    double ns_per_op;
+    double items_per_second;
+    double bytes_per_second;
+    double gflops;
+};
+
+struct Options {
+    std::string_view format = "json";
+    std::string_view filter = "";
+    double min_time = 0.1;
+};
+
+constexpr size_t REPETITIONS = 5;
+
+std::vector<Benchmark>& registry()
+{
+    static std::vector<Benchmark> benchmarks;
+    return benchmarks;
+}
+
+void add(std::string name, std::function<void(size_t)> run, double flops_per_op = 0, double bytes_per_op = 0, double items_per_op = 1)
+{
+    registry().push_back({ std::move(name), std::move(run), flops_per_op, bytes_per_op, items_per_op });
+}
+
+std::chrono::steady_clock::time_point& timerStart()
+{
+    static std::chrono::steady_clock::time_point start;
+    return start;
+}
+
+// Restarts the clock of the running benchmark, call after setup so it is not timed.
+void resetTimer()
+{
+    timerStart() = std::chrono::steady_clock::now();
+}
+
+double timeRun(const Benchmark& benchmark, size_t iterations)
+{
+    resetTimer();
+    benchmark.run(iterations);
+    const auto stop = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(stop - timerStart()).count();
+}
+
+Result measure(const Benchmark& benchmark, const Options& options)
+{
+    size_t iterations = 1;
+    double seconds = timeRun(benchmark, iterations);
+    while (seconds < options.min_time) {
+        const double scale = seconds > 0 ? options.min_time * 1.4 / seconds : 10.0;
+        iterations = std::max(iterations + 1, static_cast<size_t>(static_cast<double>(iterations) * std::min(scale, 10.0)));
+        seconds = timeRun(benchmark, iterations);
+    }
+
+    std::array<double, REPETITIONS> samples {};
+    samples[0] = seconds;
+    for (size_t i = 1; i < REPETITIONS; ++i) {
+        samples[i] = timeRun(benchmark, iterations);
+    }
+    std::ranges::nth_element(samples, samples.begin() + REPETITIONS / 2);
+    const double ops_per_second = static_cast<double>(iterations) / samples[REPETITIONS / 2];
+
+    return Result {
+        benchmark.name,
+        iterations,
+        1e9 / ops_per_second,
+        benchmark.items_per_op * ops_per_second,
+        benchmark.bytes_per_op * ops_per_second,
+        benchmark.flops_per_op * ops_per_second * 1e-9,
+    };
+}
+
+void writeJson(std::ostream& out, const std::vector<Result>& results)
+{
+    out << "{\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        out << "    { \"name\": \"" << r.name << "\""
+            << ", \"iterations\": " << r.iterations
+            << ", \"ns_per_op\": " << r.ns_per_op
+            << ", \"items_per_second\": " << r.items_per_second
+            << ", \"bytes_per_second\": " << r.bytes_per_second
+            << ", \"gflops\": " << r.gflops << " }"
+            << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    out << "  ]\n}\n";
+}
+
+void writeCsv(std::ostream& out, const std::vector<Result>& results)
+{
+    out << "name,iterations,ns_per_op,items_per_second,bytes_per_second,gflops\n";
+    for (const Result& r : results) {
+        out << r.name << ',' << r.iterations << ',' << r.ns_per_op << ',' << r.items_per_second << ','
+            << r.bytes_per_second << ',' << r.gflops << '\n';
+    }
+}
+
+template <typename T>
+void fillRandom(T& values, float low = -1, float high = 1)
+{
+    static std::mt19937 generator(42);
+    std::uniform_real_distribution<float> distribution(low, high);
+    for (auto& value : values) {
+        value = distribution(generator);
+    }
+}
+
+} // namespace Bench
+
+template <size_t N>
+void addVecBenchmarks()
+{
+    const std::string suffix = "<" + std::to_string(N) + ">";
+    constexpr double BYTES = 3.0 * N * sizeof(float);
+
+    Bench::add("Vec" + suffix + "/add", [](size_t iterations) {
+        LA::Vec<N> a, b;
+        Bench::fillRandom(a);
+        Bench::fillRandom(b);
+        Bench::resetTimer();
+        for (size_t i = 0; i < iterations; ++i) {
+            Bench::doNotOptimize(a);
+            LA::Vec<N> c = a + b;
+            Bench::doNotOptimize(c);
+        }
+    }, N, BYTES);
+
+    Bench::add("Vec" + suffix + "/mul", [](size_t iterations) {
+        LA::Vec<N> a, b;
+        Bench::fillRandom(a);
+        Bench::fillRandom(b);
+        Bench::resetTimer();
+        for (size_t i = 0; i < iterations; ++i) {
+            Bench::doNotOptimize(a);
+            LA::Vec<N> c = a * b;
+            Bench::doNotOptimize(c);
+        }
+    }, N, BYTES);
+
+    Bench::add("Vec" + suffix + "/getNormalised", [](size_t iterations) {
+        LA::Vec<N> a;
+        Bench::fillRandom(a);
+        Bench::resetTimer();
+        for (size_t i = 0; i < iterations; ++i) {
+            Bench::doNotOptimize(a);
+            auto c = a.getNormalised();
+            Bench::doNotOptimize(c);
+        }
+    }, 3.0 * N + 1, 2.0 * N * sizeof(float));
+
+    Bench::add("dotProduct/Vec" + suffix, [](size_t iterations) {
+        LA::Vec<N> a, b;
+        Bench::fillRandom(a);
+        Bench::fillRandom(b);
+        Bench::resetTimer();
+        for (size_t i = 0; i < iterations; ++i) {
+            Bench::doNotOptimize(a);
+            auto c = LA::dotProduct(a, b);
+            Bench::doNotOptimize(c);
+        }
+    }, 2.0 * N, 2.0 * N * sizeof(float));
+}
+
+template <size_t N>
+void addVecExpressionBenchmark()
+{
+    Bench::add("Vec<" + std::to_string(N) + ">/a+b*s-c", [](size_t iterations) {
+        auto a = std::make_unique<LA::Vec<N>>();
+        auto b = std::make_unique<LA::Vec<N>>();
+        auto c = std::make_unique<LA::Vec<N>>();
+        auto result = std::make_unique<LA::Vec<N>>();
+        Bench::fillRandom(*a);
+        Bench::fillRandom(*b);
+        Bench::fillRandom(*c);
+        Bench::resetTimer();
+        for (size_t i = 0; i < iterations; ++i) {
+            Bench::clobberMemory();
+            *result = *a + *b * 0.5f - *c;
+            Bench::doNotOptimize(result->data[0]);
+        }
+    }, 3.0 * N, 4.0 * N * sizeof(float));
+}
+
+template <size_t N>
+void addMatBenchmarks()
+{
+    const std::string suffix = "<" + std::to_string(N) + "x" + std::to_string(N) + ">";
+    constexpr double SIZE = static_cast<double>(N);
+
+    Bench::add("Mat" + suffix + "/multiply", [](size_t iterations) {
+        auto a = std::make_unique<LA::Mat<N, N>>();
+        auto b = std::make_unique<LA::Mat<N, N>>();
+        Bench::fillRandom(*a);
+        Bench::fillRandom(*b);
+        Bench::resetTimer();
+        for (size_t i = 0; i < iterations; ++i) {
+            Bench::clobberMemory();
+            auto c = std::make_unique<LA::Mat<N, N>>(*a * *b);
+            Bench::doNotOptimize(c->data[0]);
+        }
+    }, 2.0 * SIZE * SIZE * SIZE, 3.0 * SIZE * SIZE * sizeof(float));
+
+    Bench::add("dotProduct/Mat" + suffix + "xVec", [](size_t iterations) {
+        auto a = std::make_unique<LA::Mat<N, N>>();
+        LA::Vec<N> x;
+        Bench::fillRandom(*a);
+        Bench::fillRandom(x);
+        Bench::resetTimer();
+        for (size_t i = 0; i < iterations; ++i) {
+            Bench::clobberMemory();
+            auto y = LA::dotProduct(*a, x);
+            Bench::doNotOptimize(y);
+        }
+    }, 2.0 * SIZE * SIZE, (SIZE * SIZE + 2.0 * SIZE) * sizeof(float));
+}
+
+void addDynMatBenchmarks(size_t n)
+{
+    const std::string suffix = "<" + std::to_string(n) + "x" + std::to_string(n) + ">";
+    const double size = static_cast<double>(n);
+
+    Bench::add("DynMat" + suffix + "/multiply", [n](size_t iterations) {
+        LA::DynMat<float> a(n, n), b(n, n);
+        Bench::fillRandom(a);
+        Bench::fillRandom(b);
+        Bench::resetTimer();
+        for (size_t i = 0; i < iterations; ++i) {
+            Bench::clobberMemory();
+            auto c = a * b;
+            Bench::doNotOptimize(c.data()[0]);
+        }
+    }, 2.0 * size * size * size, 3.0 * size * size * sizeof(float));
+
+    Bench::add("DynMat" + suffix + "/multiply/par", [n](size_t iterations) {
+        LA::DynMat<float> a(n, n), b(n, n);
+        Bench::fillRandom(a);
+        Bench::fillRandom(b);
+        Bench::resetTimer();
+        for (size_t i = 0; i < iterations; ++i) {
+            Bench::clobberMemory();
+            auto c = LA::multiply(std::execution::par, a, b);
+            Bench::doNotOptimize(c.data()[0]);
+        }
+    }, 2.0 * size * size * size, 3.0 * size * size * sizeof(float));
+
+    Bench::add("dotProduct/DynMat" + suffix + "xDynVec", [n](size_t iterations) {
+        LA::DynMat<float> a(n, n);
+        LA::DynVec<float> x(n);
+        Bench::fillRandom(a);
+        Bench::fillRandom(x);
+        Bench::resetTimer();
+        for (size_t i = 0; i < iterations; ++i) {
+            Bench::clobberMemory();
+            auto y = LA::dotProduct(a, x);
+            Bench::doNotOptimize(y.data()[0]);
+        }
+    }, 2.0 * size * size, (size * size + 2.0 * size) * sizeof(float));
+}
+
+void addViewBenchmarks(size_t n, size_t block)
+{
+    const std::string suffix = "<" + std::to_string(n) + "x" + std::to_string(n) + "," + std::to_string(block) + ">";
+    const double size = static_cast<double>(n);
+    const double rest = static_cast<double>(n - block);
+    const double update_flops = 2.0 * rest * rest * static_cast<double>(block);
+
+    // Trailing update of a blocked factorisation, A22 -= A21 * A12.
+    Bench::add("MatView" + suffix + "/multiplySubtract", [n, block](size_t iterations) {
+        LA::DynMat<float> a(n, n);
+        Bench::fillRandom(a);
+        const LA::MatView<float> view(a);
+        Bench::resetTimer();
+        for (size_t i = 0; i < iterations; ++i) {
+            Bench::clobberMemory();
+            LA::multiplySubtract(view.block(block, 0, n - block, block), view.block(0, block, block, n - block), view.block(block, block, n - block, n - block));
+            Bench::doNotOptimize(a.data()[n * n - 1]);
+        }
+    }, update_flops);
+
+    Bench::add("MatView" + suffix + "/multiplySubtract/copied", [n, block](size_t iterations) {
+        LA::DynMat<float> a(n, n);
+        Bench::fillRandom(a);
+        const LA::MatView<float> view(a);
+        Bench::resetTimer();
+        for (size_t i = 0; i < iterations; ++i) {
+            Bench::clobberMemory();
+            const auto a21 = static_cast<LA::DynMat<float>>(view.block(block, 0, n - block, block));
+            const auto a12 = static_cast<LA::DynMat<float>>(view.block(0, block, block, n - block));
+            auto a22 = static_cast<LA::DynMat<float>>(view.block(block, block, n - block, n - block));
+            auto product = a21 * a12;
+            std::ranges::transform(a22, product, a22.begin(), std::minus {});
+            view.block(block, block, n - block, n - block).assign(LA::MatView<const float>(a22));
+            Bench::doNotOptimize(a.data()[n * n - 1]);
+        }
+    }, update_flops);
+
+    Bench::add("dotProduct/MatView" + suffix + "/transposed", [n](size_t iterations) {
+        LA::DynMat<float> a(n, n);
+        LA::DynVec<float> x(n);
+        Bench::fillRandom(a);
+        Bench::fillRandom(x);
+        Bench::resetTimer();
+        for (size_t i = 0; i < iterations; ++i) {
+            Bench::clobberMemory();
+            auto y = LA::dotProduct(LA::transpose(LA::MatView<const float>(a)), LA::VecView<const float>(x));
+            Bench::doNotOptimize(y.data()[0]);
+        }
+    }, 2.0 * size * size, (size * size + 2.0 * size) * sizeof(float));
+
+    Bench::add("dotProduct/DynMat" + suffix + "/transposed/copied", [n](size_t iterations) {
+        LA::DynMat<float> a(n, n);
+        LA::DynVec<float> x(n);
+        Bench::fillRandom(a);
+        Bench::fillRandom(x);
+        Bench::resetTimer();
+        for (size_t i = 0; i < iterations; ++i) {
+            Bench::clobberMemory();
+            auto y = LA::dotProduct(LA::transpose(a), x);
+            Bench::doNotOptimize(y.data()[0]);
+        }
+    }, 2.0 * size * size, (size * size + 2.0 * size) * sizeof(float));
+}
+
+template <size_t N, typename LayoutA, typename LayoutB>
+void addLayoutMultiplyBenchmark(const std::string& name)
+{
+    constexpr double SIZE = static_cast<double>(N);
+    Bench::add("Mat<" + std::to_string(N) + "x" + std::to_string(N) + ">/" + name + "/multiply", [](size_t iterations) {
+        auto a = std::make_unique<LA::Mat<N, N, float, LayoutA>>();
+        auto b = std::make_unique<LA::Mat<N, N, float, LayoutB>>();
+        Bench::fillRandom(*a);
+        Bench::fillRandom(*b);
+        Bench::resetTimer();
+        for (size_t i = 0; i < iterations; ++i) {
+            Bench::clobberMemory();
+            auto c = std::make_unique<LA::Mat<N, N, float, LayoutA>>(*a * *b);
+            Bench::doNotOptimize(c->data[0]);
+        }
+    }, 2.0 * SIZE * SIZE * SIZE, 3.0 * SIZE * SIZE * sizeof(float));
+}
+
+template <size_t N, typename Layout>
+void addLayoutDotProductBenchmark(const std::string& name)
+{
+    constexpr double SIZE = static_cast<double>(N);
+    const std::string suffix = "<" + std::to_string(N) + "x" + std::to_string(N) + ">/" + name;
+    Bench::add("dotProduct/Mat" + suffix + "xVec", [](size_t iterations) {
+        auto a = std::make_unique<LA::Mat<N, N, float, Layout>>();
+        LA::Vec<N> x;
+        Bench::fillRandom(*a);
+        Bench::fillRandom(x);
+        Bench::resetTimer();
+        for (size_t i = 0; i < iterations; ++i) {
+            Bench::clobberMemory();
+            auto y = LA::dotProduct(*a, x);
+            Bench::doNotOptimize(y);
+        }
+    }, 2.0 * SIZE * SIZE, (SIZE * SIZE + 2.0 * SIZE) * sizeof(float));
+
+    Bench::add("dotProduct/VecxMat" + suffix, [](size_t iterations) {
+        auto a = std::make_unique<LA::Mat<N, N, float, Layout>>();
+        LA::Vec<N> x;
+        Bench::fillRandom(*a);
+        Bench::fillRandom(x);
+        Bench::resetTimer();
+        for (size_t i = 0; i < iterations; ++i) {
+            Bench::clobberMemory();
+            auto y = LA::dotProduct(x, *a);
+            Bench::doNotOptimize(y);
+        }
+    }, 2.0 * SIZE * SIZE, (SIZE * SIZE + 2.0 * SIZE) * sizeof(float));
+}
+
+template <size_t N>
+void addLayoutBenchmarks()
+{
+    constexpr double SIZE = static_cast<double>(N);
+    addLayoutMultiplyBenchmark<N, LA::RowMajor, LA::RowMajor>("RowMajor");
+    addLayoutMultiplyBenchmark<N, LA::ColumnMajor, LA::ColumnMajor>("ColumnMajor");
+    addLayoutMultiplyBenchmark<N, LA::ColumnMajor, LA::RowMajor>("ColumnMajor*RowMajor");
+    addLayoutMultiplyBenchmark<N, LA::Tiled<8>, LA::Tiled<8>>("Tiled<8>");
+
+    // A column-major producer's matrix handed over as row-major, the transpose the layouts avoid.
+    Bench::add("Mat<" + std::to_string(N) + "x" + std::to_string(N) + ">/ColumnMajor*RowMajor/multiply/relayout", [](size_t iterations) {
+        auto a = std::make_unique<LA::Mat<N, N, float, LA::ColumnMajor>>();
+        auto b = std::make_unique<LA::Mat<N, N>>();
+        Bench::fillRandom(*a);
+        Bench::fillRandom(*b);
+        Bench::resetTimer();
+        for (size_t i = 0; i < iterations; ++i) {
+            Bench::clobberMemory();
+            auto rows = std::make_unique<LA::Mat<N, N>>(*a);
+            auto c = std::make_unique<LA::Mat<N, N>>(*rows * *b);
+            Bench::doNotOptimize(c->data[0]);
+        }
+    }, 2.0 * SIZE * SIZE * SIZE, 3.0 * SIZE * SIZE * sizeof(float));
+
+    addLayoutDotProductBenchmark<N, LA::RowMajor>("RowMajor");
+    addLayoutDotProductBenchmark<N, LA::ColumnMajor>("ColumnMajor");
+    addLayoutDotProductBenchmark<N, LA::Tiled<8>>("Tiled<8>");
+}
+
+void addReductionBenchmarks(size_t n)
+{
+    const std::string suffix = "<" + std::to_string(n) + ">";
+    const double size = static_cast<double>(n);
+
+    auto addDot = [&](const std::string& name, auto policy, LA::Summation summation) {
+        Bench::add("dotProduct/DynVec" + suffix + name, [n, policy, summation](size_t iterations) {
+            LA::DynVec<float> a(n), b(n);
+            Bench::fillRandom(a);
+            Bench::fillRandom(b);
+            Bench::resetTimer();
+            for (size_t i = 0; i < iterations; ++i) {
+                Bench::clobberMemory();
+                auto dot = LA::dotProduct(policy, a, b, summation);
+                Bench::doNotOptimize(dot);
+            }
+        }, 2.0 * size, 2.0 * size * sizeof(float), size);
+    };
+    addDot("/seq", std::execution::seq, LA::Summation::Pairwise);
+    addDot("/par", std::execution::par, LA::Summation::Pairwise);
+    addDot("/seq/kahan", std::execution::seq, LA::Summation::Kahan);
+    addDot("/par/kahan", std::execution::par, LA::Summation::Kahan);
+
+    Bench::add("add/DynVec" + suffix + "/par", [n](size_t iterations) {
+        LA::DynVec<float> a(n), b(n);
+        Bench::fillRandom(a);
+        Bench::fillRandom(b);
+        Bench::resetTimer();
+        for (size_t i = 0; i < iterations; ++i) {
+            Bench::clobberMemory();
+            auto c = LA::add(std::execution::par, a, b);
+            Bench::doNotOptimize(c.data()[0]);
+        }
+    }, size, 3.0 * size * sizeof(float), size);
+}
+
+// n x n with about per_row non-zeros in every row at random columns.
+LA::SparseMat<float> makeRandomSparse(size_t n, size_t per_row, LA::SparseFormat format)
+{
+    std::mt19937 generator(7);
+    std::uniform_int_distribution<size_t> column(0, n - 1);
+    std::uniform_real_distribution<float> value(-1, 1);
+    std::vector<LA::Triplet<float>> triplets;
+    triplets.reserve(n * per_row);
+    for (size_t row = 0; row < n; ++row) {
+        for (size_t i = 0; i < per_row; ++i) {
+            triplets.push_back({ row, column(generator), value(generator) });
+        }
+    }
+    return LA::SparseMat<float>(n, n, std::span<const LA::Triplet<float>>(triplets), format);
+}
+
+void addSparseBenchmarks(size_t n, size_t per_row)
+{
+    const std::string suffix = "<" + std::to_string(n) + "," + std::to_string(per_row) + "/row>";
+    static constexpr size_t RHS_COLS = 32;
+
+    auto addProducts = [&](const std::string& name, LA::SparseFormat format, auto policy) {
+        const double non_zeros = static_cast<double>(n * per_row);
+        const double size = static_cast<double>(n);
+        Bench::add("dotProduct/SparseMat" + suffix + name, [n, per_row, format, policy](size_t iterations) {
+            const LA::SparseMat<float> a = makeRandomSparse(n, per_row, format);
+            LA::DynVec<float> x(n);
+            Bench::fillRandom(x);
+            Bench::resetTimer();
+            for (size_t i = 0; i < iterations; ++i) {
+                Bench::clobberMemory();
+                auto y = LA::dotProduct(policy, a, x);
+                Bench::doNotOptimize(y.data()[0]);
+            }
+        }, 2.0 * non_zeros, non_zeros * (sizeof(float) + sizeof(uint32_t)) + 2.0 * size * sizeof(float));
+        Bench::add("SparseMat" + suffix + "xDynMat<" + std::to_string(RHS_COLS) + ">" + name, [n, per_row, format, policy](size_t iterations) {
+            const LA::SparseMat<float> a = makeRandomSparse(n, per_row, format);
+            LA::DynMat<float> b(n, RHS_COLS);
+            Bench::fillRandom(b);
+            Bench::resetTimer();
+            for (size_t i = 0; i < iterations; ++i) {
+                Bench::clobberMemory();
+                auto c = LA::multiply(policy, a, b);
+                Bench::doNotOptimize(c.data()[0]);
+            }
+        }, 2.0 * non_zeros * RHS_COLS, non_zeros * (sizeof(float) + sizeof(uint32_t)) + 2.0 * size * RHS_COLS * sizeof(float));
+    };
+    addProducts("/CSR/seq", LA::SparseFormat::CSR, std::execution::seq);
+    addProducts("/CSR/par", LA::SparseFormat::CSR, std::execution::par);
+    addProducts("/CSC/seq", LA::SparseFormat::CSC, std::execution::seq);
+    addProducts("/CSC/par", LA::SparseFormat::CSC, std::execution::par);
+}
+
+void addQuantisedBenchmarks(size_t m, size_t k, size_t n)
+{
+    const std::string suffix = "<" + std::to_string(m) + "x" + std::to_string(k) + ">";
+    const double rows = static_cast<double>(m);
+    const double depth = static_cast<double>(k);
+    const double cols = static_cast<double>(n);
+
+    Bench::add("dotProduct/QuantisedMat" + suffix + "xDynVec", [m, k](size_t iterations) {
+        LA::DynMat<float> weights(m, k);
+        LA::DynVec<float> x(k);
+        Bench::fillRandom(weights);
+        Bench::fillRandom(x);
+        const LA::QuantisedMat<float> quantised(weights);
+        Bench::resetTimer();
+        for (size_t i = 0; i < iterations; ++i) {
+            Bench::clobberMemory();
+            auto y = LA::dotProduct(quantised, x);
+            Bench::doNotOptimize(y.data()[0]);
+        }
+    }, 2.0 * rows * depth, rows * depth + (depth + rows) * sizeof(float));
+
+    Bench::add("QuantisedMat" + suffix + "xDynMat<" + std::to_string(n) + ">", [m, k, n](size_t iterations) {
+        LA::DynMat<float> weights(m, k);
+        LA::DynMat<float> b(k, n);
+        Bench::fillRandom(weights);
+        Bench::fillRandom(b);
+        const LA::QuantisedMat<float> quantised(weights);
+        Bench::resetTimer();
+        for (size_t i = 0; i < iterations; ++i) {
+            Bench::clobberMemory();
+            auto c = quantised * b;
+            Bench::doNotOptimize(c.data()[0]);
+        }
+    }, 2.0 * rows * depth * cols, rows * depth + (depth * cols + rows * cols) * sizeof(float));
+
+    Bench::add("DynMat" + suffix + "xDynMat<" + std::to_string(n) + ">", [m, k, n](size_t iterations) {
+        LA::DynMat<float> a(m, k);
+        LA::DynMat<float> b(k, n);
+        Bench::fillRandom(a);
+        Bench::fillRandom(b);
+        Bench::resetTimer();
+        for (size_t i = 0; i < iterations; ++i) {
+            Bench::clobberMemory();
+            auto c = a * b;
+            Bench::doNotOptimize(c.data()[0]);
+        }
+    }, 2.0 * rows * depth * cols, (rows * depth + depth * cols + rows * cols) * sizeof(float));
+}
+
+template <typename T>
+void addHalfPrecisionBenchmarks(const std::string& type, size_t m, size_t k)
+{
+    const std::string suffix = "<" + type + "," + std::to_string(m) + "x" + std::to_string(k) + ">";
+    const double rows = static_cast<double>(m);
+    const double depth = static_cast<double>(k);
+
+    Bench::add("dotProduct/DynMat" + suffix + "xDynVec", [m, k](size_t iterations) {
+        LA::DynMat<T> weights(m, k);
+        LA::DynVec<T> x(k);
+        Bench::fillRandom(weights);
+        Bench::fillRandom(x);
+        Bench::resetTimer();
+        for (size_t i = 0; i < iterations; ++i) {
+            Bench::clobberMemory();
+            auto y = LA::dotProduct(weights, x);
+            Bench::doNotOptimize(y.data()[0]);
+        }
+    }, 2.0 * rows * depth, (rows * depth + depth + rows) * sizeof(T));
+
+    constexpr size_t N = 512;
+    Bench::add("DynMat<" + type + "," + std::to_string(N) + ">xDynMat", [](size_t iterations) {
+        LA::DynMat<T> a(N, N);
+        LA::DynMat<T> b(N, N);
+        Bench::fillRandom(a);
+        Bench::fillRandom(b);
+        Bench::resetTimer();
+        for (size_t i = 0; i < iterations; ++i) {
+            Bench::clobberMemory();
+            auto c = a * b;
+            Bench::doNotOptimize(c.data()[0]);
+        }
+    }, 2.0 * N * N * N, 3.0 * N * N * sizeof(T));
+
+    if constexpr (Math::HalfPrecision<T>) {
+        Bench::add("convert/float->" + type + suffix, [m, k](size_t iterations) {
+            std::vector<float> from(m * k);
+            std::vector<T> to(m * k);
+            Bench::fillRandom(from);
+            Bench::resetTimer();
+            for (size_t i = 0; i < iterations; ++i) {
+                Bench::clobberMemory();
+                Math::convert(std::span<const float>(from), std::span<T>(to));
+                Bench::doNotOptimize(to[0]);
+            }
+        }, rows * depth, rows * depth * (sizeof(float) + sizeof(T)));
+
+        Bench::add("convert/" + type + "->float" + suffix, [m, k](size_t iterations) {
+            std::vector<T> from(m * k);
+            std::vector<float> to(m * k);
+            Bench::fillRandom(from);
+            Bench::resetTimer();
+            for (size_t i = 0; i < iterations; ++i) {
+                Bench::clobberMemory();
+                Math::convert(std::span<const T>(from), std::span<float>(to));
+                Bench::doNotOptimize(to[0]);
+            }
+        }, rows * depth, rows * depth * (sizeof(float) + sizeof(T)));
+    }
+}
+
+void addSimilarityBenchmarks()
+{
+    static constexpr size_t DATABASE = 1 << 15;
+    static constexpr size_t DIMENSION = 128;
+    static constexpr size_t QUERIES = 256;
+    static constexpr size_t K = 10;
+    const double flops = 2.0 * DATABASE * DIMENSION * QUERIES;
+
+    Bench::add("topK/naive<32768x128,256,10>", [](size_t iterations) {
+        std::vector<LA::Vec<DIMENSION>> database(DATABASE), queries(QUERIES);
+        for (auto& vec : database) {
+            Bench::fillRandom(vec);
+        }
+        for (auto& vec : queries) {
+            Bench::fillRandom(vec);
+        }
+        std::vector<std::pair<float, size_t>> scores(DATABASE);
+        Bench::resetTimer();
+        for (size_t i = 0; i < iterations; ++i) {
+            for (const auto& query : queries) {
+                for (size_t j = 0; j < DATABASE; ++j) {
+                    scores[j] = { LA::dotProduct(query, database[j]) / (query.getLength() * database[j].getLength()), j };
+                }
+                std::partial_sort(scores.begin(), scores.begin() + K, scores.end(), std::greater {});
+                Bench::doNotOptimize(scores.data()[0]);
+            }
+        }
+    }, flops, 0, QUERIES);
+
+    auto addTopK = [&](const std::string& name, auto policy) {
+        Bench::add("topK/SimilarityIndex<32768x128,256,10>" + name, [policy](size_t iterations) {
+            LA::DynMat<float> database(DATABASE, DIMENSION), queries(QUERIES, DIMENSION);
+            Bench::fillRandom(database);
+            Bench::fillRandom(queries);
+            const LA::SimilarityIndex<float> index(std::move(database));
+            Bench::resetTimer();
+            for (size_t i = 0; i < iterations; ++i) {
+                auto neighbours = index.topK(policy, queries, K, LA::Similarity::Cosine);
+                Bench::doNotOptimize(neighbours.data()[0]);
+            }
+        }, flops, 0, QUERIES);
+    };
+    addTopK("", std::execution::seq);
+    addTopK("/par", std::execution::par);
+}
+
+template <size_t COUNT>
+void addSoABenchmarks()
+{
+    const std::string suffix = "<" + std::to_string(COUNT) + ">";
+
+    Bench::add("normalise/AoS" + suffix, [](size_t iterations) {
+        std::vector<LA::Vec<3>> in(COUNT, LA::Vec<3> { 1, 2, 3 }), out(COUNT);
+        Bench::resetTimer();
+        for (size_t i = 0; i < iterations; ++i) {
+            Bench::clobberMemory();
+            for (size_t j = 0; j < COUNT; ++j) {
+                out[j] = in[j].getNormalised();
+            }
+            Bench::doNotOptimize(out.data()[0]);
+        }
+    }, 9.0 * COUNT, 2.0 * COUNT * sizeof(LA::Vec<3>), COUNT);
+
+    Bench::add("normalise/SoAVec" + suffix, [](size_t iterations) {
+        LA::SoAVec<3> in(COUNT, LA::Vec<3> { 1, 2, 3 }), out(COUNT);
+        Bench::resetTimer();
+        for (size_t i = 0; i < iterations; ++i) {
+            Bench::clobberMemory();
+            LA::normalise(in, out);
+            Bench::doNotOptimize(out.component(0)[0]);
+        }
+    }, 9.0 * COUNT, 2.0 * COUNT * sizeof(LA::Vec<3>), COUNT);
+
+    Bench::add("add/SoAVec" + suffix, [](size_t iterations) {
+        LA::SoAVec<3> a(COUNT, LA::Vec<3> { 1, 2, 3 }), b(COUNT, LA::Vec<3> { 4, 5, 6 }), out(COUNT);
+        Bench::resetTimer();
+        for (size_t i = 0; i < iterations; ++i) {
+            Bench::clobberMemory();
+            LA::add(a, b, out);
+            Bench::doNotOptimize(out.component(0)[0]);
+        }
+    }, 3.0 * COUNT, 3.0 * COUNT * sizeof(LA::Vec<3>), COUNT);
+
+    Bench::add("length/SoAVec" + suffix, [](size_t iterations) {
+        LA::SoAVec<3> a(COUNT, LA::Vec<3> { 1, 2, 3 });
+        std::vector<float> lengths(COUNT);
+        Bench::resetTimer();
+        for (size_t i = 0; i < iterations; ++i) {
+            Bench::clobberMemory();
+            LA::length(a, std::span<float>(lengths));
+            Bench::doNotOptimize(lengths.data()[0]);
+        }
+    }, 6.0 * COUNT, (sizeof(LA::Vec<3>) + sizeof(float)) * COUNT, COUNT);
+
+    Bench::add("SoAVec" + suffix + "/fromAoS", [](size_t iterations) {
+        std::vector<LA::Vec<3>> in(COUNT, LA::Vec<3> { 1, 2, 3 });
+        Bench::resetTimer();
+        for (size_t i = 0; i < iterations; ++i) {
+            Bench::clobberMemory();
+            LA::SoAVec<3> soa { std::span<const LA::Vec<3>>(in) };
+            Bench::doNotOptimize(soa.component(0)[0]);
+        }
+    }, 0, 2.0 * COUNT * sizeof(LA::Vec<3>), COUNT);
+}
+
+template <size_t N>
+void addSolverBenchmarks()
+{
+    const std::string suffix = "<" + std::to_string(N) + "x" + std::to_string(N) + ">";
+    constexpr double SIZE = static_cast<double>(N);
+
+    Bench::add("LUDecomposition" + suffix, [](size_t iterations) {
+        auto a = std::make_unique<LA::Mat<N, N>>();
+        Bench::fillRandom(*a);
+        auto lu = std::make_unique<LA::LUDecomposition<N, float>>(*a);
+        Bench::resetTimer();
+        for (size_t i = 0; i < iterations; ++i) {
+            Bench::clobberMemory();
+            *lu = LA::LUDecomposition<N, float>(*a);
+            Bench::doNotOptimize(lu->getLU().data[0]);
+        }
+    }, 2.0 / 3.0 * SIZE * SIZE * SIZE);
+
+    Bench::add("inverse" + suffix, [](size_t iterations) {
+        auto a = std::make_unique<LA::Mat<N, N>>();
+        Bench::fillRandom(*a);
+        auto inverse = std::make_unique<LA::Mat<N, N>>();
+        Bench::resetTimer();
+        for (size_t i = 0; i < iterations; ++i) {
+            Bench::clobberMemory();
+            *inverse = LA::inverse(*a);
+            Bench::doNotOptimize(inverse->data[0]);
+        }
+    });
+
+    Bench::add("solve" + suffix, [](size_t iterations) {
+        auto a = std::make_unique<LA::Mat<N, N>>();
+        LA::Vec<N> b;
+        Bench::fillRandom(*a);
+        Bench::fillRandom(b);
+        Bench::resetTimer();
+        for (size_t i = 0; i < iterations; ++i) {
+            Bench::clobberMemory();
+            auto x = LA::solve(*a, b);
+            Bench::doNotOptimize(x);
+        }
+    }, 2.0 / 3.0 * SIZE * SIZE * SIZE + 2.0 * SIZE * SIZE);
+}
+
+void addGeometryBenchmarks()
+{
+    Bench::add("intersectionDist/Ray,Sphere3D", [](size_t iterations) {
+        LA::Ray<3> ray { LA::Pos<3> { 0, 0, -5 }, LA::Vec<3> { 0.01f, 0.02f, 1 } };
+        LA::Sphere3D<float> sphere { LA::Pos<3> { 0, 0, 0 }, 1 };
+        Bench::resetTimer();
+        for (size_t i = 0; i < iterations; ++i) {
+            Bench::doNotOptimize(ray);
+            auto distance = LA::intersectionDist(ray, sphere);
+            Bench::doNotOptimize(distance);
+        }
+    });
+
+    Bench::add("intersectionDist/Ray,Triangle3D", [](size_t iterations) {
+        LA::Ray<3> ray { LA::Pos<3> { 0.2f, 0.2f, -5 }, LA::Vec<3> { 0, 0, 1 } };
+        LA::BakedTriangle3D<float> triangle { LA::Triangle3D<float> { LA::Pos<3> { 0, 0, 0 }, LA::Pos<3> { 1, 0, 0 }, LA::Pos<3> { 0, 1, 0 } } };
+        Bench::resetTimer();
+        for (size_t i = 0; i < iterations; ++i) {
+            Bench::doNotOptimize(ray);
+            auto distance = LA::intersectionDist(ray, triangle);
+            Bench::doNotOptimize(distance);
+        }
+    });
+
+    constexpr size_t RAYS = 1024;
+    Bench::add("intersectionDist/RayPacket3D<1024>,Sphere3D", [](size_t iterations) {
+        std::vector<float> ox(RAYS), oy(RAYS), oz(RAYS, -5.0f), dx(RAYS), dy(RAYS), dz(RAYS, 1.0f), distances(RAYS);
+        Bench::fillRandom(ox);
+        Bench::fillRandom(oy);
+        LA::RayPacket3D<float> rays { ox, oy, oz, dx, dy, dz };
+        LA::Sphere3D<float> sphere { LA::Pos<3> { 0, 0, 0 }, 1 };
+        Bench::resetTimer();
+        for (size_t i = 0; i < iterations; ++i) {
+            Bench::clobberMemory();
+            LA::intersectionDist(rays, sphere, std::span<float>(distances));
+            Bench::doNotOptimize(distances.data()[0]);
+        }
+    }, 0, 7.0 * RAYS * sizeof(float), RAYS);
+
+    constexpr size_t POINTS = 1 << 20;
+    Bench::add("transformPoints<1M>", [](size_t iterations) {
+        std::vector<LA::Pos<3>> in(POINTS), out(POINTS);
+        const auto transform = LA::Affine3<float>::fromTranslation(LA::Vec<3> { 1, 2, 3 }) * LA::Affine3<float>::fromScale(2.0f);
+        Bench::resetTimer();
+        for (size_t i = 0; i < iterations; ++i) {
+            Bench::clobberMemory();
+            LA::transformPoints(transform, std::span<const LA::Pos<3>>(in), std::span<LA::Pos<3>>(out));
+            Bench::doNotOptimize(out.data()[0]);
+        }
+    }, 18.0 * POINTS, 2.0 * POINTS * sizeof(LA::Pos<3>), POINTS);
+
+    Bench::add("transformPoints<1M>/par", [](size_t iterations) {
+        std::vector<LA::Pos<3>> in(POINTS), out(POINTS);
+        const auto transform = LA::Affine3<float>::fromTranslation(LA::Vec<3> { 1, 2, 3 }) * LA::Affine3<float>::fromScale(2.0f);
+        Bench::resetTimer();
+        for (size_t i = 0; i < iterations; ++i) {
+            Bench::clobberMemory();
+            LA::transformPoints(std::execution::par, transform, std::span<const LA::Pos<3>>(in), std::span<LA::Pos<3>>(out));
+            Bench::doNotOptimize(out.data()[0]);
+        }
+    }, 18.0 * POINTS, 2.0 * POINTS * sizeof(LA::Pos<3>), POINTS);
+
+    Bench::add("Quat/multiply", [](size_t iterations) {
+        LA::Quat<float> a { 0.9f, 0.1f, 0.2f, 0.3f };
+        LA::Quat<float> b { 0.5f, 0.5f, -0.5f, 0.5f };
+        Bench::resetTimer();
+        for (size_t i = 0; i < iterations; ++i) {
+            Bench::doNotOptimize(a);
+            auto c = a * b;
+            Bench::doNotOptimize(c);
+        }
+    }, 28);
+
+    Bench::add("Quat/rotate", [](size_t iterations) {
+        const LA::Quat<float> q = LA::Quat<float> { 0.9f, 0.1f, 0.2f, 0.3f }.getNormalised();
+        LA::Vec<3> v { 1, 2, 3 };
+        Bench::resetTimer();
+        for (size_t i = 0; i < iterations; ++i) {
+            Bench::doNotOptimize(v);
+            LA::Vec<3> rotated = q.rotate(v);
+            Bench::doNotOptimize(rotated);
+        }
+    }, 18);
+
+    Bench::add("Quat/slerp", [](size_t iterations) {
+        const LA::Quat<float> a = LA::Quat<float> { 0.9f, 0.1f, 0.2f, 0.3f }.getNormalised();
+        const LA::Quat<float> b = LA::Quat<float> { 0.5f, 0.5f, -0.5f, 0.5f }.getNormalised();
+        float t = 0.3f;
+        Bench::resetTimer();
+        for (size_t i = 0; i < iterations; ++i) {
+            Bench::doNotOptimize(t);
+            auto c = LA::slerp(a, b, t);
+            Bench::doNotOptimize(c);
+        }
+    });
+
+    constexpr size_t VECTORS = 1 << 16;
+    Bench::add("rotate<64K>", [](size_t iterations) {
+        std::vector<LA::Vec<3>> in(VECTORS), out(VECTORS);
+        const LA::Quat<float> q = LA::Quat<float> { 0.9f, 0.1f, 0.2f, 0.3f }.getNormalised();
+        Bench::resetTimer();
+        for (size_t i = 0; i < iterations; ++i) {
+            Bench::clobberMemory();
+            LA::rotate(q, std::span<const LA::Vec<3>>(in), std::span<LA::Vec<3>>(out));
+            Bench::doNotOptimize(out.data()[0]);
+        }
+    }, 15.0 * VECTORS, 2.0 * VECTORS * sizeof(LA::Vec<3>), VECTORS);
+
+    Bench::add("rotate<64K>/per-element", [](size_t iterations) {
+        std::vector<LA::Quat<float>> rotations(VECTORS, LA::Quat<float> { 0.9f, 0.1f, 0.2f, 0.3f }.getNormalised());
+        std::vector<LA::Vec<3>> in(VECTORS), out(VECTORS);
+        Bench::resetTimer();
+        for (size_t i = 0; i < iterations; ++i) {
+            Bench::clobberMemory();
+            LA::rotate(std::span<const LA::Quat<float>>(rotations), std::span<const LA::Vec<3>>(in), std::span<LA::Vec<3>>(out));
+            Bench::doNotOptimize(out.data()[0]);
+        }
+    }, 18.0 * VECTORS, (sizeof(LA::Quat<float>) + 2.0 * sizeof(LA::Vec<3>)) * VECTORS, VECTORS);
+}
+
+template <Math::Precision PRECISION>
+void addTrigBenchmark(const std::string& name)
+{
+    constexpr size_t COUNT = 4096;
+    Bench::add("sincos<4096>/" + name, [](size_t iterations) {
+        std::vector<float> input(COUNT), sin(COUNT), cos(COUNT);
+        Bench::fillRandom(input, -100, 100);
+        Bench::resetTimer();
+        for (size_t i = 0; i < iterations; ++i) {
+            Bench::clobberMemory();
+            Math::sincos<PRECISION>(std::span<const float>(input), std::span<float>(sin), std::span<float>(cos));
+            Bench::doNotOptimize(sin.data()[0]);
+        }
+    }, 0, 3.0 * COUNT * sizeof(float), COUNT);
+
+    Bench::add("getRotationMat3x3/" + name, [](size_t iterations) {
+        Bench::resetTimer();
+        for (size_t i = 0; i < iterations; ++i) {
+            // A new set of angles every iteration so nothing is hoisted.
+            const float angle = static_cast<float>(i & 1023) * 1e-2f;
+            auto rotation = LA::getRotationMat3x3<float, PRECISION>(angle, 0.5f * angle, 2.0f * angle);
+            Bench::doNotOptimize(rotation);
+        }
+    });
+}
+
+void addTrigBenchmarks()
+{
+    addTrigBenchmark<Math::Precision::Fast>("Fast");
+    addTrigBenchmark<Math::Precision::Medium>("Medium");
+    addTrigBenchmark<Math::Precision::Exact>("Exact");
+}
+
+template <typename F>
+void addActivationBenchmark(const std::string& name, const F& activation = {})
+{
+    constexpr size_t COUNT = 4096;
+    Bench::add("Activation/" + name + "<4096>", [activation](size_t iterations) {
+        std::vector<float> input(COUNT), output(COUNT);
+        Bench::fillRandom(input, -8, 8);
+        Bench::resetTimer();
+        for (size_t i = 0; i < iterations; ++i) {
+            Bench::clobberMemory();
+            Act::apply(activation, std::span<const float>(input), std::span<float>(output));
+            Bench::doNotOptimize(output.data()[0]);
+        }
+    }, 0, 2.0 * COUNT * sizeof(float), COUNT);
+}
+
+void addActivationBenchmarks()
+{
+    addActivationBenchmark<Act::ReLU>("ReLU");
+    addActivationBenchmark<Act::Sigmoid>("Sigmoid");
+    addActivationBenchmark<Act::GELU>("GELU");
+    addActivationBenchmark<Act::SiLU>("SiLU");
+    addActivationBenchmark<Act::Tanh>("Tanh");
+    addActivationBenchmark<Act::Softplus>("Softplus");
+
+    static constexpr Act::LookupTable<Act::Sigmoid, 1024> SIGMOID_TABLE(-8.f, 8.f);
+    static constexpr Act::LookupTable<Act::Softplus, 1024> SOFTPLUS_TABLE(-8.f, 8.f);
+    static constexpr Act::LookupTable<Act::Tanh, 1024> TANH_TABLE(-4.f, 4.f);
+    addActivationBenchmark("LookupTable<Sigmoid, 1024>", SIGMOID_TABLE);
+    addActivationBenchmark("LookupTable<Softplus, 1024>", SOFTPLUS_TABLE);
+    addActivationBenchmark("LookupTable<Tanh, 1024>", TANH_TABLE);
+
+    Bench::add("dense<256x256>/ReLU", [](size_t iterations) {
+        auto weights = std::make_unique<LA::Mat<256, 256>>();
+        LA::Vec<256> input, bias;
+        Bench::fillRandom(*weights);
+        Bench::fillRandom(input);
+        Bench::fillRandom(bias);
+        Bench::resetTimer();
+        for (size_t i = 0; i < iterations; ++i) {
+            Bench::clobberMemory();
+            auto output = LA::dense(*weights, input, bias, Act::ReLU {});
+            Bench::doNotOptimize(output);
+        }
+    }, 2.0 * 256 * 256, (256.0 * 256 + 3 * 256) * sizeof(float));
+}
+
+void registerBenchmarks()
+{
+    addVecBenchmarks<3>();
+    addVecBenchmarks<4>();
+    addVecBenchmarks<8>();
+    addVecBenchmarks<64>();
+    addVecExpressionBenchmark<4096>();
+    addVecExpressionBenchmark<65536>();
+
+    addMatBenchmarks<4>();
+    addMatBenchmarks<16>();
+    addMatBenchmarks<64>();
+    addMatBenchmarks<256>();
+
+    addDynMatBenchmarks(128);
+    addDynMatBenchmarks(512);
+
+    addViewBenchmarks(512, 64);
+    addViewBenchmarks(2048, 128);
+
+    addLayoutBenchmarks<64>();
+    addLayoutBenchmarks<256>();
+    addLayoutBenchmarks<512>();
+
+    addReductionBenchmarks(1 << 16);
+    addReductionBenchmarks(1 << 24);
+
+    addSimilarityBenchmarks();
+
+    addSparseBenchmarks(4096, 40);
+    addSparseBenchmarks(1 << 18, 16);
+
+    addQuantisedBenchmarks(1024, 1024, 64);
+    addQuantisedBenchmarks(4096, 4096, 64);
+
+    addHalfPrecisionBenchmarks<float>("float", 4096, 4096);
+    addHalfPrecisionBenchmarks<Math::half>("half", 4096, 4096);
+    addHalfPrecisionBenchmarks<Math::bfloat16>("bfloat16", 4096, 4096);
+
+    addSoABenchmarks<1 << 16>();
+    addSoABenchmarks<1 << 22>();
+
+    addSolverBenchmarks<4>();
+    addSolverBenchmarks<8>();
+    addSolverBenchmarks<256>();
+
+    addGeometryBenchmarks();
+    addTrigBenchmarks();
+    addActivationBenchmarks();
+}
+
+Bench::Options parseOptions(int argc, char** argv)
+{
+    Bench::Options options;
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg = argv[i];
+        if (arg.starts_with("--format=")) {
+            options.format = arg.substr(std::strlen("--format="));
+        } else if (arg.starts_with("--filter=")) {
+            options.filter = arg.substr(std::strlen("--filter="));
+        } else if (arg.starts_with("--min-time=")) {
+            options.min_time = std::stod(std::string(arg.substr(std::strlen("--min-time="))));
+        } else {
+            std::cerr << "unknown option " << arg << '\n';
+        }
+    }
+    return options;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const Bench::Options options = parseOptions(argc, argv);
+    registerBenchmarks();
+
+    std::vector<Bench::Result> results;
+    for (const Bench::Benchmark& benchmark : Bench::registry()) {
+        if (benchmark.name.find(options.filter) != std::string::npos) {
+            results.push_back(Bench::measure(benchmark, options));
+        }
+    }
+
+    if (options.format == "csv") {
+        Bench::writeCsv(std::cout, results);
+    } else {
+        Bench::writeJson(std::cout, results);
+    }
+    return 0;
+}
@@ -1,12 +1,16 @@
 #include "Math.hpp"
 
 consteval void testLinearAlgebra();
+bool testRuntime();
 
 int main()
 {
     if consteval {
         testLinearAlgebra();
     }
+    if (!testRuntime()) {
+        return 1;
+    }
     
     namespace LA = Math::LinearAlgebra;
     LA::Quat<float> q1 { Math::Degrees{120}, Math::Degrees{40}, Math::Degrees{20} };
@@ -200,6 +204,283 @@ consteval bool testMatVecOps()
     return has_passed;
 }
 
+consteval bool testTriangleOps()
+{
+    using namespace Math::LinearAlgebra;
+    bool has_passed = true;
+
+    { // Cross product
+        Vec<3, float> x { 1, 0, 0 };
+        Vec<3, float> y { 0, 1, 0 };
+        Vec<3, float> z { 0, 0, 1 };
+        has_passed &= z == crossProduct(x, y);
+        has_passed &= -z == crossProduct(y, x);
+    }
+
+    { // Hit through the middle of the triangle
+        Triangle3D<float> triangle { { 0, 0, 5 }, { 2, 0, 5 }, { 0, 2, 5 } };
+        Ray<3, float> ray { { 0.5f, 0.5f, 0 }, { 0, 0, 1 } };
+        TriangleHit<float> hit = intersectionBarycentric(ray, triangle);
+        has_passed &= hit.distance == 5.0f;
+        has_passed &= hit.u == 0.25f && hit.v == 0.25f;
+        has_passed &= intersectionDist(ray, BakedTriangle3D<float> { triangle }) == 5.0f;
+    }
+
+    { // Misses: outside the edges and behind the ray
+        Triangle3D<float> triangle { { 0, 0, 5 }, { 2, 0, 5 }, { 0, 2, 5 } };
+        Ray<3, float> outside { { 1.5f, 1.5f, 0 }, { 0, 0, 1 } };
+        Ray<3, float> behind { { 0.5f, 0.5f, 0 }, { 0, 0, -1 } };
+        has_passed &= intersectionDist(outside, triangle) == 0.0f;
+        has_passed &= intersectionDist(behind, triangle) == 0.0f;
+    }
+
+    return has_passed;
+}
+
+consteval bool testAffineOps()
+{
+    using namespace Math::LinearAlgebra;
+    bool has_passed = true;
+    {
+        Affine3<float> translate = Affine3<float>::fromTranslation(Vec<3> { 1, 2, 3 });
+        Affine3<float> rotate = Affine3<float>::fromRotation(Mat<3, 3>({ { 0, -1, 0 }, { 1, 0, 0 }, { 0, 0, 1 } }));
+        Affine3<float> scale = Affine3<float>::fromScale(2.0f);
+        Affine3<float> transform = translate * rotate * scale;
+
+        has_passed &= transform.transformPoint(Pos<3> { 1, 0, 0 }) == Pos<3> { 1, 4, 3 };
+        has_passed &= transform.transformVec(Vec<3> { 1, 0, 0 }) == Vec<3> { 0, 2, 0 };
+        has_passed &= (translate * rotate) * (translate * rotate).getRigidInverse() == Affine3<float>();
+        has_passed &= transform * transform.getInverse() == Affine3<float>();
+        has_passed &= Affine3<float>(static_cast<Mat<4, 4>>(transform)) == transform;
+    }
+    return has_passed;
+}
+
+consteval bool testLUOps()
+{
+    using namespace Math::LinearAlgebra;
+    bool has_passed = true;
+    {
+        Mat<3, 3> mat({ { 2, 1, 1 }, { 4, -6, 0 }, { -2, 7, 2 } });
+        LUDecomposition<3, float> lu(mat);
+        has_passed &= !lu.isSingular();
+        has_passed &= lu.determinant() == -16.0f;
+        has_passed &= determinant(mat) == -16.0f;
+        has_passed &= solve(mat, Vec<3> { 5, -2, 9 }) == Vec<3> { 1, 1, 2 };
+        has_passed &= mat * inverse(mat) == Mat<3, 3>({ { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } });
+    }
+    {
+        Mat<4, 4> mat({ { 1, 0, 2, -1 }, { 3, 0, 0, 5 }, { 2, 1, 4, -3 }, { 1, 0, 5, 0 } });
+        has_passed &= determinant(mat) == 30.0f;
+        has_passed &= LUDecomposition<4, float>(mat).determinant() == 30.0f;
+        has_passed &= inverse(mat) == LUDecomposition<4, float>(mat).inverse();
+        has_passed &= mat * inverse(mat) == Mat<4, 4>({ { 1, 0, 0, 0 }, { 0, 1, 0, 0 }, { 0, 0, 1, 0 }, { 0, 0, 0, 1 } });
+    }
+    {
+        Mat<5, 5> mat({ { 2, 0, 0, 0, 0 }, { 0, 3, 0, 0, 0 }, { 0, 0, 1, 0, 0 }, { 0, 0, 0, 4, 0 }, { 1, 0, 0, 0, 1 } });
+        has_passed &= determinant(mat) == 24.0f;
+        Mat<3, 3> singular({ { 1, 2, 3 }, { 2, 4, 6 }, { 1, 0, 1 } });
+        has_passed &= LUDecomposition<3, float>(singular).isSingular();
+    }
+    return has_passed;
+}
+
+consteval bool testExpressionOps()
+{
+    using namespace Math::LinearAlgebra;
+    bool has_passed = true;
+    {
+        Vec<5> a { 1, 2, 3, 4, 5 };
+        Vec<5> b { 5, 4, 3, 2, 1 };
+        Vec<5> c { 1, 1, 1, 1, 1 };
+
+        Vec<5> result = a + b * 2.0f - c;
+        has_passed &= result == Vec<5> { 10, 9, 8, 7, 6 };
+        result += a;
+        has_passed &= result == Vec<5> { 11, 11, 11, 11, 11 };
+        result = result - a * 2;
+        has_passed &= result == Vec<5> { 9, 7, 5, 3, 1 };
+        has_passed &= -a == Vec<5> { -1, -2, -3, -4, -5 };
+        has_passed &= (a + b)[2] == 6;
+        has_passed &= dotProduct(a - c, c) == 10;
+    }
+    {
+        Mat<2, 2> a({ { 1, 2 }, { 3, 4 } });
+        Mat<2, 2> b({ { 1, 1 }, { 1, 1 } });
+        Mat<2, 2> result = a + b * 2 - a / 2.0f;
+        has_passed &= result == Mat<2, 2>({ { 2.5f, 3 }, { 3.5f, 4 } });
+    }
+    return has_passed;
+}
+
+consteval bool testDenseOps()
+{
+    namespace LA = Math::LinearAlgebra;
+    bool has_passed = true;
+    {
+        LA::Mat<2, 3, float> weights({ { 1, 2, 3 }, { -4, -5, -6 } });
+        LA::Vec<2, float> bias { 1, 1 };
+        LA::Vec<3, float> input { 1, 2, 3 };
+        LA::Mat<2, 3, float> inputs({ { 1, 2, 3 }, { -1, -1, -1 } });
+
+        has_passed &= LA::Vec<2, float> { 15, -31 } == LA::dense(weights, input, bias);
+        has_passed &= LA::Vec<2, float> { 15, 0 } == LA::dense(weights, input, bias, Math::Activation::ReLU {});
+        has_passed &= LA::Mat<2, 2, float>({ { 15, 0 }, { 0, 16 } }) == LA::dense(weights, inputs, bias, Math::Activation::ReLU {});
+    }
+    return has_passed;
+}
+
+consteval bool testLookupTableOps()
+{
+    namespace Act = Math::Activation;
+    bool has_passed = true;
+    {
+        constexpr Act::LookupTable<Act::Sigmoid, 257> sigmoid(-8.f, 8.f);
+        has_passed &= sigmoid(0.f) == 0.5f;
+        has_passed &= sigmoid(1.f) == Act::sigmoid(1.f);
+        has_passed &= sigmoid(-100.f) == Act::sigmoid(-8.f);
+        has_passed &= sigmoid(100.f) == Act::sigmoid(8.f);
+        // Halfway between two samples is within the interpolation error of the curve.
+        const float between = sigmoid(1.03125f) - Act::sigmoid(1.03125f);
+        has_passed &= between < 1e-4f && between > -1e-4f;
+    }
+    {
+        constexpr Act::LookupTable<Act::Tanh, 5> tanh(-2.f, 2.f);
+        has_passed &= tanh(0.f) == 0.f;
+        has_passed &= tanh(-2.f) == -tanh(2.f);
+        has_passed &= tanh(0.5f) == tanh.samples[3] / 2;
+    }
+    return has_passed;
+}
+
+consteval bool testHalfPrecisionOps()
+{
+    using namespace Math::LinearAlgebra;
+    using Math::bfloat16;
+    using Math::half;
+    bool has_passed = true;
+
+    { // Conversions round to nearest even
+        has_passed &= half(1.f).bits == 0x3c00 && bfloat16(1.f).bits == 0x3f80;
+        has_passed &= half(65504.f).bits == 0x7bff && half(65520.f).bits == 0x7c00;
+        has_passed &= half(1.f + 0x1p-11f).bits == 0x3c00 && half(1.f + 0x1p-11f + 0x1p-12f).bits == 0x3c01;
+        has_passed &= static_cast<float>(half::fromBits(0x0001)) == 0x1p-24f;
+        has_passed &= half(0x1p-25f).bits == 0 && half(-0x1p-24f).bits == 0x8001;
+        has_passed &= static_cast<float>(bfloat16(3.14159265f)) == 3.140625f;
+        has_passed &= Math::Constexpr::isNaN(static_cast<float>(half(std::numeric_limits<float>::quiet_NaN())));
+    }
+
+    { // Vec and Mat store 16 bits and accumulate in float
+        Vec<3, half> v { 1, 2, 2 };
+        has_passed &= v.getLength() == half(3.f);
+        has_passed &= dotProduct(v, v) == half(9.f);
+        has_passed &= v * 2.f == Vec<3, half> { 2, 4, 4 };
+        has_passed &= v != Vec<3, half> { 1, 2, 2.01f };
+
+        Vec<2, half> large { 300, 400 };
+        has_passed &= large.getLength() == half(500.f);
+
+        // 2048 + 1 + 1 rounds to 2048 in half at every step, in float it is 2050.
+        Mat<1, 3, half> a { { 2048, 1, 1 } };
+        Mat<3, 1, half> b { { 1 }, { 1 }, { 1 } };
+        has_passed &= (a * b)[0][0] == 2050.f;
+        has_passed &= dotProduct(a, Vec<3, half> { 1, 1, 1 })[0] == 2050.f;
+
+        Mat<2, 2, bfloat16> m { { 1, 2 }, { 3, 4 } };
+        has_passed &= m * m == Mat<2, 2, bfloat16> { { 7, 10 }, { 15, 22 } };
+    }
+    return has_passed;
+}
+
+consteval bool testViewOps()
+{
+    using namespace Math::LinearAlgebra;
+    bool has_passed = true;
+
+    { // Blocks, rows, columns, the diagonal and the transpose share storage
+        Mat<3, 3> mat { { 1, 2, 3 }, { 4, 5, 6 }, { 7, 8, 9 } };
+        MatView view(mat);
+        has_passed &= static_cast<Mat<2, 2>>(view.block(1, 1, 2, 2)) == Mat<2, 2> { { 5, 6 }, { 8, 9 } };
+        has_passed &= static_cast<Mat<3, 3>>(transpose(view)) == transpose(mat);
+        has_passed &= static_cast<Vec<3>>(view.diagonal()) == Vec<3> { 1, 5, 9 };
+        has_passed &= static_cast<Vec<3>>(view.col(1)) == Vec<3> { 2, 5, 8 };
+        has_passed &= static_cast<Vec<2>>(view.row(2).slice(0, 2, 2)) == Vec<2> { 7, 9 };
+        has_passed &= view.transposed()[0][2] == 7;
+
+        view.block(0, 0, 2, 2) *= 2;
+        view.col(2) -= VecView<const float>(view.col(0));
+        has_passed &= mat == Mat<3, 3> { { 2, 4, 1 }, { 8, 10, -2 }, { 7, 8, 2 } };
+    }
+
+    { // dotProduct and products read through the strides
+        const Mat<2, 3> a { { 1, 2, 3 }, { 4, 5, 6 } };
+        MatView<const float> view(a);
+        has_passed &= dotProduct(view.row(0), view.row(1)) == 32.f;
+        has_passed &= dotProduct(view.col(0), VecView<const float>(Vec<2> { 1, 1 })) == 5.f;
+
+        Mat<2, 2> c { { 1, 0 }, { 0, 1 } };
+        multiplyAdd(view, view.transposed(), MatView(c));
+        has_passed &= c == Mat<2, 2> { { 15, 32 }, { 32, 78 } };
+        multiplySubtract(view, view.transposed(), MatView(c));
+        has_passed &= c == Mat<2, 2> { { 1, 0 }, { 0, 1 } };
+
+        Mat<3, 3> gram;
+        MatView(gram).fill(0);
+        multiplyAdd(transpose(view), view, MatView(gram));
+        has_passed &= gram == transpose(a) * a;
+    }
+    return has_passed;
+}
+
+consteval bool testLayoutOps()
+{
+    using namespace Math::LinearAlgebra;
+    bool has_passed = true;
+
+    { // Elements are addressed by (row, col) whatever the storage order
+        const Mat<2, 3> rows { { 1, 2, 3 }, { 4, 5, 6 } };
+        const Mat<2, 3, float, ColumnMajor> cols { { 1, 2, 3 }, { 4, 5, 6 } };
+        has_passed &= std::ranges::equal(cols.data, std::array<float, 6> { 1, 4, 2, 5, 3, 6 });
+        has_passed &= cols == rows && cols[1][0] == 4 && cols.at(0, 2) == 3;
+        has_passed &= Mat<2, 3>(cols) == rows;
+        has_passed &= transpose(cols) == transpose(rows);
+        has_passed &= MatView(cols).transposed()[2][1] == 6;
+
+        Mat<2, 3, float, ColumnMajor> sum = cols + cols * 2.f;
+        has_passed &= sum == Mat<2, 3>(rows * 3.f);
+    }
+
+    { // Tiles are contiguous blocks
+        Mat<4, 4, float, Tiled<2>> tiled;
+        for (size_t row = 0; row < 4; ++row) {
+            for (size_t col = 0; col < 4; ++col) {
+                tiled[row][col] = static_cast<float>(row * 4 + col);
+            }
+        }
+        has_passed &= std::ranges::equal(tiled.data, std::array<float, 16> { 0, 1, 4, 5, 2, 3, 6, 7, 8, 9, 12, 13, 10, 11, 14, 15 });
+        has_passed &= static_cast<Mat<2, 2>>(tiled.tile(1, 0)) == Mat<2, 2> { { 8, 9 }, { 12, 13 } };
+        has_passed &= static_cast<Mat<4, 4, float, Tiled<2>>>(MatView(Mat<4, 4>(tiled))) == tiled;
+    }
+
+    { // Products and dotProduct mix layouts
+        const Mat<2, 3> a { { 1, 2, 3 }, { 4, 5, 6 } };
+        const Mat<3, 2, float, ColumnMajor> b { { 1, 2 }, { 3, 4 }, { 5, 6 } };
+        const Mat<2, 2> expected { { 22, 28 }, { 49, 64 } };
+        has_passed &= a * b == expected;
+        has_passed &= b * a == Mat<3, 2>(b) * a;
+        has_passed &= Mat<2, 3, float, ColumnMajor>(a) * b == expected;
+        has_passed &= dotProduct(b, Vec<2> { 1, 1 }) == Vec<3> { 3, 7, 11 };
+        has_passed &= dotProduct(Vec<3> { 1, 1, 1 }, b) == Vec<2> { 9, 12 };
+        has_passed &= dotProduct(Vec<2> { 1, 1 }, a) == Vec<3> { 5, 7, 9 };
+
+        Mat<4, 4, float, Tiled<2>> tiled(Mat<4, 4> { { 1, 2, 3, 4 }, { 5, 6, 7, 8 }, { 9, 10, 11, 12 }, { 13, 14, 15, 16 } });
+        const Mat<4, 4> rows(tiled);
+        has_passed &= tiled * tiled == rows * rows;
+        has_passed &= dotProduct(tiled, Vec<4> { 1, 0, 1, 0 }) == dotProduct(rows, Vec<4> { 1, 0, 1, 0 });
+    }
+    return has_passed;
+}
+
 consteval bool testQuatOps()
 {
     using namespace Math::LinearAlgebra;
@@ -213,19 +494,73 @@ consteval bool testQuatOps()
         has_passed &= result.data == expected_result.data;
     }
 
-    {
-        // Test rotation constructor
-        // Quat<float> q1(0.2f, 0.3f, 0.4f);
-        // Quat<float> q2( 0.1262852, 0.1261165, 0.2100786, 0.9612563 );
-        // has_passed &= q1 == q2;
+    { // Test conjugate, inverse and normalisation
+        Quat<float> q(1, 2, 3, 4);
+        has_passed &= (q * q.getInverse()) == Quat<float>();
+        has_passed &= q.getConjugate() == Quat<float>(1, -2, -3, -4);
+        has_passed &= q.getVec() == Vec<3> { 2, 3, 4 };
+        has_passed &= q.getLengthSquared() == 30;
+        has_passed &= Quat<float>(0, 0, 0, 2).getNormalised() == Quat<float>(0, 0, 0, 1);
     }
 
-    { // Test quaternion rotation operations
-      // Quat<float> q1(1, 0, 0, 0);
-      // Vec<3> v1(1.f, 2.f, 3.f);
-      // Quat<float> q2(1, v1);
+    { // Test quaternion rotation operations, 90 degrees about z
+        constexpr float HALF_SQRT2 = 0.70710678f;
+        Quat<float> q(HALF_SQRT2, 0, 0, HALF_SQRT2);
+        Vec<3> v { 1.f, 2.f, 3.f };
+        has_passed &= q.rotate(v) == Vec<3> { -2.f, 1.f, 3.f };
+        has_passed &= q.rotate(v) == (q * Quat<float>(0, v) * q.getConjugate()).getVec();
+        has_passed &= q.toMat3x3() == Mat<3, 3>({ { 0, -1, 0 }, { 1, 0, 0 }, { 0, 0, 1 } });
+        has_passed &= Quat<float>().rotate(v) == v;
+    }
+
+    { // Test interpolation, halfway to 90 degrees about z is 45 degrees
+        constexpr float HALF_SQRT2 = 0.70710678f;
+        Quat<float> a;
+        Quat<float> b(HALF_SQRT2, 0, 0, HALF_SQRT2);
+        Quat<float> half(0.92387953f, 0, 0, 0.38268343f);
+        has_passed &= slerp(a, b, 0.f) == a;
+        has_passed &= slerp(a, b, 1.f) == b;
+        has_passed &= slerp(a, b, 0.5f) == half;
+        has_passed &= nlerp(a, b, 0.5f) == half;
+        Quat<float> negated_b(-HALF_SQRT2, 0, 0, -HALF_SQRT2);
+        has_passed &= slerp(a, negated_b, 0.5f) == half;
+    }
+
+    return has_passed;
+}
+
+consteval bool testElementaryOps()
+{
+    bool has_passed = true;
+    // Within 4 ULP of the correctly rounded double.
+    auto near = [](double value, double expected) {
+        const double tolerance = 4 * std::numeric_limits<double>::epsilon() * (expected < 0 ? -expected : expected);
+        return value - expected <= tolerance && expected - value <= tolerance;
+    };
 
-        // has_passed &= v1 == (q1 * q2).getVec();
+    { // sin, cos and tan including arguments far outside [-pi, pi]
+        has_passed &= near(Math::sin(1.0), 0.8414709848078965);
+        has_passed &= near(Math::cos(1.0), 0.5403023058681398);
+        has_passed &= near(Math::sin(100.0), -0.5063656411097588);
+        has_passed &= near(Math::cos(-1000.0), 0.5623790762907029);
+        has_passed &= near(Math::tan(2.0), -2.185039863261519);
+        has_passed &= Math::sin(100.0f) == -0.50636564f;
+        has_passed &= Math::sin(0.0) == 0.0 && Math::cos(0.0) == 1.0;
+    }
+    { // exp and log
+        has_passed &= near(Math::exp(1.0), 2.718281828459045);
+        has_passed &= near(Math::exp(-20.0), 2.061153622438558e-09);
+        has_passed &= near(Math::exp(700.0), 1.0142320547350045e+304);
+        has_passed &= near(Math::log(10.0), 2.302585092994046);
+        has_passed &= near(Math::log(1e-300), -690.7755278982137);
+        has_passed &= Math::exp(0.0) == 1.0 && Math::log(1.0) == 0.0;
+    }
+    { // atan and atan2 in every quadrant
+        has_passed &= near(Math::atan(0.5), 0.4636476090008061);
+        has_passed &= near(Math::atan(-3.0), -1.2490457723982544);
+        has_passed &= near(Math::atan2(1.0, -1.0), 2.356194490192345);
+        has_passed &= near(Math::atan2(-2.0, -1.0), -2.0344439357957027);
+        has_passed &= near(Math::atan2(1.0, 0.0), 1.5707963267948966);
     }
 
     return has_passed;
@@ -233,11 +568,850 @@ consteval bool testQuatOps()
 
 consteval void testLinearAlgebra()
 {
+    static_assert(testElementaryOps(), "Failed Elementary function operations");
     static_assert(testVecOps(), "Failed Vector operations");
     static_assert(testPosOps(), "Failed Position operations");
     static_assert(testRayOps(), "Failed Ray operations");
     static_assert(testMatOps(), "Failed Matrix operations");
     static_assert(testMatVecOps(), "Failed Matrix and Vector operations");
     static_assert(testMatRotOps(), "Failed Matrix rotation operations");
+    static_assert(testTriangleOps(), "Failed Triangle operations");
+    static_assert(testLUOps(), "Failed LU decomposition operations");
+    static_assert(testAffineOps(), "Failed Affine transform operations");
+    static_assert(testExpressionOps(), "Failed Expression operations");
+    static_assert(testDenseOps(), "Failed Dense layer operations");
+    static_assert(testLookupTableOps(), "Failed Activation lookup table operations");
+    static_assert(testHalfPrecisionOps(), "Failed 16 bit element operations");
+    static_assert(testViewOps(), "Failed Matrix and Vector view operations");
+    static_assert(testLayoutOps(), "Failed Matrix layout operations");
     static_assert(testQuatOps(), "Failed Quaternion operations");
 }
+
+/*
+    Runtime checks for the kernels behind `if !consteval` and the runtime only types, which the
+    static_asserts above never reach. Each is compared against a plain scalar reference.
+*/
+
+namespace {
+
+// Deterministic values in [-1, 1).
+template <typename Range>
+void fillPattern(Range& values, size_t seed = 1)
+{
+    uint64_t i = seed << 32;
+    for (auto& value : values) {
+        uint64_t bits = ++i * 0x9e3779b97f4a7c15;
+        bits = (bits ^ (bits >> 30)) * 0xbf58476d1ce4e5b9;
+        bits ^= bits >> 31;
+        value = static_cast<std::remove_reference_t<decltype(value)>>(static_cast<float>(bits >> 40) / 8388608.f - 1.f);
+    }
+}
+
+// Largest |a(row, col) - b(row, col)|, a and b index as a[row][col].
+template <typename A, typename B>
+float maxDifference(const A& a, const B& b, size_t rows, size_t cols)
+{
+    float difference = 0;
+    for (size_t row = 0; row < rows; ++row) {
+        for (size_t col = 0; col < cols; ++col) {
+            difference = std::max(difference, std::abs(static_cast<float>(a[row][col]) - static_cast<float>(b[row][col])));
+        }
+    }
+    return difference;
+}
+
+// a (m x k) * b (k x n) with double sums, the reference for the product kernels.
+template <typename A, typename B>
+std::vector<std::vector<double>> referenceProduct(const A& a, const B& b, size_t m, size_t n, size_t k)
+{
+    std::vector<std::vector<double>> c(m, std::vector<double>(n, 0.0));
+    for (size_t row = 0; row < m; ++row) {
+        for (size_t col = 0; col < n; ++col) {
+            for (size_t i = 0; i < k; ++i) {
+                c[row][col] += static_cast<double>(a[row][i]) * static_cast<double>(b[i][col]);
+            }
+        }
+    }
+    return c;
+}
+
+bool testGemmRuntime()
+{
+    using namespace Math::LinearAlgebra;
+    bool has_passed = true;
+
+    { // Odd sizes leave partial micro-kernel tiles on every edge
+        auto a = std::make_unique<Mat<67, 45>>();
+        auto b = std::make_unique<Mat<45, 71>>();
+        fillPattern(*a, 1);
+        fillPattern(*b, 2);
+        auto c = std::make_unique<Mat<67, 71>>(*a * *b);
+        has_passed &= maxDifference(*c, referenceProduct(*a, *b, 67, 71, 45), 67, 71) < 1e-4f;
+    }
+    { // k beyond one KC slice, C -= A * B
+        const size_t m = 37, n = 29, k = 300;
+        std::vector<float> a(m * k), b(k * n), c(m * n, 1.f);
+        fillPattern(a, 3);
+        fillPattern(b, 4);
+        Kernel::gemmSubtract<float>(m, n, k, { a.data(), k, 1 }, { b.data(), n, 1 }, { c.data(), n, 1 });
+        float difference = 0;
+        for (size_t row = 0; row < m; ++row) {
+            for (size_t col = 0; col < n; ++col) {
+                double expected = 1.0;
+                for (size_t i = 0; i < k; ++i) {
+                    expected -= static_cast<double>(a[row * k + i]) * b[i * n + col];
+                }
+                difference = std::max(difference, static_cast<float>(std::abs(c[row * n + col] - expected)));
+            }
+        }
+        has_passed &= difference < 1e-3f;
+    }
+    return has_passed;
+}
+
+bool testDynMatRuntime()
+{
+    using namespace Math::LinearAlgebra;
+    bool has_passed = true;
+
+    DynMat<float> a(53, 40), b(40, 61);
+    fillPattern(a, 5);
+    fillPattern(b, 6);
+    has_passed &= reinterpret_cast<uintptr_t>(a.data()) % 64 == 0;
+
+    const DynMat<float> c = a * b;
+    has_passed &= c.rows() == 53 && c.cols() == 61;
+    has_passed &= maxDifference(c, referenceProduct(a, b, 53, 61, 40), 53, 61) < 1e-4f;
+
+    DynVec<float> x(40);
+    fillPattern(x, 7);
+    const DynVec<float> y = dotProduct(a, x);
+    for (size_t row = 0; row < a.rows(); ++row) {
+        double expected = 0;
+        for (size_t col = 0; col < a.cols(); ++col) {
+            expected += static_cast<double>(a[row][col]) * x[col];
+        }
+        has_passed &= std::abs(y[row] - expected) < 1e-4;
+    }
+
+    // Moves leave an empty 0 x 0 matrix behind
+    DynMat<float> moved = std::move(a);
+    has_passed &= moved.rows() == 53 && a.rows() == 0 && a.cols() == 0 && a.size() == 0;
+    has_passed &= moved.clone() == moved;
+    return has_passed;
+}
+
+bool testThreadPoolRuntime()
+{
+    using namespace Math::LinearAlgebra;
+    bool has_passed = true;
+
+    { // Every index runs once, nested parallelFor calls do not deadlock
+        Math::Parallel::ThreadPool pool(4);
+        std::vector<std::atomic<int>> hits(64 * 8);
+        pool.parallelFor(64, [&](size_t i) {
+            pool.parallelFor(8, [&](size_t j) { hits[i * 8 + j]++; });
+        });
+        has_passed &= std::ranges::all_of(hits, [](const std::atomic<int>& hit) { return hit == 1; });
+    }
+    { // Parallel products match the scalar reference
+        auto a = std::make_unique<Mat<96, 80>>();
+        auto b = std::make_unique<Mat<80, 72>>();
+        fillPattern(*a, 8);
+        fillPattern(*b, 9);
+        auto c = std::make_unique<Mat<96, 72>>(multiply(std::execution::par, *a, *b));
+        has_passed &= maxDifference(*c, referenceProduct(*a, *b, 96, 72, 80), 96, 72) < 1e-4f;
+
+        DynMat<float> x(150, 70), y(70, 130);
+        fillPattern(x, 10);
+        fillPattern(y, 11);
+        const DynMat<float> z = multiply(std::execution::par, x, y);
+        has_passed &= maxDifference(z, referenceProduct(x, y, 150, 130, 70), 150, 130) < 1e-4f;
+
+        DynVec<float> v(70);
+        fillPattern(v, 12);
+        has_passed &= dotProduct(std::execution::par, x, v) == dotProduct(x, v);
+    }
+    return has_passed;
+}
+
+bool testRayPacketRuntime()
+{
+    using namespace Math::LinearAlgebra;
+    bool has_passed = true;
+
+    // Rays through the world origin, where the zero padding of a partial last packet sits as a
+    // zero radius sphere. The nearest sphere is in the last packet, so its lanes are selected.
+    for (size_t k = 0; k < 32; ++k) {
+        const Vec<3> direction = Vec<3> { 1.f, 0.3f + 0.0001f * static_cast<float>(k), -0.2f }.getNormalised();
+        const Vec<3> origin = direction * -18.f;
+        const Ray<3> ray(Pos<3> { origin[0], origin[1], origin[2] }, direction);
+
+        std::vector<float> x, y, z, radius;
+        for (size_t i = 0; i < 13; ++i) {
+            const Vec<3> center = origin + direction * (56.f - 3.f * static_cast<float>(i));
+            x.push_back(center[0]);
+            y.push_back(center[1] + 0.5f);
+            z.push_back(center[2]);
+            radius.push_back(1.f);
+        }
+        const Hit<float> hit = closestIntersection(ray, SpherePacket3D<float> { x, y, z, radius });
+
+        Hit<float> expected;
+        for (size_t i = 0; i < x.size(); ++i) {
+            const float t = intersectionDist(ray, Sphere3D<float>(Pos<3> { x[i], y[i], z[i] }, radius[i]));
+            if (t > 0 && (expected.index == Hit<float>::NONE || t < expected.distance)) {
+                expected = { t, i };
+            }
+        }
+        has_passed &= hit.index == expected.index && std::abs(hit.distance - expected.distance) < 1e-3f;
+    }
+    return has_passed;
+}
+
+// Closest hit over every primitive with the scalar intersectionDist().
+template <typename Primitive>
+Math::LinearAlgebra::Hit<float> bruteForceClosest(const Math::LinearAlgebra::Ray<3>& ray, const std::vector<Primitive>& primitives)
+{
+    Math::LinearAlgebra::Hit<float> hit;
+    for (size_t i = 0; i < primitives.size(); ++i) {
+        const float t = intersectionDist(ray, primitives[i]);
+        if (t > 0 && (hit.index == hit.NONE || t < hit.distance)) {
+            hit = { t, i };
+        }
+    }
+    return hit;
+}
+
+// Rays from a ring around the scene towards points inside it.
+std::vector<Math::LinearAlgebra::Ray<3>> sceneRays(size_t count)
+{
+    using namespace Math::LinearAlgebra;
+    std::vector<float> values(count * 3);
+    fillPattern(values, 13);
+    std::vector<Ray<3>> rays;
+    for (size_t i = 0; i < count; ++i) {
+        const float angle = static_cast<float>(i) * 0.7f;
+        const Vec<3> origin { 30.f * Math::cos(angle), 30.f * Math::sin(angle), 5.f * values[3 * i] };
+        const Vec<3> target { 8.f * values[3 * i + 1], 8.f * values[3 * i + 2], 0.f };
+        rays.emplace_back(Pos<3> { origin[0], origin[1], origin[2] }, target - origin);
+    }
+    return rays;
+}
+
+bool testBVHRuntime()
+{
+    using namespace Math::LinearAlgebra;
+    bool has_passed = true;
+
+    std::vector<float> values(300 * 4);
+    fillPattern(values, 14);
+    std::vector<Sphere3D<float>> spheres;
+    std::vector<Triangle3D<float>> triangles;
+    for (size_t i = 0; i < 300; ++i) {
+        const Pos<3> center { 10.f * values[4 * i], 10.f * values[4 * i + 1], 10.f * values[4 * i + 2] };
+        spheres.emplace_back(center, 0.5f + std::abs(values[4 * i + 3]));
+        triangles.emplace_back(center, Pos<3> { center[0] + 3.f, center[1], center[2] + 1.f }, Pos<3> { center[0], center[1] + 3.f, center[2] - 1.f });
+    }
+    const BVH3D<Sphere3D<float>> sphere_bvh(spheres);
+    const BVH3D<Triangle3D<float>> triangle_bvh(triangles);
+    has_passed &= sphere_bvh.size() == spheres.size() && triangle_bvh.size() == triangles.size();
+
+    for (const Ray<3>& ray : sceneRays(200)) {
+        const Hit<float> expected_sphere = bruteForceClosest(ray, spheres);
+        const Hit<float> sphere_hit = sphere_bvh.closestIntersection(ray);
+        has_passed &= sphere_hit.index == expected_sphere.index && std::abs(sphere_hit.distance - expected_sphere.distance) < 1e-3f;
+        has_passed &= sphere_bvh.anyIntersection(ray) == (expected_sphere.index != Hit<float>::NONE);
+
+        const Hit<float> expected_triangle = bruteForceClosest(ray, triangles);
+        const Hit<float> triangle_hit = triangle_bvh.closestIntersection(ray);
+        has_passed &= triangle_hit.index == expected_triangle.index && std::abs(triangle_hit.distance - expected_triangle.distance) < 1e-3f;
+        if (expected_triangle.index != Hit<float>::NONE) {
+            has_passed &= !triangle_bvh.anyIntersection(ray, expected_triangle.distance * 0.99f);
+        }
+    }
+    return has_passed;
+}
+
+bool testTriangleRuntime()
+{
+    using namespace Math::LinearAlgebra;
+    bool has_passed = true;
+
+    std::vector<float> values(37 * 9);
+    fillPattern(values, 15);
+    std::vector<Triangle3D<float>> triangles;
+    for (size_t i = 0; i < 37; ++i) {
+        const float* v = values.data() + 9 * i;
+        triangles.emplace_back(Pos<3> { 6.f * v[0], 6.f * v[1], 6.f * v[2] }, Pos<3> { 6.f * v[3], 6.f * v[4], 6.f * v[5] }, Pos<3> { 6.f * v[6], 6.f * v[7], 6.f * v[8] });
+    }
+    // 37 leaves a partial last packet for every pack width
+    std::vector<float> soa[9];
+    for (const auto& triangle : triangles) {
+        const BakedTriangle3D<float> baked(triangle);
+        for (size_t c = 0; c < 3; ++c) {
+            soa[c].push_back(baked.corner[c]);
+            soa[3 + c].push_back(baked.edge1[c]);
+            soa[6 + c].push_back(baked.edge2[c]);
+        }
+    }
+    const TrianglePacket3D<float> packet { soa[0], soa[1], soa[2], soa[3], soa[4], soa[5], soa[6], soa[7], soa[8] };
+
+    size_t hits = 0;
+    for (const Ray<3>& ray : sceneRays(100)) {
+        const Hit<float> expected = bruteForceClosest(ray, triangles);
+        const Hit<float> hit = closestIntersection(ray, packet);
+        has_passed &= hit.index == expected.index && std::abs(hit.distance - expected.distance) < 1e-3f;
+        if (expected.index == Hit<float>::NONE) {
+            continue;
+        }
+        // The barycentric point is the point along the ray
+        ++hits;
+        const Triangle3D<float>& triangle = triangles[expected.index];
+        const TriangleHit<float> barycentric = intersectionBarycentric(ray, triangle);
+        const Vec<3> corners[3] = { static_cast<Vec<3>>(triangle.corners[0]), static_cast<Vec<3>>(triangle.corners[1]), static_cast<Vec<3>>(triangle.corners[2]) };
+        const Vec<3> on_triangle = corners[0] * (1.f - barycentric.u - barycentric.v) + corners[1] * barycentric.u + corners[2] * barycentric.v;
+        const Vec<3> on_ray = static_cast<Vec<3>>(ray.getPointAlongRay(barycentric.distance));
+        has_passed &= (on_triangle - on_ray).getLength() < 1e-3f;
+    }
+    has_passed &= hits > 10;
+    return has_passed;
+}
+
+bool testActivationRuntime()
+{
+    namespace Act = Math::Activation;
+    using P = Math::Simd::Pack<float, Math::Simd::NATIVE_WIDTH<float>>;
+    bool has_passed = true;
+
+    { // Packed apply() matches the scalar functors, 1003 leaves a partial last pack
+        std::vector<float> input(1003), output(1003);
+        fillPattern(input, 16);
+        std::ranges::transform(input, input.begin(), [](float x) { return 10.f * x; });
+        auto matches = [&](const auto& activation) {
+            Act::apply(activation, std::span<const float>(input), std::span<float>(output));
+            for (size_t i = 0; i < input.size(); ++i) {
+                const float expected = activation(input[i]);
+                if (std::abs(output[i] - expected) > 1e-5f * std::max(1.f, std::abs(expected))) {
+                    return false;
+                }
+            }
+            return true;
+        };
+        has_passed &= matches(Act::Sigmoid {}) && matches(Act::GELU {}) && matches(Act::SiLU {});
+        has_passed &= matches(Act::Tanh {}) && matches(Act::Softplus {}) && matches(Act::Gaussian {});
+    }
+    { // exp stays finite up to ln(FLT_MAX), where range reduction gives 2^128
+        for (const float x : { -87.3f, 80.f, 88.3f, 88.38f, 88.5f, 88.72f }) {
+            float lanes[P::width];
+            Math::Simd::exp(P::broadcast(x)).store(lanes);
+            has_passed &= std::isfinite(lanes[0]) && std::abs(lanes[0] / std::exp(x) - 1.f) < 1e-6f;
+            Math::Simd::exp<Math::Precision::Fast>(P::broadcast(x)).store(lanes);
+            has_passed &= std::isfinite(lanes[0]) && std::abs(lanes[0] / std::exp(x) - 1.f) < 1e-4f;
+        }
+    }
+    { // Lookup tables clamp infinities and return NaN as is, packed and scalar alike
+        static constexpr Act::LookupTable<Act::Sigmoid, 257> table(-8.f, 8.f);
+        constexpr float INF = std::numeric_limits<float>::infinity();
+        const std::vector<float> input { 0.3f, NAN, -INF, INF, -9.f, 7.99f, -NAN, 2.f, -0.5f, NAN, 8.f };
+        std::vector<float> output(input.size());
+        Act::apply(table, std::span<const float>(input), std::span(output));
+        for (size_t i = 0; i < input.size(); ++i) {
+            const float expected = table(input[i]);
+            if (std::isnan(input[i])) {
+                has_passed &= std::isnan(expected) && std::isnan(output[i]);
+            } else {
+                has_passed &= std::abs(output[i] - expected) < 1e-6f && std::abs(expected - Act::Sigmoid {}(std::clamp(input[i], -8.f, 8.f))) < 1e-3f;
+            }
+        }
+    }
+    return has_passed;
+}
+
+bool testExpressionRuntime()
+{
+    using namespace Math::LinearAlgebra;
+    bool has_passed = true;
+    auto matches = [](const auto& result, const auto& expected) {
+        for (size_t i = 0; i < std::size(expected); ++i) {
+            if (std::abs(result.data[i] - expected[i]) > 1e-6f) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    { // Vec<3> takes the zero padded 4 lane path, the padding lane is not stored
+        struct {
+            Vec<3> value;
+            float sentinel = 42.f;
+        } out;
+        const Vec<3> a { 1.f, -2.f, 3.5f }, b { 0.5f, 4.f, -1.f }, c { 8.f, 2.f, -6.f };
+        out.value = a + b * 2.f - c / 4.f;
+        has_passed &= matches(out.value, std::array { 0.f, 5.5f, 3.f }) && out.sentinel == 42.f;
+        out.value = -(a * b) * 2.f;
+        has_passed &= matches(out.value, std::array { -1.f, 16.f, 7.f }) && out.sentinel == 42.f;
+    }
+    { // Vec<4> fills the pack exactly
+        const Vec<4> a { 1.f, 2.f, 3.f, 4.f }, b { -1.f, 0.5f, 2.f, 8.f };
+        const Vec<4> result = (a - b) * (a + b) / 2.f;
+        has_passed &= matches(result, std::array { 0.f, 1.875f, 2.5f, -24.f });
+    }
+    { // Mat<3, 5> has 15 elements, a full pack then a scalar tail
+        Mat<3, 5> a, b;
+        fillPattern(a.data, 3);
+        fillPattern(b.data, 4);
+        const Mat<3, 5> result = a * 3.f - b;
+        std::array<float, 15> expected;
+        for (size_t i = 0; i < expected.size(); ++i) {
+            expected[i] = a.data[i] * 3.f - b.data[i];
+        }
+        has_passed &= matches(result, expected);
+    }
+    return has_passed;
+}
+
+bool testTransformRuntime()
+{
+    using namespace Math::LinearAlgebra;
+    bool has_passed = true;
+    const Affine3<float> transform = Affine3<float>::fromTranslation(Vec<3> { 1, -2, 3 }) * Affine3<float>::fromRotation(Mat<3, 3>({ { 0, -1, 0 }, { 1, 0, 0 }, { 0, 0, 1 } })) * Affine3<float>::fromScale(2.0f);
+    auto close = [](const auto& a, const auto& b) {
+        return std::abs(a.data[0] - b.data[0]) + std::abs(a.data[1] - b.data[1]) + std::abs(a.data[2] - b.data[2]) < 1e-5f;
+    };
+
+    std::vector<Pos<3>> points(37);
+    std::span<float> coordinates(points.data()->data, 3 * points.size());
+    fillPattern(coordinates, 21);
+
+    { // Out of place, the element after out must survive the padded stores
+        std::vector<Pos<3>> out(points.size() + 1, Pos<3> { 7, 7, 7 });
+        transformPoints(transform, std::span<const Pos<3>>(points), std::span(out).first(points.size()));
+        for (size_t i = 0; i < points.size(); ++i) {
+            has_passed &= close(out[i], transform.transformPoint(points[i]));
+        }
+        has_passed &= close(out.back(), Pos<3> { 7, 7, 7 });
+    }
+    { // In place
+        std::vector<Pos<3>> in_place = points;
+        transformPoints(transform, std::span(in_place));
+        for (size_t i = 0; i < points.size(); ++i) {
+            has_passed &= close(in_place[i], transform.transformPoint(points[i]));
+        }
+    }
+    { // Quat rotation of a Vec<3> span shares the kernel
+        const Quat<float> rotation = Quat<float>::fromAxisAngle(Vec<3> { 0, 0.6f, 0.8f }, Math::Radians { Math::Degrees { 50 } });
+        std::vector<Vec<3>> vectors(points.size()), rotated(points.size());
+        std::ranges::transform(points, vectors.begin(), [](const Pos<3>& point) { return static_cast<Vec<3>>(point); });
+        rotate(rotation, std::span<const Vec<3>>(vectors), std::span(rotated));
+        for (size_t i = 0; i < vectors.size(); ++i) {
+            has_passed &= close(rotated[i], rotation.rotate(vectors[i]));
+        }
+    }
+    return has_passed;
+}
+
+bool testSoAVecRuntime()
+{
+    using namespace Math::LinearAlgebra;
+    bool has_passed = true;
+
+    std::vector<Vec<3>> a(29), b(29);
+    std::span<float> a_values(a.data()->data, 3 * a.size()), b_values(b.data()->data, 3 * b.size());
+    fillPattern(a_values, 22);
+    fillPattern(b_values, 23);
+    const SoAVec<3> soa_a { std::span<const Vec<3>>(a) }, soa_b { std::span<const Vec<3>>(b) };
+
+    { // Packed batch operations match the Vec<3> ones, 29 leaves a partial last pack
+        SoAVec<3> sum(a.size()), normalised(a.size());
+        std::vector<float> dots(a.size()), lengths(a.size());
+        add(soa_a, soa_b, sum);
+        normalise(soa_a, normalised);
+        dotProduct(soa_a, soa_b, std::span(dots));
+        length(soa_a, std::span(lengths));
+        for (size_t i = 0; i < a.size(); ++i) {
+            has_passed &= (static_cast<Vec<3>>(sum[i]) - (a[i] + b[i])).getLength() < 1e-6f;
+            has_passed &= (static_cast<Vec<3>>(normalised[i]) - a[i].getNormalised()).getLength() < 1e-5f;
+            has_passed &= std::abs(dots[i] - dotProduct(a[i], b[i])) < 1e-5f;
+            has_passed &= std::abs(lengths[i] - a[i].getLength()) < 1e-5f;
+        }
+    }
+    { // A moved-from SoAVec is empty
+        SoAVec<3> source = soa_a.clone();
+        SoAVec<3> moved(std::move(source));
+        has_passed &= moved.size() == a.size() && source.size() == 0;
+        source = std::move(moved);
+        has_passed &= source.size() == a.size() && moved.size() == 0;
+        std::vector<Vec<3>> round_trip(a.size());
+        source.toAoS(std::span(round_trip));
+        has_passed &= round_trip == a;
+    }
+    return has_passed;
+}
+
+bool testPolicyReductionRuntime()
+{
+    using namespace Math::LinearAlgebra;
+    bool has_passed = true;
+
+    { // 50003 elements span four reduction blocks, the last one partial
+        constexpr size_t SIZE = 50003;
+        DynVec<float> a(SIZE), b(SIZE);
+        std::span<float> a_values(a.data(), SIZE), b_values(b.data(), SIZE);
+        fillPattern(a_values, 24);
+        fillPattern(b_values, 25);
+        double dot = 0, squared_distance = 0;
+        for (size_t i = 0; i < SIZE; ++i) {
+            dot += static_cast<double>(a_values[i]) * b_values[i];
+            squared_distance += (static_cast<double>(a_values[i]) - b_values[i]) * (static_cast<double>(a_values[i]) - b_values[i]);
+        }
+        for (const Summation summation : { Summation::Pairwise, Summation::Kahan }) {
+            const float seq = dotProduct(std::execution::seq, a, b, summation);
+            has_passed &= std::abs(seq - dot) < 1e-3;
+            has_passed &= seq == dotProduct(std::execution::par, a, b, summation) && seq == dotProduct(std::execution::par_unseq, a, b, summation);
+            has_passed &= std::abs(distance(std::execution::par, a, b, summation) - std::sqrt(squared_distance)) < 1e-3;
+            has_passed &= length(std::execution::seq, a, summation) == std::sqrt(lengthSquared(std::execution::par, a, summation));
+        }
+
+        const DynVec<float> sum = add(std::execution::par, a, b), difference = subtract(std::execution::par, a, b), scaled = scale(std::execution::seq, a, 3.f);
+        for (size_t i = 0; i < SIZE; ++i) {
+            has_passed &= sum.data()[i] == a_values[i] + b_values[i] && difference.data()[i] == a_values[i] - b_values[i] && scaled.data()[i] == a_values[i] * 3.f;
+        }
+    }
+    { // Fixed size overloads, 37 leaves a partial pack
+        Vec<37> a, b;
+        fillPattern(a.data, 26);
+        fillPattern(b.data, 27);
+        has_passed &= std::abs(dotProduct(std::execution::par, a, b) - dotProduct(a, b)) < 1e-5f;
+        const Vec<37> sum = add(std::execution::seq, a, b), scaled = scale(std::execution::par, a, -2.f);
+        for (size_t i = 0; i < 37; ++i) {
+            has_passed &= sum.data[i] == a.data[i] + b.data[i] && scaled.data[i] == a.data[i] * -2.f;
+        }
+        const Pos<3> p1 { 1, 2, 3 }, p2 { 4, 6, 3 };
+        has_passed &= distance(std::execution::seq, p1, p2) == 5.f;
+    }
+    return has_passed;
+}
+
+bool testSimilarityRuntime()
+{
+    using namespace Math::LinearAlgebra;
+    bool has_passed = true;
+
+    // 1500 vectors and 70 queries span two database and two query blocks
+    constexpr size_t COUNT = 1500, QUERIES = 70, DIMENSION = 19, K = 5;
+    DynMat<float> vectors(COUNT, DIMENSION), queries(QUERIES, DIMENSION);
+    std::span<float> vector_values(vectors.data(), COUNT * DIMENSION), query_values(queries.data(), QUERIES * DIMENSION);
+    fillPattern(vector_values, 28);
+    fillPattern(query_values, 29);
+    auto score = [&](const float* query, size_t index, Similarity similarity) {
+        double dot = 0, query_norm = 0, norm = 0, squared_distance = 0;
+        for (size_t d = 0; d < DIMENSION; ++d) {
+            const double a = query[d], b = vectors[index][d];
+            dot += a * b;
+            query_norm += a * a;
+            norm += b * b;
+            squared_distance += (a - b) * (a - b);
+        }
+        switch (similarity) {
+        case Similarity::Cosine:
+            return dot / std::sqrt(query_norm * norm);
+        case Similarity::L2:
+            return std::sqrt(squared_distance);
+        default:
+            return dot;
+        }
+    };
+    const SimilarityIndex<float> index(vectors.clone());
+
+    for (const Similarity similarity : { Similarity::Dot, Similarity::Cosine, Similarity::L2 }) {
+        const double direction = similarity == Similarity::L2 ? -1 : 1;
+        const std::vector<Neighbour<float>> result = index.topK(queries, K, similarity);
+        has_passed &= result.size() == QUERIES * K;
+        for (size_t q = 0; q < QUERIES; ++q) {
+            std::vector<double> expected(COUNT);
+            for (size_t i = 0; i < COUNT; ++i) {
+                expected[i] = direction * score(queries[q], i, similarity);
+            }
+            std::ranges::partial_sort(expected, expected.begin() + K, std::greater {});
+            for (size_t i = 0; i < K; ++i) {
+                const Neighbour<float>& neighbour = result[q * K + i];
+                // Compare scores rather than indices so near ties may come in either order
+                has_passed &= neighbour.index < COUNT && std::abs(neighbour.score - score(queries[q], neighbour.index, similarity)) < 1e-4;
+                has_passed &= std::abs(direction * neighbour.score - expected[i]) < 1e-4;
+            }
+        }
+
+        const std::vector<Neighbour<float>> parallel = index.topK(std::execution::par, queries, K, similarity);
+        has_passed &= std::ranges::equal(result, parallel, [](const auto& a, const auto& b) { return a.index == b.index && a.score == b.score; });
+    }
+    { // A single Vec query, and padding when k exceeds the index size
+        Vec<3> points[3] = { { 1, 0, 0 }, { 0, 2, 0 }, { 0, 0, 3 } };
+        const SimilarityIndex<float> small(std::span<const Vec<3>>(points, 3));
+        const std::vector<Neighbour<float>> nearest = small.topK(Vec<3> { 0, 1.5f, 0.5f }, 5, Similarity::L2);
+        has_passed &= nearest.size() == 5 && nearest[0].index == 1 && nearest[1].index == 0 && nearest[2].index == 2;
+        has_passed &= std::abs(nearest[0].score - std::sqrt(0.5f)) < 1e-6f;
+        has_passed &= nearest[3].index == Neighbour<float>::NONE && nearest[4].index == Neighbour<float>::NONE;
+    }
+    return has_passed;
+}
+
+bool testTrigonometryRuntime()
+{
+    bool has_passed = true;
+
+    { // Constant evaluated reduction, exact below 1.6e6 and 0 once doubles are 1 apart
+        static_assert(Math::Constexpr::sin(1e300) == 0.0 && Math::Constexpr::cos(-1e19) == 0.0 && Math::Constexpr::tan(0x1p52) == 0.0);
+        for (const double x : { 0.5, -3.0, 1e5, -1.5e6 }) {
+            has_passed &= std::abs(Math::Constexpr::sin(x) - std::sin(x)) < 1e-12 && std::abs(Math::Constexpr::cos(x) - std::cos(x)) < 1e-12;
+        }
+    }
+    { // SIMD batch, large lanes no longer overflow the int32 quadrant
+        const std::vector<float> x { 0.3f, -2.f, 100.f, -8000.f, 3e9f, -1e20f, 3e38f, std::numeric_limits<float>::infinity(), -5.f };
+        std::vector<float> sin(x.size()), cos(x.size());
+        Math::sincos(std::span<const float>(x), std::span(sin), std::span(cos));
+        for (size_t i = 0; i < x.size(); ++i) {
+            if (std::abs(x[i]) < 8192.f) {
+                has_passed &= std::abs(sin[i] - std::sin(x[i])) < 1e-6f && std::abs(cos[i] - std::cos(x[i])) < 1e-6f;
+            } else if (std::isinf(x[i])) {
+                has_passed &= std::isnan(sin[i]) && std::isnan(cos[i]);
+            } else {
+                has_passed &= sin[i] == 0.f && cos[i] == 0.f;
+            }
+        }
+    }
+    return has_passed;
+}
+
+bool testSparseRuntime()
+{
+    using namespace Math::LinearAlgebra;
+    bool has_passed = true;
+
+    // About a third of the entries are kept, whole rows and columns are left empty
+    constexpr size_t ROWS = 67, COLS = 45, RHS_COLS = 19;
+    DynMat<float> dense(ROWS, COLS), rhs(COLS, RHS_COLS);
+    std::span<float> dense_values(dense.data(), ROWS * COLS), rhs_values(rhs.data(), COLS * RHS_COLS);
+    fillPattern(dense_values, 30);
+    fillPattern(rhs_values, 31);
+    for (size_t row = 0; row < ROWS; ++row) {
+        for (size_t col = 0; col < COLS; ++col) {
+            if (std::abs(dense[row][col]) < 0.65f || row % 11 == 3 || col == 7) {
+                dense[row][col] = 0;
+            }
+        }
+    }
+    DynVec<float> vec(COLS);
+    for (size_t i = 0; i < COLS; ++i) {
+        vec[i] = rhs[i][0];
+    }
+    const DynVec<float> expected_vec = dotProduct(dense, vec);
+    const std::vector<std::vector<double>> expected_mat = referenceProduct(dense, rhs, ROWS, RHS_COLS, COLS);
+    auto vecDifference = [&](const DynVec<float>& result) {
+        float difference = result.size() == ROWS ? 0.f : 1.f;
+        for (size_t i = 0; i < ROWS && i < result.size(); ++i) {
+            difference = std::max(difference, std::abs(result[i] - expected_vec[i]));
+        }
+        return difference;
+    };
+
+    for (const SparseFormat format : { SparseFormat::CSR, SparseFormat::CSC }) {
+        const SparseMat<float> sparse(dense, 0.f, format);
+        has_passed &= sparse.getFormat() == format && sparse.nonZeros() < ROWS * COLS / 2;
+        has_passed &= maxDifference(sparse.toDense(), dense, ROWS, COLS) == 0.f;
+        has_passed &= maxDifference(sparse.convert(format == SparseFormat::CSR ? SparseFormat::CSC : SparseFormat::CSR).toDense(), dense, ROWS, COLS) == 0.f;
+        has_passed &= vecDifference(dotProduct(sparse, vec)) < 1e-5f && vecDifference(dotProduct(std::execution::par, sparse, vec)) < 1e-5f;
+        has_passed &= maxDifference(sparse * rhs, expected_mat, ROWS, RHS_COLS) < 1e-5f;
+        has_passed &= maxDifference(multiply(std::execution::par, sparse, rhs), expected_mat, ROWS, RHS_COLS) < 1e-5f;
+    }
+    { // Triplets in any order, duplicates are summed
+        const std::vector<Triplet<float>> triplets { { 2, 0, 3.f }, { 0, 1, 1.f }, { 1, 2, 5.f }, { 0, 1, 2.f }, { 2, 0, -1.f }, { 0, 0, 4.f } };
+        for (const SparseFormat format : { SparseFormat::CSR, SparseFormat::CSC }) {
+            const SparseMat<float> sparse(3, 4, std::span<const Triplet<float>>(triplets), format);
+            has_passed &= sparse.nonZeros() == 4 && sparse.at(0, 1) == 3.f && sparse.at(2, 0) == 2.f && sparse.at(1, 2) == 5.f && sparse.at(0, 0) == 4.f;
+            has_passed &= sparse.at(1, 1) == 0.f && sparse.at(2, 3) == 0.f;
+        }
+    }
+    { // A moved-from SparseMat is an empty 0 x 0 matrix that can still be used
+        SparseMat<float> source(dense, 0.f, SparseFormat::CSC);
+        SparseMat<float> moved(std::move(source));
+        has_passed &= source.rows() == 0 && source.cols() == 0 && source.getOffsets().size() == 1 && source.toDense().rows() == 0;
+        has_passed &= dotProduct(source, DynVec<float>()).size() == 0;
+        source = std::move(moved);
+        has_passed &= moved.rows() == 0 && moved.getOffsets().size() == 1 && moved.nonZeros() == 0;
+        has_passed &= vecDifference(dotProduct(source, vec)) < 1e-5f;
+    }
+    return has_passed;
+}
+
+bool testQuantisedRuntime()
+{
+    using namespace Math::LinearAlgebra;
+    bool has_passed = true;
+
+    // Rows are offset from zero so their zero points differ, 37 rows leave a partial 4 row block
+    constexpr size_t ROWS = 37, COLS = 53, RHS_COLS = 70;
+    DynMat<float> a(ROWS, COLS), b(COLS, RHS_COLS);
+    std::span<float> a_values(a.data(), ROWS * COLS), b_values(b.data(), COLS * RHS_COLS);
+    fillPattern(a_values, 32);
+    fillPattern(b_values, 33);
+    for (size_t row = 0; row < ROWS; ++row) {
+        for (size_t col = 0; col < COLS; ++col) {
+            a[row][col] = a[row][col] * static_cast<float>(row % 5 + 1) + static_cast<float>(row % 3);
+        }
+    }
+
+    // |float product - quantised product| for a column x quantised with one symmetric scale
+    auto bound = [&](const QuantisedMat<float>& quantised, size_t row, auto&& x) {
+        float max_x = 0;
+        for (size_t i = 0; i < COLS; ++i) {
+            max_x = std::max(max_x, std::abs(x(i)));
+        }
+        const float a_error = quantised.getScale(row) / 2, x_error = max_x / 127 / 2;
+        float total = 0;
+        for (size_t i = 0; i < COLS; ++i) {
+            total += a_error * std::abs(x(i)) + (std::abs(a[row][i]) + a_error) * x_error;
+        }
+        return total * 1.01f + 1e-5f;
+    };
+
+    for (const Quantisation quantisation : { Quantisation::PerRow, Quantisation::PerTensor }) {
+        const QuantisedMat<float> quantised(a, quantisation);
+        const DynMat<float> dequantised = quantised.dequantise();
+        for (size_t row = 0; row < ROWS; ++row) {
+            for (size_t col = 0; col < COLS; ++col) {
+                has_passed &= std::abs(dequantised[row][col] - a[row][col]) <= quantised.getScale(row) * 0.501f;
+            }
+        }
+
+        DynVec<float> vec(COLS);
+        for (size_t i = 0; i < COLS; ++i) {
+            vec[i] = b[i][3];
+        }
+        const DynVec<float> float_vec = dotProduct(a, vec), quantised_vec = dotProduct(quantised, vec);
+        for (size_t row = 0; row < ROWS; ++row) {
+            has_passed &= std::abs(quantised_vec[row] - float_vec[row]) <= bound(quantised, row, [&](size_t i) { return vec[i]; });
+        }
+
+        const std::vector<std::vector<double>> float_mat = referenceProduct(a, b, ROWS, RHS_COLS, COLS);
+        const DynMat<float> quantised_mat = quantised * b;
+        for (size_t row = 0; row < ROWS; ++row) {
+            for (size_t col = 0; col < RHS_COLS; ++col) {
+                has_passed &= std::abs(quantised_mat[row][col] - float_mat[row][col]) <= bound(quantised, row, [&](size_t i) { return b[i][col]; });
+            }
+        }
+        has_passed &= maxDifference(multiply(std::execution::par, quantised, b), quantised_mat, ROWS, RHS_COLS) == 0.f;
+    }
+    { // A moved-from QuantisedMat is an empty 0 x 0 matrix
+        QuantisedMat<float> source(a);
+        QuantisedMat<float> moved(std::move(source));
+        has_passed &= source.rows() == 0 && source.cols() == 0 && source.size() == 0 && source.dequantise().rows() == 0;
+        source = std::move(moved);
+        has_passed &= moved.rows() == 0 && moved.cols() == 0 && source.rows() == ROWS && source.cols() == COLS;
+    }
+    return has_passed;
+}
+
+bool testLayoutRuntime()
+{
+    using namespace Math::LinearAlgebra;
+    bool has_passed = true;
+
+    // 64^3 multiply-adds and 64^2 elements take the tiledGemm / tiledGemv and gemm / gemv paths
+    constexpr size_t SIZE = 64;
+    using Tile = Tiled<8>;
+    auto a = std::make_unique<Mat<SIZE, SIZE>>(), b = std::make_unique<Mat<SIZE, SIZE>>();
+    fillPattern(a->data, 34);
+    fillPattern(b->data, 35);
+    for (size_t i = 0; i < SIZE; ++i) {
+        a->at(i, i) += 8.f; // diagonally dominant, so well conditioned for inverse()
+    }
+    const auto a_tiled = std::make_unique<Mat<SIZE, SIZE, float, Tile>>(*a), b_tiled = std::make_unique<Mat<SIZE, SIZE, float, Tile>>(*b);
+    const auto a_cols = std::make_unique<Mat<SIZE, SIZE, float, ColumnMajor>>(*a), b_cols = std::make_unique<Mat<SIZE, SIZE, float, ColumnMajor>>(*b);
+    const std::vector<std::vector<double>> expected = referenceProduct(*a, *b, SIZE, SIZE, SIZE);
+    Vec<SIZE> vec;
+    fillPattern(vec.data, 36);
+    const Vec<SIZE> expected_vec = dotProduct(*a, vec), expected_transposed = dotProduct(vec, *a);
+    auto vecMatches = [](const Vec<SIZE>& result, const Vec<SIZE>& reference) {
+        return std::ranges::equal(result, reference, [](float x, float y) { return std::abs(x - y) < 1e-4f; });
+    };
+
+    { // Products and dotProduct, sequential and parallel
+        has_passed &= maxDifference(*a_tiled * *b_tiled, expected, SIZE, SIZE) < 1e-4f;
+        has_passed &= maxDifference(*a_cols * *b, expected, SIZE, SIZE) < 1e-4f;
+        has_passed &= maxDifference(*a_tiled * *b_cols, expected, SIZE, SIZE) < 1e-4f;
+        has_passed &= maxDifference(multiply(std::execution::par, *a_tiled, *b_tiled), expected, SIZE, SIZE) < 1e-4f;
+        has_passed &= maxDifference(multiply(std::execution::par, *a_cols, *b), expected, SIZE, SIZE) < 1e-4f;
+        has_passed &= maxDifference(multiply(std::execution::par, *a, *b_cols), expected, SIZE, SIZE) < 1e-4f;
+        has_passed &= vecMatches(dotProduct(*a_tiled, vec), expected_vec) && vecMatches(dotProduct(vec, *a_tiled), expected_transposed);
+        has_passed &= vecMatches(dotProduct(*a_cols, vec), expected_vec) && vecMatches(dotProduct(vec, *a_cols), expected_transposed);
+        has_passed &= vecMatches(dotProduct(std::execution::par, *a_tiled, vec), expected_vec);
+        has_passed &= vecMatches(dotProduct(std::execution::par, *a_cols, vec), expected_vec);
+    }
+    { // determinant, inverse and solve read through the layout
+        const Mat<4, 4> small { { 2, 1, 0, 3 }, { 1, 4, 1, 0 }, { 0, 2, 5, 1 }, { 1, 0, 1, 6 } };
+        const Mat<4, 4, float, ColumnMajor> small_cols(small);
+        const Mat<4, 4, float, Tiled<2>> small_tiled(small);
+        has_passed &= std::abs(determinant(small_cols) - determinant(small)) < 1e-4f && std::abs(determinant(small_tiled) - determinant(small)) < 1e-4f;
+        has_passed &= maxDifference(inverse(small_cols), inverse(small), 4, 4) < 1e-6f && maxDifference(inverse(small_tiled), inverse(small), 4, 4) < 1e-6f;
+
+        const auto inverse_cols = std::make_unique<Mat<SIZE, SIZE, float, ColumnMajor>>(inverse(*a_cols));
+        const auto identity = std::make_unique<Mat<SIZE, SIZE, float, ColumnMajor>>(*inverse_cols * *a);
+        const auto expected_identity = std::make_unique<Mat<SIZE, SIZE>>();
+        for (size_t i = 0; i < SIZE; ++i) {
+            expected_identity->at(i, i) = 1.f;
+        }
+        has_passed &= maxDifference(*identity, *expected_identity, SIZE, SIZE) < 1e-4f;
+        const auto scaled = std::make_unique<Mat<SIZE, SIZE, float, Tile>>(*a_tiled * 0.125f); // keeps the determinant in float range
+        const float scaled_determinant = determinant(Mat<SIZE, SIZE>(*scaled));
+        has_passed &= std::isnormal(scaled_determinant) && std::abs(determinant(*scaled) / scaled_determinant - 1.f) < 1e-4f;
+        has_passed &= vecMatches(dotProduct(*a, solve(*a_tiled, vec)), vec);
+    }
+    { // dense, SparseMat, QuantisedMat and DynMat take any layout
+        Vec<SIZE> bias;
+        fillPattern(bias.data, 37);
+        has_passed &= vecMatches(dense(*a_tiled, vec, bias), dense(*a, vec, bias)) && vecMatches(dense(*a_cols, vec, bias), dense(*a, vec, bias));
+        has_passed &= maxDifference(dense(*a_tiled, *b_cols, bias), dense(*a, *b, bias), SIZE, SIZE) < 1e-4f;
+
+        has_passed &= maxDifference(SparseMat<float>(*a_tiled, 0.5f).toDense(), SparseMat<float>(*a, 0.5f).toDense(), SIZE, SIZE) == 0.f;
+        has_passed &= maxDifference(SparseMat<float>(*a_cols, 0.5f, SparseFormat::CSC).toDense(), SparseMat<float>(*a, 0.5f).toDense(), SIZE, SIZE) == 0.f;
+        has_passed &= maxDifference(QuantisedMat<float>(*a_tiled).dequantise(), QuantisedMat<float>(*a).dequantise(), SIZE, SIZE) == 0.f;
+        has_passed &= maxDifference(QuantisedMat<float>(*a_cols).dequantise(), QuantisedMat<float>(*a).dequantise(), SIZE, SIZE) == 0.f;
+
+        const DynMat<float> dyn_a(*a_cols);
+        has_passed &= maxDifference(dyn_a, *a, SIZE, SIZE) == 0.f;
+        has_passed &= maxDifference(dyn_a * *b_tiled, expected, SIZE, SIZE) < 1e-4f && maxDifference(*a_tiled * DynMat<float>(*b), expected, SIZE, SIZE) < 1e-4f;
+        has_passed &= maxDifference(static_cast<Mat<SIZE, SIZE, float, Tile>>(dyn_a), *a, SIZE, SIZE) == 0.f;
+    }
+    return has_passed;
+}
+
+} // namespace
+
+bool testRuntime()
+{
+    bool has_passed = true;
+    auto check = [&](bool passed, const char* name) {
+        if (!passed) {
+            std::cerr << "Failed " << name << '\n';
+        }
+        has_passed &= passed;
+    };
+    check(testGemmRuntime(), "GEMM kernel");
+    check(testDynMatRuntime(), "DynMat operations");
+    check(testThreadPoolRuntime(), "Thread pool and parallel products");
+    check(testRayPacketRuntime(), "Ray and sphere packets");
+    check(testBVHRuntime(), "Bounding volume hierarchy");
+    check(testTriangleRuntime(), "Triangle intersection");
+    check(testActivationRuntime(), "Activation functions");
+    check(testExpressionRuntime(), "Element-wise expressions");
+    check(testTransformRuntime(), "Batched point transforms");
+    check(testSoAVecRuntime(), "Structure of arrays batches");
+    check(testPolicyReductionRuntime(), "Execution policy reductions");
+    check(testSimilarityRuntime(), "Similarity search");
+    check(testTrigonometryRuntime(), "Large argument sin and cos");
+    check(testSparseRuntime(), "Sparse matrices");
+    check(testQuantisedRuntime(), "Quantised matrices");
+    check(testLayoutRuntime(), "Mat layouts");
+    return has_passed;
+}